@@ -42,6 +42,7 @@ pub fn build(b: *std.build.Builder) !void {
     exe.linkSystemLibrary("GL");
     exe.linkSystemLibrary("pthread");
     exe.linkSystemLibrary("png");
+    exe.linkSystemLibrary("z");
     b.installArtifact(exe);
 
     // Run the application
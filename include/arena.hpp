@@ -0,0 +1,134 @@
+/**
+ * @File: arena.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Bump ('arena') allocator for the temporaries of planner queries
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/**
+ * @brief Hands out memory by bumping a pointer through a list of large blocks
+ *
+ * Nothing is freed individually; Reset() rewinds to the first block in O(1)
+ * and keeps every block for reuse, so once an arena has grown to fit the
+ * largest query it never touches the global heap again.
+ *
+ * Not thread-safe: use one arena per thread.
+ */
+class Arena
+{
+public:
+    Arena(size_t blockSize = 1 << 20) : blockSize(blockSize) { };
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    void* Allocate(size_t bytes, size_t align);
+
+    //! Release everything allocated since the last reset, keeping the blocks
+    void Reset();
+
+    size_t GetNumAllocs() const { return nAllocs; }        //!< Allocations since the last reset
+    size_t GetNumHeapAllocs() const { return nHeapAllocs; } //!< New blocks since the last reset
+    size_t GetBytesUsed() const { return bytesUsed; }      //!< Bytes handed out since the last reset
+    size_t GetCapacity() const;                             //!< Total size of all blocks
+
+private:
+    struct Block
+    {
+        std::unique_ptr<uint8_t[]> data;
+        size_t size {0};
+    };
+
+    size_t blockSize;
+    std::vector<Block> blocks;
+    size_t current {0}; //!< Block currently being allocated from
+    size_t offset {0};  //!< Offset of the next free byte in the current block
+
+    size_t nAllocs {0};
+    size_t nHeapAllocs {0};
+    size_t bytesUsed {0};
+};
+
+//! STL-compatible allocator drawing from an Arena; deallocation is a no-op
+template <class T>
+struct ArenaAllocator
+{
+    using value_type = T;
+
+    Arena* arena {nullptr};
+
+    ArenaAllocator(Arena* arena) : arena(arena) { }
+
+    template <class U>
+    ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) { }
+
+    T* allocate(size_t n) {
+        return static_cast<T*>(arena->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T*, size_t) { }
+
+    template <class U>
+    bool operator==(const ArenaAllocator<U>& other) const { return arena == other.arena; }
+
+    template <class U>
+    bool operator!=(const ArenaAllocator<U>& other) const { return arena != other.arena; }
+};
+
+//! Allocation counts for the most recent query through a QueryContext
+struct QueryStats
+{
+    size_t allocs {0};     //!< Number of allocations made by the query
+    size_t heapAllocs {0}; //!< How many of those required new memory from the heap
+    size_t bytes {0};      //!< Total bytes allocated
+};
+
+/**
+ * @brief State handed to planners for each query
+ *
+ * Planners allocate their search temporaries from 'arena'.  Buffers which a
+ * planner keeps between queries to reuse their storage must report through
+ * Track() whenever they grow, so that the stats cover them too.  Begin() is
+ * called at the start of each query to throw away the previous one's, so a
+ * context must not be shared by searches that are in progress at once.
+ */
+struct QueryContext
+{
+    Arena arena;
+
+    void Begin() {
+        arena.Reset();
+        nGrowths = 0;
+        grownBytes = 0;
+    }
+
+    //! Count 'buf' as a heap allocation if it has grown past 'oldCapacity'
+    template <class Vec>
+    void Track(const Vec& buf, size_t oldCapacity) {
+        if (buf.capacity() > oldCapacity) {
+            Count(1, buf.capacity() * sizeof(typename Vec::value_type));
+        }
+    }
+
+    //! Count heap allocations made for the query outside of the arena
+    void Count(size_t allocs, size_t bytes) {
+        nGrowths += allocs;
+        grownBytes += bytes;
+    }
+
+    QueryStats GetStats() const {
+        return {arena.GetNumAllocs() + nGrowths, arena.GetNumHeapAllocs() + nGrowths,
+                arena.GetBytesUsed() + grownBytes};
+    }
+
+private:
+    size_t nGrowths {0};   //!< Heap allocations outside the arena since Begin()
+    size_t grownBytes {0}; //!< Size of those allocations
+};
@@ -10,64 +10,108 @@
 #include "olcPixelGameEngine.h"
 
 #include <cfloat>
-#include <queue>
 
 #include "gamemap.hpp"
+#include "openlist.hpp"
 #include "planner.hpp"
 
 
 class AStar : public Planner
 {
 public:
-    AStar() { };
+    /**
+     * @param heuristic    Distance heuristic to guide the search with
+     * @param connectivity Number of neighbors of each tile (4 or 8)
+     * @param openList     Priority queue to keep the open nodes in
+     * @param epsilon      Suboptimality bound: paths cost at most (1 + epsilon)
+     *                     times the optimum, in exchange for fewer expansions
+     */
+    AStar(HeuristicType heuristic = EFFORT_OCTILE, int connectivity = 8, OpenListType openList = OPEN_HEAP,
+          float epsilon = 0.f) :
+        heuristic(heuristic), connectivity(connectivity), openList(openList), weight(1.f + epsilon) { };
 
     void SetTerrainMap(GameMap& map) override;
 
-    bool ComputePath(olc::vi2d start, olc::vi2d goal) override;
+    bool ComputePath(WorldPos start, WorldPos goal) override;
 
-    std::vector<olc::vi2d> GetPath() override;
+    void StartPath(WorldPos start, WorldPos goal) override;
+    PlanStatus StepPath(int maxExpansions, int maxMicros = 0) override;
+    PathView GetPartialPath() override;
+
+    PathView GetPath() override;
     float GetPathCost() override { return path_cost; }
 
 private:
+    /**
+     * @brief Per-tile search state, kept to 16 bytes
+     *
+     * A node's location and index follow from its position in 'nodes', and
+     * its effort is read from 'grid', so only the search state lives here.
+     */
     struct Node
     {
-        Node() = default;
-
-        olc::vi2d loc {0, 0};
-        int idx {0};
+        float f {FLT_MAX};     //!< g + heuristic; the node's priority while open
+        float g {FLT_MAX};     //!< Best known cost from the start
+        int32_t parent {-1};   //!< Index of the previous node on the best path
+        uint32_t counter : 30; //!< Insertion order, to break ties between equal 'f'
+        uint32_t state : 2;    //!< One of State
 
-        float f {FLT_MAX};
-        float g {FLT_MAX};
-        float h {FLT_MAX};
-        float effort {0.f};
-        int counter {0};
+        enum State {NEW, OPEN, CLOSED};
 
-        std::vector<int> neighbors;
+        Node() : counter(0), state(NEW) { }
 
-        enum State {CLOSED, OPEN, VISITED};
-        State state {CLOSED};
-
-        std::tuple<float, int, int> GetTuple() {
-            return std::make_tuple(f, counter, idx);
-        }
-
-        bool operator<(const Node& b) {
-            if (f == b.f)
-                return counter < b.counter;
-            return f < b.f;
+        OpenEntry GetEntry(int idx) const {
+            return {f, counter, idx};
         }
     };
+    static_assert(sizeof(Node) == 16, "AStar::Node should stay compact");
 
     GameMap* map {nullptr};
 
-    std::vector<Node> nodes;
+    HeuristicType heuristic {EFFORT_OCTILE};
+    int connectivity {8};
+    OpenListType openList {OPEN_HEAP};
+    float weight {1.f}; //!< Heuristic weight (1 + epsilon), as in weighted A*
+
+    EffortGrid grid;         //!< Effort of each tile in the loaded window
+    std::vector<Node> nodes; //!< Search state of each tile in the loaded window
+
+    // State of the search in progress, kept between calls to StepPath().
+    // Only the open list chosen by 'openList' is used.
+    SetOpenList setList;
+    HeapOpenList heapList;
+    BucketOpenList bucketList;
+    WorldPos goal {0, 0};
+    int gInd {-1};                  //!< Index of the goal node
+    int bestInd {-1};               //!< Expanded node closest to the goal so far
+    float bestH {FLT_MAX};          //!< Heuristic value of 'bestInd'
+    int counter {0};
 
-    bool goalReached {false};
     float path_cost {-1.f};
-
-    std::vector<olc::vi2d> final_path;
-
-    // Heuristic function (Manhattan distance, or Euclidean distance)
-    float Hval(olc::vi2d t1, olc::vi2d t2);
+    int expansions {0};
+
+    std::vector<WorldPos> final_path;
+
+    //! Fill final_path with the path from the start to the given node
+    void BuildPath(int idx);
+
+    //! Pick the Search() specialisation for the chosen connectivity and open list
+    template <class Heuristic>
+    PlanStatus Dispatch(const Heuristic& hval, int maxExpansions, int maxMicros);
+
+    template <int NN, class Heuristic>
+    PlanStatus DispatchOpen(const Heuristic& hval, int maxExpansions, int maxMicros);
+
+    /**
+     * @brief The A* search itself, specialised for each heuristic and connectivity
+     *
+     * Expands nodes until the goal is reached, the open list runs dry, or the
+     * budget is used up; in the latter case it picks up again on the next call.
+     *
+     * @tparam NN   Number of neighbors per tile (4 or 8)
+     * @tparam Open One of the open lists from openlist.hpp
+     */
+    template <int NN, class Open, class Heuristic>
+    PlanStatus Search(Open& open, const Heuristic& hval, int maxExpansions, int maxMicros);
 };
 
@@ -0,0 +1,74 @@
+/**
+ * @File: chunkpool.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Pool of storage for the tiles of map chunks, reused as chunks come and go
+ */
+#pragma once
+
+#include "tileset.hpp"
+
+#include <memory>
+#include <vector>
+
+//! Counters of a ChunkPool's use
+struct ChunkPoolStats
+{
+    long acquired {0}; //!< Slots handed out
+    long reused {0};   //!< Of those, slots released by an earlier chunk
+    long slabs {0};    //!< Slabs allocated; the only heap allocations the pool makes
+    int capacity {0};  //!< Chunks the slabs can hold at once
+    int inUse {0};     //!< Slots currently handed out
+};
+
+/**
+ * @brief Storage for the tiles, and the effort of each tile, of a bounded number of chunks
+ *
+ * Storage is allocated in slabs, each holding a fixed number of chunks'
+ * tiles plus (apart from them, so that the planners' reads stay dense) their
+ * efforts.  A chunk dropped as the map scrolls gives its slot back, and the
+ * next chunk loaded takes the slot over once it's been reset, so once the
+ * pool holds as many chunks as the view needs, scrolling never touches the
+ * heap.  Reserve() sizes it up front; should more chunks ever be needed at
+ * once, it grows by another slab.  It never shrinks.
+ */
+class ChunkPool
+{
+public:
+    ChunkPool(int tilesPerChunk, int chunksPerSlab = 64);
+
+    ChunkPool(const ChunkPool&) = delete;
+    ChunkPool& operator=(const ChunkPool&) = delete;
+
+    //! Grow to hold at least nChunks at once
+    void Reserve(int nChunks);
+
+    //! Take a slot, with its tiles and efforts reset; grows by a slab if none are free
+    int Acquire();
+
+    //! Give a slot back, to be reused by a later chunk
+    void Release(int slot);
+
+    Tile* TilesOf(int slot);
+    float* EffortOf(int slot);
+
+    ChunkPoolStats GetStats() const { return stats; }
+
+private:
+    struct Slab
+    {
+        std::unique_ptr<Tile[]> tiles;
+        std::unique_ptr<float[]> effort;
+    };
+
+    int tilesPerChunk;
+    int chunksPerSlab;
+    std::vector<Slab> slabs;
+    std::vector<int> freeSlots; //!< Released slots; the last released is reused first, still warm in cache
+    int nextFresh {0};          //!< First slot never yet handed out
+
+    ChunkPoolStats stats;
+
+    void AddSlab();
+};
@@ -0,0 +1,112 @@
+/**
+ * @File: chunkstore.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     On-disk store of procedurally-generated chunks, kept across runs
+ */
+#pragma once
+
+#include "util.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+//! Counters of a ChunkStore's use
+struct ChunkStoreStats
+{
+    long hits {0};   //!< Chunks read back from disk
+    long misses {0}; //!< Chunks not on disk (or unreadable)
+    long writes {0}; //!< Chunks written to disk
+};
+
+/**
+ * @brief Store on disk of the layers of procedurally-generated chunks
+ *
+ * A procedural chunk is a pure function of the generator's parameters and
+ * its coordinates, so once generated it can be kept and read back instead,
+ * by later runs too.  The store is keyed by a hash of the parameters: each
+ * key gets its own directory, so changing them never finds stale chunks.
+ *
+ * Each chunk is a small file holding its zlib-compressed layers, read only
+ * when asked for.  Writes are compressed and written by a background
+ * thread, each to a temporary file that is then renamed into place, so
+ * that neither a crash nor another run can ever read a partial chunk.
+ *
+ * Reads and writes reuse their buffers, and the layers queued for writing
+ * go back to a spare list once written, so that a warmed-up store makes no
+ * allocations.  Read() and Write() must be called from one thread only.
+ */
+class ChunkStore
+{
+public:
+    /**
+     * @param dir Directory to keep the chunks in; created if needed
+     * @param key Hash of the parameters the chunks are generated from
+     */
+    ChunkStore(const std::string& dir, uint64_t key);
+
+    //! Finishes any pending writes
+    ~ChunkStore();
+
+    ChunkStore(const ChunkStore&) = delete;
+    ChunkStore& operator=(const ChunkStore&) = delete;
+
+    /**
+     * @brief Read the layers of a chunk, if it has been stored
+     *
+     * @param start  Top-left tile of the chunk
+     * @param layers Filled with the chunk's layers, row-major
+     * @param size   Number of tiles in the chunk
+     */
+    bool Read(WorldPos start, uint8_t* layers, size_t size);
+
+    //! Queue a copy of a chunk's layers to be written to disk
+    void Write(WorldPos start, const uint8_t* layers, size_t size);
+
+    //! Wait for every queued write to finish
+    void Flush();
+
+    ChunkStoreStats GetStats() const;
+
+private:
+    struct PendingWrite
+    {
+        WorldPos start;
+        std::vector<uint8_t> layers;
+    };
+
+    std::string path; //!< Directory of this key's chunks
+    uint64_t key;
+    bool usable {false};
+
+    std::vector<uint8_t> readPacked;  //!< Compressed layers of the chunk being read
+    std::vector<uint8_t> writePacked; //!< Compressed layers of the chunk being written; writer thread only
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::vector<PendingWrite> queue;            //!< Writes waiting for the writer
+    std::vector<PendingWrite> writing;          //!< Writes taken by the writer; writer thread only
+    std::vector<std::vector<uint8_t>> spare;    //!< Layer buffers of finished writes, for reuse
+    bool busy {false};
+    bool stop {false};
+
+    std::atomic<long> hits {0};
+    std::atomic<long> misses {0};
+    std::atomic<long> writes {0};
+
+    //! Write the name of a chunk's file, plus 'suffix', into 'buf'; false if it doesn't fit
+    bool FileFor(WorldPos start, const char* suffix, char* buf, size_t len) const;
+
+    //! Body of the writer thread
+    void WriteLoop();
+
+    void WriteChunk(WorldPos start, const std::vector<uint8_t>& layers);
+};
@@ -0,0 +1,179 @@
+/**
+ * @File: chunktable.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Open-addressing hash table of chunks, keyed by their top-left tiles
+ */
+#pragma once
+
+#include "util.hpp"
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+//! Mix a chunk's top-left tile into a single 64-bit hash
+inline uint64_t HashChunkKey(const WorldPos& start)
+{
+    return ((uint64_t)start.x * 0x9E3779B97F4A7C15ull) ^ (uint64_t)start.y;
+}
+
+/**
+ * @brief Hash table from a chunk's top-left tile to its contents
+ *
+ * Linear probing over a power-of-two array of 64-bit tile coordinates,
+ * kept apart from the values so that probing only touches the keys.  Erasing
+ * shifts the following entries back instead of leaving tombstones, so a
+ * long session of loading and dropping chunks never slows lookups down.
+ *
+ * Inserting or erasing may move any value; don't hold on to references.
+ * Keys with x = INT64_MIN are reserved, where no chunk ever starts: its
+ * pixels would be out of the range of a WorldPos.
+ */
+template <typename T>
+class ChunkTable
+{
+public:
+    //! A slot of the table; named like std::pair so loops read the same as over a map
+    struct Entry
+    {
+        WorldPos first;
+        T second;
+    };
+
+    template <typename E>
+    class Iterator
+    {
+    public:
+        Iterator(const ChunkTable* table, size_t slot, E* entries) : table(table), slot(slot), entries(entries) {
+            Skip();
+        }
+
+        E& operator*() const { return entries[slot]; }
+        E* operator->() const { return &entries[slot]; }
+        Iterator& operator++() { slot++; Skip(); return *this; }
+        bool operator!=(const Iterator& other) const { return slot != other.slot; }
+
+    private:
+        const ChunkTable* table;
+        size_t slot;
+        E* entries;
+
+        void Skip() {
+            while (slot < table->keys.size() && IsEmpty(table->keys[slot])) slot++;
+        }
+    };
+
+    ChunkTable() { Rehash(MIN_SLOTS); }
+
+    size_t Size() const { return count; }
+
+    //! The chunk starting at 'start', or nullptr
+    T* Find(const WorldPos& start) {
+        const size_t slot = SlotOf(start);
+        return IsEmpty(keys[slot]) ? nullptr : &entries[slot].second;
+    }
+
+    const T* Find(const WorldPos& start) const {
+        return const_cast<ChunkTable*>(this)->Find(start);
+    }
+
+    bool Contains(const WorldPos& start) const { return Find(start) != nullptr; }
+
+    //! The chunk starting at 'start', added (default-constructed) if not already there
+    T& operator[](const WorldPos& start) {
+        assert(!IsEmpty(start));
+
+        size_t slot = SlotOf(start);
+        if (IsEmpty(keys[slot])) {
+            // Keep the load at most 1/2, so that probes stay short
+            if (2 * (count + 1) > keys.size()) {
+                Rehash(2 * keys.size());
+                slot = SlotOf(start);
+            }
+            keys[slot] = start;
+            entries[slot].first = start;
+            count++;
+        }
+        return entries[slot].second;
+    }
+
+    //! Remove the chunk starting at 'start'; returns false if there wasn't one
+    bool Erase(const WorldPos& start) {
+        size_t slot = SlotOf(start);
+        if (IsEmpty(keys[slot])) return false;
+
+        // Shift back each following entry that may no longer be reachable past the gap
+        const size_t mask = keys.size() - 1;
+        size_t next = (slot + 1) & mask;
+        while (!IsEmpty(keys[next])) {
+            const size_t home = Home(keys[next]);
+            if (((next - home) & mask) >= ((next - slot) & mask)) {
+                keys[slot] = keys[next];
+                entries[slot] = std::move(entries[next]);
+                slot = next;
+            }
+            next = (next + 1) & mask;
+        }
+
+        keys[slot] = Empty();
+        entries[slot] = Entry();
+        count--;
+        return true;
+    }
+
+    void Clear() {
+        keys.assign(keys.size(), Empty());
+        entries.assign(entries.size(), Entry());
+        count = 0;
+    }
+
+    Iterator<Entry> begin() { return {this, 0, entries.data()}; }
+    Iterator<Entry> end() { return {this, keys.size(), entries.data()}; }
+    Iterator<const Entry> begin() const { return {this, 0, entries.data()}; }
+    Iterator<const Entry> end() const { return {this, keys.size(), entries.data()}; }
+
+private:
+    static constexpr size_t MIN_SLOTS = 64;
+
+    std::vector<WorldPos> keys;
+    std::vector<Entry> entries;
+    size_t count {0};
+
+    //! Key of an empty slot
+    static WorldPos Empty() { return {std::numeric_limits<int64_t>::min(), 0}; }
+
+    static bool IsEmpty(const WorldPos& key) { return key.x == std::numeric_limits<int64_t>::min(); }
+
+    //! Slot a key hashes to (Fibonacci hashing, so that nearby chunks spread out)
+    size_t Home(const WorldPos& key) const {
+        return (size_t)((HashChunkKey(key) * 0x9E3779B97F4A7C15ull) >> 32) & (keys.size() - 1);
+    }
+
+    //! Slot holding the key, or the empty slot where it would go
+    size_t SlotOf(const WorldPos& key) const {
+        const size_t mask = keys.size() - 1;
+        size_t slot = Home(key);
+        while (!IsEmpty(keys[slot]) && keys[slot] != key) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void Rehash(size_t nSlots) {
+        std::vector<WorldPos> oldKeys(nSlots, Empty());
+        std::vector<Entry> oldEntries(nSlots);
+        oldKeys.swap(keys);
+        oldEntries.swap(entries);
+
+        for (size_t k = 0; k < oldKeys.size(); k++) {
+            if (IsEmpty(oldKeys[k])) continue;
+            const size_t slot = SlotOf(oldKeys[k]);
+            keys[slot] = oldKeys[k];
+            entries[slot] = std::move(oldEntries[k]);
+        }
+    }
+};
@@ -0,0 +1,117 @@
+/**
+ * @File: contraction.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Contraction Hierarchy (CH) preprocessing and queries for static maps
+ */
+#pragma once
+
+#include "olcPixelGameEngine.h"
+
+#include <string>
+#include <vector>
+
+#include "gamemap.hpp"
+#include "planner.hpp"
+
+/**
+ * @brief Contraction hierarchy over the 8-connected effort graph of a grid
+ *
+ * Nodes are contracted one at a time (cheapest 'edge difference' first),
+ * adding shortcut edges wherever the contracted node lay on the only shortest
+ * path between two of its neighbors.  Queries then only ever relax edges
+ * leading 'upwards' in the ordering, from both ends, and settle a tiny
+ * fraction of the nodes a plain Dijkstra or A* search would.
+ *
+ * Only meaningful for maps which never change after generation.
+ */
+class ContractionHierarchy
+{
+public:
+    ContractionHierarchy() { };
+
+    //! Contract every node of the grid.  Can take a while for large maps.
+    void Build(const EffortGrid& grid);
+
+    /**
+     * @brief Save / load the hierarchy to / from a binary file
+     *
+     * Loading fails if the file was built for a different map.
+     */
+    bool Save(const std::string& fname) const;
+    bool Load(const std::string& fname, const EffortGrid& grid);
+
+    bool IsBuilt() const { return nNodes > 0; }
+
+    /**
+     * @brief Bidirectional upward search between two local tile indices
+     *
+     * @param arena   Arena to allocate the search's temporaries from
+     * @param path    [out] If given, the fully-unpacked path of tile indices
+     * @param settled [out] If given, the number of nodes settled by the search
+     * @return The cost of the shortest path, or -1 if there is none
+     */
+    float Query(int source, int target, Arena& arena, std::vector<int>* path = nullptr, int* settled = nullptr);
+
+private:
+    struct Edge
+    {
+        int to {-1};      //!< Other end of the edge
+        float cost {0.f};
+        int middle {-1};  //!< Contracted node this shortcut bypasses; -1 if an original edge
+    };
+
+    int nNodes {0};
+    uint64_t mapHash {0}; //!< Hash of the grid the hierarchy was built from
+
+    //! Edges u->v with rank(v) > rank(u), stored at u (CSR layout)
+    std::vector<int> upOffsets;
+    std::vector<Edge> upEdges;
+
+    //! Edges u->v with rank(u) > rank(v), stored at v with 'to' = u (CSR layout)
+    std::vector<int> downOffsets;
+    std::vector<Edge> downEdges;
+
+    // Per-query scratch space; 'stamp' avoids clearing the arrays between queries
+    std::vector<float> distF, distB;
+    std::vector<int> parentF, parentB;
+    std::vector<uint32_t> seenF, seenB;
+    uint32_t stamp {0};
+
+    void ResetQueryData();
+
+    float EdgeCost(int from, int to, int* middle) const;
+
+    void Unpack(int from, int to, std::vector<int>& path) const;
+};
+
+//! Planner which answers queries on a static map through a ContractionHierarchy
+class CHPlanner : public Planner
+{
+public:
+    /**
+     * @param cacheFile If non-empty, load the hierarchy from this file when it
+     *                  is valid for the map, or save it there once built
+     */
+    CHPlanner(const std::string& cacheFile = "") : cacheFile(cacheFile) { };
+
+    void SetTerrainMap(GameMap& map) override;
+
+    bool ComputePath(WorldPos start, WorldPos goal) override;
+
+    PathView GetPath() override;
+    float GetPathCost() override { return path_cost; }
+
+private:
+    GameMap* map {nullptr};
+
+    std::string cacheFile;
+    EffortGrid grid;
+    ContractionHierarchy ch;
+
+    float path_cost {-1.f};
+    int expansions {0};
+    std::vector<int> path_idx;
+    std::vector<WorldPos> final_path;
+};
@@ -0,0 +1,127 @@
+/**
+ * @File: costfield.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Single-source shortest-path cost fields over an EffortGrid
+ */
+#pragma once
+
+#include <chrono>
+#include <vector>
+
+#include "chunktable.hpp"
+#include "gamemap.hpp"
+#include "landmarks.hpp"
+#include "openlist.hpp"
+
+/**
+ * @brief Run Dijkstra's algorithm from 'source' over the whole grid
+ *
+ * Uses the same cost model as the planners: moving onto a tile costs the
+ * step length (1 or sqrt(2)) plus that tile's effort.
+ *
+ * @param grid   Effort snapshot to search over
+ * @param source Local index of the source tile
+ * @param cost   [out] Cost from 'source' to every tile; FLT_MAX if unreachable
+ */
+void ComputeCostField(const EffortGrid& grid, int source, std::vector<float>& cost);
+
+/**
+ * @brief Update a cost field from ComputeCostField() for a new snapshot of the map
+ *
+ * The snapshot may have scrolled, changed the effort of some tiles, or both.
+ * Only the tiles whose cheapest path may have entered a tile which changed
+ * or left the window are invalidated, by following the old costs on from
+ * those tiles; Dijkstra's algorithm is then resumed from the valid tiles
+ * bordering them, and from there goes on wherever it improves on the old
+ * costs.  The result is the same as ComputeCostField() over the new grid,
+ * for a fraction of the work when the change is small.
+ *
+ * @param oldGrid Effort snapshot the field was computed over
+ * @param grid    New effort snapshot; must still hold the source tile
+ * @param source  Local index of the source tile in the new grid
+ * @param cost    [in,out] Cost from 'source' to every tile of oldGrid, then of grid
+ */
+void RepairCostField(const EffortGrid& oldGrid, const EffortGrid& grid, int source, std::vector<float>& cost);
+
+/**
+ * @brief Run Dijkstra's algorithm backwards from 'target' over the whole grid
+ *
+ * As each move costs the effort of the tile it enters, the cost of getting
+ * to a tile differs from the cost of getting back from it; this gives the
+ * latter, e.g. as an exact heuristic for searches towards 'target'.
+ *
+ * @param grid   Effort snapshot to search over
+ * @param target Local index of the target tile
+ * @param cost   [out] Cost from every tile to 'target'; FLT_MAX if it can't get there
+ * @param nn     Number of neighbors of each tile (4 or 8)
+ */
+void ComputeCostFieldTo(const EffortGrid& grid, int target, std::vector<float>& cost, int nn = EffortGrid::NN);
+
+/**
+ * @brief Cost from tiles to a target, worked out only as far as it's asked for
+ *
+ * A backwards A* from the target, aimed at the tile whose cost is likely to
+ * be wanted first, and resumed whenever the cost of a tile it hasn't settled
+ * yet is asked for (Silver's Reverse Resumable A*).  The heuristic is
+ * consistent, so settled costs are exact and match ComputeCostFieldTo(); a
+ * search which only looks at a corridor of the grid pays for little more.
+ */
+class LazyCostField
+{
+public:
+    /**
+     * @param grid      Effort snapshot to search over; has to outlive the field's use
+     * @param target    Local index of the target tile
+     * @param toward    Local index of the tile to aim the search at
+     * @param nn        Number of neighbors of each tile (4 or 8)
+     * @param minEffort Least effort of any tile in the grid
+     * @param alt       Landmark tables over the same window to aim with as well, if any
+     */
+    void Reset(const EffortGrid& grid, int target, int toward, int nn, float minEffort,
+               const ALTHeuristic* alt = nullptr);
+
+    //! Cost from tile 'idx' to the target; FLT_MAX if it can't get there, or if the deadline passes first
+    float Get(int idx, std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+    //! Number of tiles whose cost is settled
+    int GetSettled() const { return settled; }
+
+private:
+    struct Tile
+    {
+        float g;     //!< Cost to the target; exact once closed
+        bool closed;
+    };
+
+    const EffortGrid* grid {nullptr};
+    const ALTHeuristic* alt {nullptr};
+    int nn {EffortGrid::NN};
+    WorldPos toward {0, 0}; //!< World I,J coordinates
+    float minEffort {0.f};
+    int settled {0};
+
+    ChunkTable<Tile> tiles; //!< Only the tiles reached so far, by local I,J coordinates
+    DepthHeap open;         //!< Entries index the grid
+};
+
+/**
+ * @brief Multi-threaded delta-stepping version of ComputeCostField()
+ *
+ * Tiles are kept in buckets of width 'delta' by their tentative cost, and all
+ * the tiles in the lowest bucket are settled in parallel: first relaxing the
+ * cheap ("light") edges until the bucket stops changing, then the rest.  The
+ * effort values are small, so buckets as wide as the costliest edge give each
+ * thread plenty to do for only a few re-relaxations.
+ *
+ * @param grid     Effort snapshot to search over
+ * @param source   Local index of the source tile
+ * @param cost     [out] Cost from 'source' to every tile; FLT_MAX if unreachable
+ * @param parent   [out] Previous tile on the cheapest path from 'source';
+ *                 -1 for the source and for unreachable tiles
+ * @param nThreads Number of worker threads; 0 to use one per core
+ * @param delta    Bucket width; 0 to pick one from the grid's edge costs
+ */
+void ComputeCostFieldParallel(const EffortGrid& grid, int source, std::vector<float>& cost,
+                              std::vector<int>& parent, int nThreads = 0, float delta = 0.f);
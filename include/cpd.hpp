@@ -0,0 +1,109 @@
+/**
+ * @File: cpd.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Compressed Path Database (first-move tables) for static maps
+ */
+#pragma once
+
+#include "olcPixelGameEngine.h"
+
+#include <string>
+#include <vector>
+
+#include "gamemap.hpp"
+#include "planner.hpp"
+
+/**
+ * @brief Table of the optimal first move from every tile towards every other tile
+ *
+ * For each source tile, the first moves towards all targets are laid out
+ * along a depth-first ordering of the tiles (so that nearby targets tend to
+ * share a first move) and run-length compressed.  Targets which can't be
+ * reached from the source are "don't care" entries and simply extend the
+ * current run.
+ *
+ * A path is then extracted one move at a time with no search at all.
+ *
+ * The on-disk format is a fixed header followed by flat uint32 arrays, so a
+ * saved database is used in place through mmap() rather than read in.
+ */
+class CompressedPathDatabase
+{
+public:
+    CompressedPathDatabase() { };
+    ~CompressedPathDatabase();
+
+    CompressedPathDatabase(const CompressedPathDatabase&) = delete;
+    CompressedPathDatabase& operator=(const CompressedPathDatabase&) = delete;
+
+    //! Run a first-move Dijkstra search from every tile, spread over all cores
+    void Build(const EffortGrid& grid);
+
+    bool Save(const std::string& fname) const;
+
+    //! Map a saved database into memory.  Fails if it was built for a different map.
+    bool Load(const std::string& fname, const EffortGrid& grid);
+
+    bool IsBuilt() const { return nNodes > 0; }
+
+    /**
+     * @brief Get the first move on an optimal path between two local tile indices
+     *
+     * @return Neighbor index into EffortGrid::DX/DY, or -1 if there is no path
+     */
+    int FirstMove(int source, int target) const;
+
+    size_t GetNumRuns() const { return nRuns; }
+
+private:
+    static constexpr uint32_t NO_COMPONENT = 0xFFFFFFFF;
+
+    int nNodes {0};
+    olc::vi2d dims {0, 0};
+    size_t nRuns {0};
+
+    // Views onto either the owned arrays below or the memory-mapped file
+    const uint32_t* order {nullptr};   //!< Position of each tile in the DFS ordering
+    const uint32_t* comp {nullptr};    //!< Connected component of each tile
+    const uint32_t* offsets {nullptr}; //!< Start of each source tile's runs
+    const uint32_t* runs {nullptr};    //!< (start position << 4) | move
+
+    std::vector<uint32_t> ownOrder, ownComp, ownOffsets, ownRuns;
+    uint64_t mapHash {0};
+
+    void* mapping {nullptr};
+    size_t mappingSize {0};
+
+    void Unmap();
+};
+
+//! Planner which extracts paths on a static map from a CompressedPathDatabase
+class CPDPlanner : public Planner
+{
+public:
+    /**
+     * @param cacheFile If non-empty, map the database from this file when it
+     *                  is valid for the map, or save it there once built
+     */
+    CPDPlanner(const std::string& cacheFile = "") : cacheFile(cacheFile) { };
+
+    void SetTerrainMap(GameMap& map) override;
+
+    bool ComputePath(WorldPos start, WorldPos goal) override;
+
+    PathView GetPath() override;
+    float GetPathCost() override { return path_cost; }
+
+private:
+    GameMap* map {nullptr};
+
+    std::string cacheFile;
+    EffortGrid grid;
+    CompressedPathDatabase cpd;
+
+    float path_cost {-1.f};
+    int expansions {0};
+    std::vector<WorldPos> final_path;
+};
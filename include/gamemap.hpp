@@ -11,6 +11,16 @@
 #include "olcPixelGameEngine.h"
 #include "util.hpp"
 #include "tileset.hpp"
+#include "mapfile.hpp"
+#include "mapimage.hpp"
+#include "maptmx.hpp"
+#include "chunkpool.hpp"
+#include "chunkstore.hpp"
+#include "chunktable.hpp"
+#include "morton.hpp"
+
+#include <functional>
+#include <memory>
 
 //! The terrain types available in my reduced tileset
 enum TERRAIN_TYPE
@@ -26,13 +36,115 @@ enum TERRAIN_TYPE
 
 #define CHUNK_SIZE 32
 
+#ifdef CHUNK_ZORDER
+static_assert((CHUNK_SIZE & (CHUNK_SIZE - 1)) == 0, "Z-order chunks must be a power of two in size");
+#endif
+
+#define SQRT2 1.41421356f
+
+/**
+ * @brief A square block of tiles, loaded and dropped as a unit as the map scrolls
+ *
+ * Tiles are row-major, or in Z-order (Morton order) when built with
+ * CHUNK_ZORDER, so that tiles near in any direction are near in memory.
+ * Always go through IndexOf() / LocalOf() rather than assume either.
+ *
+ * The tiles and their efforts live in the map's ChunkPool, not the chunk.
+ */
 struct MapChunk
 {
-    olc::vi2d coord {0, 0};
+    WorldPos coord {0, 0};   //!< World I,J coordinates of the top-left tile
     olc::vi2d dims {CHUNK_SIZE, CHUNK_SIZE};
-    std::vector<Tile> tiles;
+    Tile* tiles {nullptr};   //!< The chunk's tiles
+    float* effort {nullptr}; //!< Effort of each tile, by the same index as 'tiles'
+    int slot {-1};           //!< Slot of the tiles in the ChunkPool
+    uint64_t version {0};    //!< Map version at which the chunk was loaded or last edited
+
+    int NumTiles() const { return dims.x * dims.y; }
+
+    //! Index into 'tiles' of local tile (i, j)
+    int IndexOf(int i, int j) const {
+#ifdef CHUNK_ZORDER
+        return (int)MortonEncode(i, j);
+#else
+        return j * dims.x + i;
+#endif
+    }
+
+    //! Local (i, j) of the tile at an index into 'tiles'
+    olc::vi2d LocalOf(int idx) const {
+#ifdef CHUNK_ZORDER
+        uint32_t i, j;
+        MortonDecode(idx, i, j);
+        return {(int)i, (int)j};
+#else
+        return {idx % dims.x, idx / dims.x};
+#endif
+    }
+};
+
+/**
+ * @brief Dense snapshot of the per-tile effort over a rectangular window of the map
+ *
+ * Tiles are addressed by their flattened local index (j*dims.x + i), where
+ * 'origin' is the world I,J coordinate of local tile (0,0).  World
+ * coordinates are 64-bit, but a grid is small enough that anything relative
+ * to its origin, and so every planner's indices, stays 32-bit.
+ */
+struct EffortGrid
+{
+    WorldPos origin {0, 0};    //!< World I,J coordinates of the top-left tile
+    olc::vi2d dims {0, 0};     //!< Number of tiles along x and y
+    std::vector<float> effort; //!< Effort required to enter each tile (< 0 if impassable)
+    uint64_t version {0};      //!< Version of the map the snapshot was taken from; 0 if none
+
+    //! Neighbor offsets and step lengths; T/B/L/R; TL/TR/BL/BR
+    static constexpr int NN = 8;
+    static constexpr int DX[NN] = {0, 0, -1, 1, -1, 1, -1, 1};
+    static constexpr int DY[NN] = {-1, 1, 0, 0, -1, -1, 1, 1};
+    static constexpr float STEP[NN] = {1.f, 1.f, 1.f, 1.f, SQRT2, SQRT2, SQRT2, SQRT2};
+
+    int Size() const { return dims.x * dims.y; }
+
+    bool Contains(const WorldPos& loc) const {
+        return loc.x >= origin.x && loc.x < origin.x + dims.x &&
+               loc.y >= origin.y && loc.y < origin.y + dims.y;
+    }
+
+    int IndexOf(const WorldPos& loc) const {
+        return (int)(loc.y - origin.y) * dims.x + (int)(loc.x - origin.x);
+    }
+
+    WorldPos LocOf(int idx) const {
+        return origin + WorldPos({idx % dims.x, idx / dims.x});
+    }
+
+    //! Hash of the dimensions and effort values, to validate precomputed data
+    uint64_t Hash() const;
+};
+
+//! What happened to the map, as reported to GameMap's subscribers
+enum MapChangeKind
+{
+  TERRAIN_EDITED, //!< A batch of terrain edits was applied
+  CHUNK_ADDED,    //!< A chunk was loaded as the view moved
+  CHUNK_REMOVED,  //!< A chunk was unloaded as the view moved
+  MAP_GENERATED   //!< The whole map was (re)generated
+};
+
+//! One change to the map, as reported to GameMap's subscribers
+struct MapChange
+{
+    MapChangeKind kind {TERRAIN_EDITED};
+    uint64_t version {0};          //!< Version of the map after the change
+    WorldPos tl {0, 0};            //!< Top-left tile of the smallest rectangle holding every changed tile
+    WorldPos br {0, 0};            //!< One past the bottom-right tile of that rectangle
+    std::vector<WorldPos> chunks;  //!< Loaded chunks (by top-left tile) holding any changed tile
+    int nTiles {0};                //!< Number of tiles edited, loaded or unloaded
 };
 
+using MapCallback = std::function<void(const MapChange&)>;
+
 //! Class to load the desired map terrain, a tileset, and display the map
 class GameMap
 {
@@ -48,26 +160,120 @@ public:
 
     void SetPGE(olc::PixelGameEngine* _pge) { pge = _pge; }
 
+    /**
+     * @brief Set the size of the view (in pixels) when running without a PGE
+     *
+     * Without a PixelGameEngine no textures are made, so the map can be used
+     * headless, e.g. for benchmarking the planners.
+     */
+    void SetViewSize(olc::vi2d size) { viewSize = size; }
+
     olc::vi2d GetDims() { return dims; }
 
-    void Draw(const olc::vi2d& offset);
+    /**
+     * @brief Write the terrain of a static map to a binary map file
+     *
+     * The file can then be given as 'mapFile' in place of the map's YAML
+     * 'map', and is memory-mapped rather than parsed.  Edits aren't saved.
+     */
+    bool SaveMapFile(const std::string& fname);
+
+    //! Draw the map relative to the camera (the world pixel at the top-left of the screen), then follow it
+    void Draw(const WorldPos& camera);
+
+    /**
+     * @brief Load and drop chunks as needed for a view with the camera at the given world pixel
+     *
+     * Called by Draw(); call it directly to scroll the map when running headless.
+     */
+    void UpdateView(const WorldPos& camera);
+
+    uint8_t GetLayerAt(int64_t ix, int64_t iy);
+    TERRAIN_TYPE GetTerrainAt(int64_t ix, int64_t iy);
+    float GetEffortAt(int64_t ix, int64_t iy);
+
+    //! Smallest effort of any passable terrain type, or of any tile given its own effort
+    float GetMinEffort() const { return minEffort; }
+
+    /**
+     * @brief Change the terrain of a tile, e.g. to pave a road or flood a field
+     *
+     * The tile also takes on the new terrain's effort, dropping any set with
+     * SetEffortAt().  Edits outlive the chunks they're in, so a chunk which
+     * scrolls out of view and back keeps them.
+     */
+    void SetLayerAt(int64_t ix, int64_t iy, uint8_t layer);
+    void SetTerrainAt(int64_t ix, int64_t iy, TERRAIN_TYPE type);
+
+    //! Change the effort of a tile without changing its terrain (< 0 for impassable)
+    void SetEffortAt(int64_t ix, int64_t iy, float effort);
+
+    /**
+     * @brief Hold back edits until the matching EndEdits(), then apply them all at once
+     *
+     * Outside of a batch, each edit is applied straight away.  Batches may be nested.
+     */
+    void BeginEdits() { editDepth++; }
+    void EndEdits();
+
+    /**
+     * @brief Be told of each change to the map once it has been made
+     *
+     * That is, each batch of edits, each chunk loaded or unloaded as the view
+     * moves, and each call to GenerateMap().
+     *
+     * @return ID to pass to Unsubscribe()
+     */
+    int Subscribe(MapCallback callback);
+    void Unsubscribe(int id);
+
+    /**
+     * @brief Version of the map, which changes along with the terrain or the chunk window
+     *
+     * Versions are drawn from a counter shared by every map, so a version is
+     * never that of a different map and 0 is never a version.  Anything
+     * derived from the map can be checked against it in O(1).
+     */
+    uint64_t GetVersion() const { return version; }
+
+    //! Version of the map as of the last terrain edit or GenerateMap(), ignoring the chunk window
+    uint64_t GetTerrainVersion() const { return terrainVersion; }
+
+    //! Version of the map as of when a chunk was loaded or last edited; 0 if it isn't loaded
+    uint64_t GetChunkVersion(const WorldPos& start) const;
+
+    /**
+     * @brief Copy the effort of every tile in the active chunk window into 'grid'
+     *
+     * Much cheaper than calling GetEffortAt() per tile, as each chunk is only
+     * visited once.  Tiles not covered by a loaded chunk are impassable.
+     */
+    void GetEffortGrid(EffortGrid& grid);
+
+    /**
+     * @brief Copy the effort of every tile of a static map into 'grid'
+     *
+     * Covers the full map dimensions, whether or not the chunks are loaded,
+     * so the grid takes the map's terrain version rather than its version.
+     */
+    void GetStaticEffortGrid(EffortGrid& grid);
 
-    uint8_t GetLayerAt(int ix, int iy);
-    TERRAIN_TYPE GetTerrainAt(int ix, int iy);
-    float GetEffortAt(int ix, int iy);
+    std::array<WorldPos, 2> GetChunkExtents() { return {chidTL, chidBR + WorldPos({ChunkSize.x, ChunkSize.y})}; }
 
-    std::array<olc::vi2d, 2> GetChunkExtents() { return {chidTL, chidBR + ChunkSize}; }
+    //! Use of the pool the chunks' tiles are kept in
+    ChunkPoolStats GetChunkPoolStats() const { return chunkPool.GetStats(); }
 
 private:
     std::map<olc::vi2d, Tile> map;
-    std::map<olc::vi2d, MapChunk> chunks;
+    ChunkTable<MapChunk> chunks;
+    ChunkPool chunkPool {CHUNK_SIZE * CHUNK_SIZE};
     const olc::vi2d ChunkSize {CHUNK_SIZE, CHUNK_SIZE};
-    olc::vi2d chidTL; //!< overall top-left index of all active chunks
-    olc::vi2d chidBR; //!< overall bottom-right index of all active chunks
+    WorldPos chidTL; //!< overall top-left index of all active chunks
+    WorldPos chidBR; //!< overall bottom-right index of all active chunks
 
     olc::vi2d dims {0, 0}; //!< Dimensions of the overall map. TODO: Use only for static maps.
-    olc::vi2d idxTL {}; //!< Top-left tile coordinate on the screen
-    olc::vi2d idxBR {}; //!< Btm-right tile coordinate on the screen
+    WorldPos idxTL {}; //!< Top-left tile coordinate on the screen
+    WorldPos idxBR {}; //!< Btm-right tile coordinate on the screen
     Config config;
 
     /**
@@ -76,11 +282,73 @@ private:
      * The chunk will be created with a top-left index of 'start'
      * and x,y extents (in number of tile) of 'dims'
      */
-    void AddChunk(olc::vi2d start, olc::vi2d dims);
+    void AddChunk(WorldPos start, olc::vi2d dims);
+
+    void RemoveChunk(WorldPos start);
+
+    //! Terrain edits waiting for the end of the current batch
+    struct PendingEdit
+    {
+        WorldPos loc;
+        bool isLayer;   //!< Whether this sets the layer, or else just the effort
+        uint8_t layer;
+        float effort;
+    };
+
+    std::vector<PendingEdit> pendingEdits;
+    int editDepth {0};
+
+    //! Every edit made so far, overriding the generated terrain
+    std::map<WorldPos, uint8_t> layerEdits;
+    std::map<WorldPos, float> effortEdits;
+
+    std::map<int, MapCallback> subscribers;
+    int nextSubscriber {0};
+
+    uint64_t version {NextVersion()};
+    uint64_t terrainVersion {version};
 
-    void RemoveChunk(olc::vi2d start);
+    //! Take a new version from the counter shared by every map
+    static uint64_t NextVersion();
+
+    //! Tell the subscribers of a change to the map
+    void Notify(const MapChange& change);
+
+    //! Describe the loading or unloading of a chunk (less the version), reusing the change's storage
+    void ChunkChange(MapChange& change, MapChangeKind kind, WorldPos start, olc::vi2d size) const;
+
+    //! Kept from one move of the view to the next, so that moving it needn't allocate
+    std::vector<WorldPos> dropChunks;
+    std::vector<MapChange> viewChanges;
+
+    //! Number of chunks across and down the chunk window for the view
+    olc::vi2d ViewChunks() const;
+
+    //! Apply the pending edits to the loaded tiles and tell the subscribers
+    void CommitEdits();
+
+    //! Top-left tile of the chunk holding a location
+    WorldPos ChunkOf(WorldPos loc) const;
+
+    //! The loaded chunk holding a location, and the location's index in it; nullptr if not loaded
+    MapChunk* FindChunk(WorldPos loc, int& index);
+
+    //! The loaded tile at a location; nullptr if its chunk isn't loaded
+    Tile* FindTile(WorldPos loc);
+
+    //! Effort of a tile with the given layer, including any edits
+    float EffortOf(WorldPos loc, uint8_t layer) const;
+
+    //! Pick a tile's texture from the layers at its four corners
+    void UpdateTexture(Tile& tile);
 
     olc::PixelGameEngine* pge {nullptr};
+    olc::vi2d viewSize {0, 0}; //!< View size in pixels, if there's no PGE
+
+    //! Size of the view in pixels
+    olc::vi2d GetViewSize() const {
+        return pge ? olc::vi2d({pge->ScreenWidth(), pge->ScreenHeight()}) : viewSize;
+    }
 
     static constexpr uint8_t N_LAYERS = 5;
 
@@ -93,10 +361,61 @@ private:
     /// we here should be able to remap the types onto different layers
     /// (So e.g. dirt can be layered on top of pavers, or vice-versa)    static constexpr uint8_t N_LAYERS = 5;
     const uint8_t layers[N_LAYERS+1] {WATER, GRASS, DIRT, GRAVEL, PAVERS, NONE};
+
+    //! Colour of each layer in a terrain image, unless the config gives its own
+    const olc::Pixel layerColors[N_LAYERS] {
+        {48, 96, 192}, {64, 160, 64}, {140, 100, 60}, {128, 128, 128}, {210, 200, 170}
+    };
+
+    //! Layer of each of the LPC terrains in a Tiled map, by a part of its name, after any from the config
+    const std::vector<std::pair<std::string, uint8_t>> tmxTerrains {
+        {"Water", 0}, {"Hole", 0}, {"Lava", 0}, {"Grass", 1}, {"Mudstone", 4}, {"Stone", 4},
+        {"Gravel", 3}, {"Rock", 3}, {"Snow", 3}, {"Ice", 3}, {"Dirt", 2}, {"Mud", 2}, {"Soil", 2},
+        {"Sand", 2}, {"Earth", 2}
+    };
     TileSet* tileSet {nullptr};
     std::vector<float> tRangeSums;
 
+    //! Layers of a procedural map, generated a chunk-sized block at a time: the slot of each block, by top-left tile
+    ChunkTable<int> noiseBlocks;
+    std::vector<WorldPos> noiseOrder;  //!< Block in each slot, in the order they were made, to drop the oldest
+    size_t noiseOldest {0};            //!< Slot of the oldest block, once they're all in use
+    static constexpr size_t MAX_NOISE_BLOCKS = 4096;
+    static constexpr size_t NOISE_SLAB_BLOCKS = 64;
+
+    //! Storage of the blocks' layers, NOISE_SLAB_BLOCKS slots at a time; kept when the map is regenerated
+    std::vector<std::unique_ptr<uint8_t[]>> noiseSlabs;
+
+    //! The block last looked up, as tiles are mostly looked up next to each other
+    WorldPos lastNoiseStart {0, 0};
+    const uint8_t* lastNoiseBlock {nullptr};
+
+    //! Blocks kept on disk across runs, if enabled
+    ChunkStore* chunkStore {nullptr};
+
+    //! Layers of the block of a procedural map starting at a tile, row-major; read back or generated as needed
+    const uint8_t* NoiseBlock(WorldPos start);
+
+    //! Layer of a tile of a procedural map, from the noise
+    uint8_t NoiseLayerAt(int64_t ix, int64_t iy);
+
+    //! Hash of everything a procedural map's layers are generated from
+    uint64_t NoiseKey() const;
+
+    //! Layer of every tile of a static map, from the YAML map, a binary map file, an image or a Tiled map
+    TiledTerrain terrain;
+    uint8_t fileLayer[256] {}; //!< Our layer for each of the terrain's layer values
+
+    //! Set up the terrain of a static map, from the config, a binary map file, an image or a Tiled map
+    bool LoadStaticMap();
+
     const std::map<TERRAIN_TYPE, float> teffort {
         {GRASS, 3.f}, {WATER, -1.f}, {DIRT, 10.f}, {GRAVEL, 20.f}, {PAVERS, 1.f}, {NONE, -1.f}
     };
+
+    //! Smallest effort of any passable terrain type
+    float TerrainMinEffort() const;
+
+    //! Smallest effort of any passable terrain type or edited tile; kept up to date by CommitEdits()
+    float minEffort {TerrainMinEffort()};
 };
@@ -0,0 +1,212 @@
+/**
+ * @File: hdastar.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Hash-Distributed A* (HDA*): a single A* query split across threads
+ */
+#pragma once
+
+#include "olcPixelGameEngine.h"
+
+#include <atomic>
+#include <cfloat>
+#include <memory>
+#include <vector>
+
+#include "gamemap.hpp"
+#include "openlist.hpp"
+#include "planner.hpp"
+#include "workerpool.hpp"
+
+/**
+ * @brief Intrusive lock-free multi-producer, single-consumer queue
+ *
+ * Any thread may Push(); only the owning thread may Pop().  Items are linked
+ * through their own 'next' pointer, so the queue never allocates.
+ * (After Dmitry Vyukov's non-intrusive MPSC queue.)
+ */
+template <class T>
+class MPSCQueue
+{
+public:
+    MPSCQueue() : head(&stub), tail(&stub) { stub.next.store(nullptr); }
+
+    void Push(T* item) {
+        item->next.store(nullptr, std::memory_order_relaxed);
+        T* prev = head.exchange(item, std::memory_order_acq_rel);
+        prev->next.store(item, std::memory_order_release);
+    }
+
+    //! Take the oldest item, or nullptr if there is none (or a Push is only half done)
+    T* Pop() {
+        T* t = tail;
+        T* next = t->next.load(std::memory_order_acquire);
+        if (t == &stub) {
+            if (!next) return nullptr;
+            tail = next;
+            t = next;
+            next = next->next.load(std::memory_order_acquire);
+        }
+
+        if (next) {
+            tail = next;
+            return t;
+        }
+
+        if (t != head.load(std::memory_order_acquire)) return nullptr;
+
+        // 't' is the last item; put the stub behind it so it can be unlinked
+        Push(&stub);
+        next = t->next.load(std::memory_order_acquire);
+        if (next) {
+            tail = next;
+            return t;
+        }
+
+        return nullptr;
+    }
+
+private:
+    alignas(64) std::atomic<T*> head; //!< Most recently pushed item; shared by the producers
+    alignas(64) T* tail;              //!< Next item to pop; owned by the consumer
+    T stub;
+};
+
+/**
+ * @brief Parallel A* for single long-range queries
+ *
+ * Each tile is owned by one worker thread, chosen by hashing the tile's 8x8
+ * block, and only its owner ever reads or writes its search state.  Workers
+ * expand their own open lists and send each generated neighbour to its owner
+ * in batches through that owner's lock-free inbox.  Once a path has been found
+ * the workers keep going until no open node could still improve on it and no
+ * messages are in flight, so the path is optimal just as with AStar.
+ *
+ * Batches go back to the worker which allocated them once they've been read,
+ * and the worker threads are kept between queries, so a warmed-up search
+ * makes no allocations of its own.
+ *
+ * With a heuristic weight w = 1 + epsilon, nodes are ordered and pruned by
+ * g + w*h instead.  Any node on the optimal path left unexpanded then has
+ * g + w*h <= w*(g + h) <= w * optimum, which bounds the incumbent's cost.
+ */
+class HDAStar : public Planner
+{
+public:
+    /**
+     * @param nThreads     Number of worker threads; 0 to use one per core
+     * @param heuristic    Distance heuristic to guide the search with
+     * @param connectivity Number of neighbors of each tile (4 or 8)
+     * @param epsilon      Suboptimality bound: paths cost at most (1 + epsilon)
+     *                     times the optimum, in exchange for fewer expansions
+     */
+    HDAStar(int nThreads = 0, HeuristicType heuristic = EFFORT_OCTILE, int connectivity = 8,
+            float epsilon = 0.f);
+
+    ~HDAStar();
+
+    void SetTerrainMap(GameMap& map) override;
+
+    bool ComputePath(WorldPos start, WorldPos goal) override;
+
+    PathView GetPath() override;
+    float GetPathCost() override { return path_cost; }
+
+    int GetNumThreads() const { return nThreads; }
+
+private:
+    static constexpr int BATCH_SIZE = 64;     //!< Nodes per message between workers
+    static constexpr int FLUSH_INTERVAL = 16; //!< Expansions between flushes of partial batches
+
+    //! A generated node, sent to the worker which owns it
+    struct Message
+    {
+        int32_t idx;    //!< Index of the node in 'grid'
+        int32_t parent; //!< Index of the node it was reached from
+        float g;        //!< Cost from the start by way of 'parent'
+    };
+
+    struct Batch
+    {
+        std::atomic<Batch*> next {nullptr};
+        int owner {0}; //!< Worker which allocated the batch, and gets it back once it's read
+        int count {0};
+        Message msgs[BATCH_SIZE];
+    };
+
+    //! State of one worker thread, padded to keep workers off each other's cache lines
+    struct alignas(64) Worker
+    {
+        int id {0};
+        MPSCQueue<Batch> inbox;
+        MPSCQueue<Batch> spare;      //!< This worker's batches, handed back once read
+        std::atomic<bool> idle {false};
+        DepthHeap open;              //!< This worker's open nodes
+        std::vector<Batch*> outbox;  //!< Partly-filled batch for each other worker
+        std::vector<std::unique_ptr<Batch>> batches; //!< Every batch this worker has allocated
+        QueryContext context;        //!< Counts this worker's allocations during a query
+        int expansions {0};
+    };
+
+    GameMap* map {nullptr};
+
+    int nThreads {1};
+    HeuristicType heuristic {EFFORT_OCTILE};
+    int connectivity {8};
+    float weight {1.f}; //!< Heuristic weight (1 + epsilon), as in weighted A*
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    WorkerPool pool; //!< After 'workers', so that its threads are stopped first
+
+    EffortGrid grid;            //!< Effort of each tile in the loaded window
+    std::vector<float> gval;    //!< Best known cost of each tile; written only by its owner
+    std::vector<int32_t> parent; //!< Previous tile on the best path; written only by its owner
+    WorldPos goal {0, 0};
+    int gInd {-1};
+
+    alignas(64) std::atomic<float> incumbent {FLT_MAX}; //!< Cost of the best path found so far
+    alignas(64) std::atomic<int64_t> sent {0};           //!< Nodes handed to another worker's inbox
+    alignas(64) std::atomic<int64_t> received {0};       //!< Nodes taken back out and processed
+    alignas(64) std::atomic<bool> done {false};
+
+    float path_cost {-1.f};
+    int expansions {0};
+
+    std::vector<WorldPos> final_path;
+
+    //! Index of the worker which owns the given tile
+    int OwnerOf(int idx) const;
+
+    //! Pick the Work() specialisation for the chosen heuristic and connectivity
+    template <class Heuristic>
+    void Dispatch(const Heuristic& hval);
+
+    //! Run the workers on this and the pool's other threads until the search is done
+    template <int NN, class Heuristic>
+    void Run(const Heuristic& hval);
+
+    //! Main loop of each worker thread
+    template <int NN, class Heuristic>
+    void Work(int tid, const Heuristic& hval);
+
+    //! Offer a worker a new route to one of its own tiles
+    template <class Heuristic>
+    void Relax(Worker& w, int idx, int from, float g, const Heuristic& hval);
+
+    //! Hand off a node to the worker which owns it
+    void Send(Worker& w, int dest, int idx, int from, float g);
+
+    //! Post every partly-filled batch to its owner's inbox
+    void Flush(Worker& w);
+
+    /**
+     * @brief True once every worker is idle and every message has been processed
+     *
+     * Reads 'received' before the idle flags and 'sent' after them.  As a
+     * worker clears its idle flag before counting a message as received, and
+     * only sets it once its own messages are counted as sent, sent == received
+     * means nothing was in flight or being worked on in between.
+     */
+    bool Quiescent() const;
+};
@@ -0,0 +1,76 @@
+/**
+ * @File: heuristics.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Family of admissible distance heuristics for the grid planners
+ *
+ *     Each heuristic is a small functor, so that planners templated on
+ *     the heuristic get it fully inlined into their inner loop.
+ */
+#pragma once
+
+#include "olcPixelGameEngine.h"
+
+#include "gamemap.hpp"
+#include "landmarks.hpp"
+
+// Manhattan Distance
+inline float Manhattan(const WorldPos& t1, const WorldPos& t2)
+{
+    const int64_t dx = std::abs(t1.x - t2.x);
+    const int64_t dy = std::abs(t1.y - t2.y);
+    return static_cast<float>(dx + dy);
+}
+
+// 'Diagonal Distance' (Straight lines and diagonals allowed)
+inline float Diagonal(const WorldPos& t1, const WorldPos& t2)
+{
+    // Here we assume we follow a 45deg diagonal,
+    // then a straignt line
+    const int64_t dx = std::abs(t1.x - t2.x);
+    const int64_t dy = std::abs(t1.y - t2.y);
+    const int64_t mind = std::min(dx, dy);
+    const int64_t maxd = std::max(dx, dy);
+    return SQRT2 * (float)mind + (float)(maxd - mind);
+}
+
+//! Manhattan distance.  Only admissible with 4-connectivity.
+struct ManhattanDist
+{
+    float operator()(const WorldPos& t1, const WorldPos& t2) const { return Manhattan(t1, t2); }
+};
+
+//! Octile ('Diagonal') distance, ignoring terrain effort
+struct OctileDist
+{
+    float operator()(const WorldPos& t1, const WorldPos& t2) const { return Diagonal(t1, t2); }
+};
+
+/**
+ * @brief Octile distance with every step costing at least the cheapest terrain
+ *
+ * Each move costs its length plus the effort of the tile entered, and at
+ * least max(dx, dy) tiles must be entered to reach the goal.
+ */
+struct EffortOctileDist
+{
+    float minEffort {0.f}; //!< Smallest effort of any passable terrain
+
+    float operator()(const WorldPos& t1, const WorldPos& t2) const {
+        const int64_t maxd = std::max(std::abs(t1.x - t2.x), std::abs(t1.y - t2.y));
+        return Diagonal(t1, t2) + minEffort * (float)maxd;
+    }
+};
+
+//! Tighten any of the above with an ALT landmark lower bound
+template <class Heuristic>
+struct LandmarkDist
+{
+    Heuristic base;
+    const ALTHeuristic* alt {nullptr};
+
+    float operator()(const WorldPos& t1, const WorldPos& t2) const {
+        return std::max(base(t1, t2), alt->Eval(t1, t2));
+    }
+};
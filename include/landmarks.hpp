@@ -0,0 +1,82 @@
+/**
+ * @File: landmarks.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     ALT (A*, Landmarks, Triangle inequality) heuristic over the active map window
+ */
+#pragma once
+
+#include "olcPixelGameEngine.h"
+
+#include <vector>
+
+#include "gamemap.hpp"
+
+/**
+ * @brief Landmark-based admissible heuristic for any of the grid planners
+ *
+ * A handful of landmark tiles are chosen along the border of the active chunk
+ * window, and the true cost from each landmark to every tile in the window is
+ * precomputed with Dijkstra (one thread per landmark).  The triangle
+ * inequality then gives a lower bound on the cost between any two tiles which,
+ * unlike the plain Diagonal distance, accounts for terrain effort.
+ *
+ * Since the cost of a move only depends on the tile being entered, a single
+ * forward field per landmark is enough to bound the cost in both directions.
+ *
+ * As chunks stream in and out, or the terrain is edited, a landmark's field
+ * is repaired rather than recomputed: only the tiles whose cheapest path ran
+ * through a tile which changed or left the window, plus the tiles which
+ * joined it, are searched again.
+ */
+class ALTHeuristic
+{
+public:
+    ALTHeuristic(int nLandmarks = 8) : nLandmarks(nLandmarks) { };
+
+    /**
+     * @brief Refresh the landmark tables for the map's active chunk window
+     *
+     * O(1) when the map's version is unchanged, and still cheap when the
+     * window and its terrain come out the same as before.  Otherwise,
+     * landmarks which still lie along the border of the new window are kept
+     * and their distance fields repaired (see RepairCostField()); new ones are
+     * only picked for the remaining slots, and get full fields.  Each
+     * landmark's field is updated on a thread of its own.
+     *
+     * @return True if the tables were rebuilt
+     */
+    bool Update(GameMap& map);
+
+    /**
+     * @brief Lower bound on the cost of travelling from t1 to t2
+     *
+     * Returns 0 if either tile is outside of the window covered by the tables.
+     */
+    float Eval(const WorldPos& t1, const WorldPos& t2) const;
+
+    const std::vector<WorldPos>& GetLandmarks() const { return landmarks; }
+
+private:
+    int nLandmarks {8};
+
+    EffortGrid grid;
+    std::vector<WorldPos> landmarks; //!< World I,J coordinates of each landmark
+
+    //! Cost from each landmark to each tile, interleaved as [tile * nLandmarks + landmark]
+    std::vector<float> dist;
+
+    //! The same costs, one field per landmark, kept to be repaired by the next update
+    std::vector<std::vector<float>> fields;
+
+    void SelectLandmarks();
+
+    /**
+     * @brief Bring the distance fields up to date with 'grid' and 'landmarks'
+     *
+     * @param oldGrid      Snapshot the current fields were computed over
+     * @param oldLandmarks Landmarks the current fields belong to
+     */
+    void UpdateTables(const EffortGrid& oldGrid, const std::vector<WorldPos>& oldLandmarks);
+};
@@ -0,0 +1,410 @@
+/**
+ * @File: mapf.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Multi-agent path finding: collision-free paths for many agents at once,
+ *     using Conflict-Based Search over a space-time A*
+ */
+#pragma once
+
+#include "olcPixelGameEngine.h"
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "costfield.hpp"
+#include "gamemap.hpp"
+#include "landmarks.hpp"
+#include "openlist.hpp"
+#include "workerpool.hpp"
+
+//! One agent's request: where it starts, and where it wants to end up (and stay)
+struct MAPFAgent
+{
+    WorldPos start;
+    WorldPos goal;
+};
+
+//! Counters from the last MAPFSolver::Solve()
+struct MAPFStats
+{
+    int agents {0};
+    int failed {0};            //!< Agents left without a path
+    bool conflictFree {false}; //!< Whether no two paths collide
+    bool optimal {false};      //!< Whether CBS finished with no suboptimality allowed, so the sum of costs is optimal
+    float bound {0.f};         //!< (E)CBS finished, so the sum of costs is at most this times the optimum; 0 if not
+    float sumOfCosts {0.f};
+    int makespan {0};          //!< Timesteps until the last agent arrives
+    int ctNodes {0};           //!< Constraint-tree nodes expanded by CBS
+    int searches {0};          //!< Low-level (single-agent) searches run
+    long expansions {0};       //!< Space-time states expanded by all low-level searches
+    double msTotal {0.};
+    double msLowLevel {0.};    //!< Low-level search time, summed over all threads
+
+    double AgentsPerSecond() const { return msTotal > 0 ? 1000. * agents / msTotal : 0.; }
+    double SearchesPerSecond() const { return msTotal > 0 ? 1000. * searches / msTotal : 0.; }
+};
+
+//! Pack a tile and a time into a single 64-bit key
+inline uint64_t SpaceTimeKey(int idx, int t)
+{
+    return ((uint64_t)(uint32_t)t << 32) | (uint32_t)idx;
+}
+
+//! A move from tile 'from' to tile 'to' between times 't' and 't+1'
+struct SpaceTimeEdge
+{
+    int from, to, t;
+    bool operator==(const SpaceTimeEdge& o) const { return from == o.from && to == o.to && t == o.t; }
+};
+
+struct SpaceTimeEdgeHash
+{
+    size_t operator()(const SpaceTimeEdge& e) const {
+        return std::hash<uint64_t>()(SpaceTimeKey(e.from, e.t) ^ ((uint64_t)(uint32_t)e.to * 0x9E3779B97F4A7C15ull));
+    }
+};
+
+/**
+ * @brief Space-time reservations: which tiles, and which moves, are taken when
+ *
+ * Tiles are local indices into the solver's EffortGrid, and time is counted
+ * in whole steps; every move or wait takes one step.  The same table serves
+ * to hold the other agents' paths for prioritised planning, and each agent's
+ * constraints for CBS.
+ */
+class ReservationTable
+{
+public:
+    void Clear();
+
+    //! Take tile 'idx' at time 't'
+    void ReserveVertex(int idx, int t);
+
+    //! Take the move from tile 'from' to tile 'to' between times 't' and 't+1'
+    void ReserveEdge(int from, int to, int t);
+
+    //! Take tile 'idx' from time 't' onwards, for an agent which stays there
+    void ReserveGoal(int idx, int t);
+
+    /**
+     * @brief Reserve every tile along an agent's path, then its goal
+     *
+     * Each move is reserved in reverse, so that no other agent swaps places with it.
+     */
+    void ReservePath(const std::vector<int>& path);
+
+    //! Take tile 'idx' at every time, until Release(idx), from every agent but the one starting there
+    void Hold(int idx) { held.insert(idx); }
+
+    //! Give back a tile taken by Hold()
+    void Release(int idx) { held.erase(idx); }
+
+    //! Whether tile 'idx' is free at time 't', to the agent which started on tile 'own' (which it holds)
+    bool IsVertexFree(int idx, int t, int own = -1) const;
+
+    bool IsEdgeFree(int from, int to, int t) const;
+
+    //! Whether an agent could follow 'path' and then stay at its end for good; it may hold its start
+    bool IsPathFree(const std::vector<int>& path) const;
+
+    //! Latest time at which tile 'idx' is taken, other than held by 'own'; -1 if never, INT32_MAX if for good
+    int LastReservation(int idx, int own = -1) const;
+
+    //! Latest time of any reservation
+    int MaxTime() const { return maxTime; }
+
+    bool Empty() const { return vertices.empty() && edges.empty() && goals.empty() && held.empty(); }
+
+private:
+    std::unordered_set<uint64_t> vertices; //!< SpaceTimeKey()s
+    std::unordered_set<SpaceTimeEdge, SpaceTimeEdgeHash> edges;
+    std::unordered_map<int, int> goals; //!< Tile -> time from which it's taken for good
+    std::unordered_map<int, int> last;  //!< Tile -> latest time it's taken
+    std::unordered_set<int> held;       //!< Tiles taken at every time
+    int maxTime {0};
+};
+
+/**
+ * @brief How many of a set of paths are on each tile, and make each move, when
+ *
+ * For ECBS's low-level searches to steer clear of the other agents' paths,
+ * which unlike reservations they may still cross.  Paths stay on their last
+ * tile for good.
+ */
+class ConflictTable
+{
+public:
+    //! Count every one of the given paths, one per agent
+    void Build(const std::vector<std::shared_ptr<const std::vector<int>>>& paths);
+
+    //! Collisions of a move, or wait, from tile 'from' at time 't' onto 'to', with every path but the agent's own
+    int Count(int from, int to, int t, int agent) const;
+
+private:
+    std::vector<std::shared_ptr<const std::vector<int>>> paths;
+    std::unordered_map<uint64_t, int> vertices;                       //!< SpaceTimeKey() -> paths there
+    std::unordered_map<SpaceTimeEdge, int, SpaceTimeEdgeHash> moves;  //!< Move -> paths making it
+    std::unordered_map<int, int> parked;                              //!< Tile -> time from which a path stays on it
+};
+
+/**
+ * @brief A* over (tile, time) states, avoiding a set of reservations
+ *
+ * Each step the agent either waits (costing WAIT_COST) or moves as in the
+ * single-agent planners.  The goal only counts once the agent can stay on it
+ * for good.  Keeps its scratch space between searches; one per thread.
+ */
+class SpaceTimeAStar
+{
+public:
+    static constexpr float WAIT_COST = 1.f;
+
+    /**
+     * @param grid     Effort snapshot to search over
+     * @param start    Local index of the start tile
+     * @param goal     Local index of the goal tile
+     * @param hval     Lower bound on the cost from tile 'idx' to the goal, as hval(idx);
+     *                 FLT_MAX if it can't get there.  Has to be consistent.
+     * @param blocked  Reservations to avoid
+     * @param horizon  Latest time to search up to
+     * @param nn       Number of neighbors of each tile (4 or 8)
+     * @param path     [out] Tile at each time from 0 until the goal is reached
+     * @param cost     [out] Cost of the path
+     * @param deadline Time at which to give up, as if there were no path
+     */
+    template <class Heuristic>
+    bool Search(const EffortGrid& grid, int start, int goal, const Heuristic& hval,
+                const ReservationTable& blocked, int horizon, int nn, std::vector<int>& path, float& cost,
+                std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+    /**
+     * @brief Focal search: a path within 'weight' times the optimum, running into as few others as it can
+     *
+     * Of the open states whose f is within 'weight' of the lowest, expands
+     * the one whose path so far collides with the fewest of the counted
+     * paths (Barer et al., ECBS's low level).  States whose cost improves are
+     * reopened, so the lowest f stays a lower bound on the optimum.
+     *
+     * @param conflicts  Other agents' paths to steer clear of
+     * @param agent      The agent's own index in 'conflicts'
+     * @param weight     Suboptimality bound; 1 for an optimal path
+     * @param lowerBound [out] Lower bound on the cost of any path
+     *
+     * The other arguments are as for Search().
+     */
+    template <class Heuristic>
+    bool SearchFocal(const EffortGrid& grid, int start, int goal, const Heuristic& hval,
+                     const ReservationTable& blocked, const ConflictTable& conflicts, int agent,
+                     float weight, int horizon, int nn, std::vector<int>& path, float& cost, float& lowerBound,
+                     std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max());
+
+    int GetExpansions() const { return expansions; }
+
+private:
+    struct Node
+    {
+        int32_t idx;
+        int32_t t;
+        float g;
+        int32_t parent;    //!< Index of the previous node in 'nodes'
+        float f {0.f};         //!< SearchFocal() only, as are the rest
+        int32_t conflicts {0}; //!< Collisions along the path so far
+        bool closed {false};
+    };
+
+    //! A state waiting in the focal list; stale once its node's f or conflicts change, or it's closed
+    struct FocalEntry
+    {
+        int32_t conflicts;
+        float f;
+        float g;
+        int32_t idx;
+    };
+
+    std::vector<Node> nodes;
+    DepthHeap open; //!< Entries index 'nodes'
+    std::unordered_map<uint64_t, int32_t> visited; //!< (tile, time) -> index in 'nodes'
+    int expansions {0};
+
+    std::set<std::pair<float, int32_t>> openSet; //!< SearchFocal()'s open states, by f
+    std::vector<FocalEntry> focal;               //!< Heap of the open states within the bound
+};
+
+/**
+ * @brief Conflict-Based Search for many agents on the loaded map window
+ *
+ * CBS plans each agent alone, then looks for the earliest collision (two
+ * agents on one tile, or swapping tiles, at the same time).  It splits on it
+ * into two branches, each forbidding one of the two agents from being there
+ * then, replans that agent, and carries on with the cheapest branch until no
+ * collisions are left; the result then has the least possible sum of costs.
+ *
+ * With a suboptimality bound w = 1 + epsilon, this becomes Enhanced CBS
+ * (Barer et al. 2014).  Each replan is a focal search, for a path within w
+ * of that agent's optimum which collides with the fewest other paths.  The
+ * tree is searched the same way: of the nodes costing at most w times the
+ * lowest lower bound, the one with the fewest collisions goes first.  The
+ * solution then costs at most w times the optimum, and is usually found
+ * after far fewer splits.
+ *
+ * The initial plans run in parallel over the worker threads, and the two
+ * replans of each split on two of them.  If CBS runs past its time budget,
+ * the agents are instead planned in order of priority around each other's
+ * reservations, one per thread at a time, which is fast and collision-free
+ * but has no bound on its cost and isn't sure to find every path; an agent's
+ * initial plan is kept wherever it doesn't collide.  The threads are kept between solves.
+ *
+ * The low-level searches are guided by the exact cost to each goal: from a
+ * cost field over the whole window where there was time to build one, and
+ * otherwise from a LazyCostField, worked out only where the search looks.
+ */
+class MAPFSolver
+{
+public:
+    /**
+     * @param nThreads     Number of threads for the low-level searches; 0 to use one per core
+     * @param connectivity Number of neighbors of each tile (4 or 8)
+     * @param epsilon      Suboptimality bound: with ECBS, the sum of costs is at
+     *                     most (1 + epsilon) times the optimum; 0 for plain CBS
+     */
+    MAPFSolver(int nThreads = 0, int connectivity = 8, float epsilon = 0.f);
+
+    void SetTerrainMap(GameMap& map);
+
+    /**
+     * @brief Also aim the lazy cost fields with a landmark (ALT) heuristic
+     *
+     * The solver refreshes the landmark tables itself before each solve.
+     * Pass nullptr to go back to the effort-octile distance alone.
+     */
+    void SetLandmarks(ALTHeuristic* alt) { landmarks = alt; }
+
+    /**
+     * @brief Find collision-free paths for all the agents
+     *
+     * @param agents    Start and goal of every agent; no two may share a start, or a goal
+     * @param maxMillis Time budget for the whole solve; 0 for no limit.  The
+     *                  goals' cost fields get up to a quarter of it, and CBS
+     *                  up to half of the rest before falling back to
+     *                  prioritised planning; any agents which that hasn't
+     *                  planned by the end of it are left at their starts.
+     * @return Whether every agent got a collision-free path
+     */
+    bool Solve(const std::vector<MAPFAgent>& agents, int maxMillis = 0);
+
+    //! Tile at each time step of the given agent's path, from its start until it reaches its goal
+    const std::vector<WorldPos>& GetPath(int agent) const { return paths[agent]; }
+
+    const MAPFStats& GetStats() const { return stats; }
+
+private:
+    //! Forbid an agent from a tile at a time, or (if 'to' >= 0) from a move starting then
+    struct Constraint
+    {
+        int agent {-1};
+        int tile {-1};
+        int to {-1};
+        int t {0};
+    };
+
+    using Path = std::shared_ptr<const std::vector<int>>;
+
+    //! A node of the constraint tree; unchanged paths are shared with the parent
+    struct CTNode
+    {
+        int parent {-1};
+        Constraint constraint;
+        std::vector<Path> paths;
+        std::vector<float> costs;
+        std::vector<float> lowerBounds; //!< Of each agent's cost under the node's constraints
+        float cost {0.f};
+        float lowerBound {0.f};
+        int conflicts {0};
+    };
+
+    struct Conflict
+    {
+        int a1, a2;
+        int tile1, tile2; //!< Where a1 and a2 were (tile2 == tile1 for a vertex conflict)
+        int t;            //!< Time of a vertex conflict; start time of a swap
+        bool vertex;
+    };
+
+    GameMap* map {nullptr};
+    ALTHeuristic* landmarks {nullptr};
+
+    std::chrono::steady_clock::time_point deadline; //!< When the current stage of a solve has to finish by
+
+    int nThreads {1};
+    int connectivity {8};
+    float weight {1.f}; //!< Suboptimality bound (1 + epsilon); ECBS if over 1
+
+    //! Low-level search counters of one thread, padded to keep threads off each other's cache lines
+    struct alignas(64) SlotStats
+    {
+        double ms {0.};
+        long expansions {0};
+        int searches {0};
+    };
+
+    EffortGrid grid;
+    std::vector<int> starts, goals;
+    std::vector<const std::vector<float>*> hfields; //!< Cost to each agent's goal; null if there was no time to build it
+    std::vector<LazyCostField> lazyFields; //!< Cost to the goal of each agent without a full field
+    float minEffort {0.f};                 //!< Least effort of any tile, to aim the lazy fields with
+    std::unordered_map<int, std::vector<float>> fieldCache; //!< Goal tile -> cost field, kept while the map is unchanged
+    std::vector<std::unique_ptr<SpaceTimeAStar>> searches; //!< One per thread
+    std::vector<SlotStats> slotStats;                      //!< One per thread
+    WorkerPool pool; //!< After 'searches', so that its threads are stopped first
+
+    std::vector<std::vector<WorldPos>> paths;
+    MAPFStats stats;
+
+    bool OutOfTime() const { return std::chrono::steady_clock::now() > deadline; }
+
+    //! Lower bound on the cost from tile 'idx' to the agent's goal, without building any more of its field
+    float LowerBound(int agent, int idx) const;
+
+    /**
+     * @brief Plan one agent around the given reservations, with the given thread's search
+     *
+     * @param conflicts  For ECBS, the agents' paths to steer clear of; null for an optimal path
+     * @param lowerBound [out] If given, a lower bound on the cost of the agent's path
+     * @return False if there's no path, or if out of time
+     */
+    bool PlanAgent(int agent, const ReservationTable& blocked, int slot, std::vector<int>& path, float& cost,
+                   const ConflictTable* conflicts = nullptr, float* lowerBound = nullptr);
+
+    //! Gather the constraints on one agent along the tree from 'node' to the root
+    void GetConstraints(const std::vector<CTNode>& tree, int node, int agent, ReservationTable& table) const;
+
+    //! Count the collisions between the paths, and find the earliest
+    int FindConflicts(const std::vector<Path>& paths, Conflict& first) const;
+
+    /**
+     * @brief Run CBS, or ECBS, until the deadline, or for a fixed number of nodes if there is none
+     *
+     * @param result [out] The solution; if none was found, each agent's plan
+     *               made alone, or null where it has none
+     * @return False if CBS ran out of time or found no solution
+     */
+    bool SolveCBS(std::vector<Path>& result);
+
+    /**
+     * @brief Plan the agents in order of priority, each avoiding those before it
+     *
+     * Up to one agent per thread is planned at once; any whose path then
+     * collides with one settled before it is planned again.
+     *
+     * @param result [in,out] Paths to keep where they're still free, or null;
+     *               then the solution
+     */
+    bool SolvePrioritised(std::vector<Path>& result);
+};
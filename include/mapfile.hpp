@@ -0,0 +1,98 @@
+/**
+ * @File: mapfile.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Chunk-tiled terrain layers of a static map, and the binary map file
+ *     format which stores them as-is
+ */
+#pragma once
+
+#include "olcPixelGameEngine.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The terrain layer of every tile of a static map, stored chunk by chunk
+ *
+ * The map is cut into square chunks (a power of two on a side), laid out in
+ * row-major order, and each chunk holds its own tiles in row-major order; the
+ * chunks along the right and bottom edges are padded out to full size.  Each
+ * chunk's tiles are thus contiguous, whatever the width of the map.
+ *
+ * The binary map file is a fixed header, giving the dimensions, the chunk
+ * size and the terrain type of each layer value, followed by exactly these
+ * bytes; a file is used in place through mmap() rather than read in, so
+ * even a huge map opens instantly and only the parts visited are paged in.
+ */
+class TiledTerrain
+{
+public:
+    //! Max number of distinct layer values a map may use
+    static constexpr int MAX_TYPES = 16;
+
+    TiledTerrain() { };
+    ~TiledTerrain();
+
+    TiledTerrain(const TiledTerrain&) = delete;
+    TiledTerrain& operator=(const TiledTerrain&) = delete;
+
+    /**
+     * @brief Allocate (in memory) a map with every tile on layer 0
+     *
+     * @param dims      Number of tiles along x and y
+     * @param types     Terrain type (TERRAIN_TYPE) of each layer value
+     * @param chunkSize Tiles along each side of a chunk; must be a power of two
+     */
+    bool Create(olc::vi2d dims, const std::vector<uint8_t>& types, int chunkSize = 32);
+
+    //! Map a binary map file into memory, read-only
+    bool Load(const std::string& fname);
+
+    bool Save(const std::string& fname) const;
+
+    //! Read just the dimensions of the map in a binary map file
+    static bool ReadDims(const std::string& fname, olc::vi2d& dims);
+
+    bool IsLoaded() const { return data != nullptr; }
+
+    olc::vi2d GetDims() const { return dims; }
+    int GetChunkSize() const { return 1 << shift; }
+
+    //! Terrain type (TERRAIN_TYPE) of each layer value
+    const std::vector<uint8_t>& GetTypes() const { return types; }
+
+    //! Layer of a tile, which must be within the map
+    uint8_t Get(int ix, int iy) const { return data[Offset(ix, iy)]; }
+
+    //! Set the layer of a tile of a map made with Create()
+    void Set(int ix, int iy, uint8_t layer) { owned[Offset(ix, iy)] = layer; }
+
+    //! Row of a chunk's tiles; 'ix' is any tile along it, and the row runs to the end of the chunk
+    const uint8_t* Row(int ix, int iy) const { return data + Offset(ix, iy); }
+
+private:
+    olc::vi2d dims {0, 0};
+    int shift {5};          //!< log2 of the chunk size
+    int chunksX {0};        //!< Number of chunks along x
+    std::vector<uint8_t> types;
+
+    const uint8_t* data {nullptr}; //!< View onto either 'owned' or the memory-mapped file
+    std::vector<uint8_t> owned;
+
+    void* mapping {nullptr};
+    size_t mappingSize {0};
+
+    size_t Offset(int ix, int iy) const {
+        const int mask = (1 << shift) - 1;
+        const size_t chunk = (size_t)(iy >> shift) * chunksX + (ix >> shift);
+        return (chunk << (2 * shift)) + ((iy & mask) << shift) + (ix & mask);
+    }
+
+    //! Size in bytes of the tile data
+    size_t DataSize() const;
+
+    void Unmap();
+};
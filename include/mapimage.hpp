@@ -0,0 +1,42 @@
+/**
+ * @File: mapimage.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Import of static map terrain from PNG images
+ */
+#pragma once
+
+#include "olcPixelGameEngine.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mapfile.hpp"
+
+//! How the pixels of a terrain image translate to layer values
+struct ImageLegend
+{
+    //! Layer value of each palette index of an indexed image; empty to use the index itself
+    std::vector<uint8_t> palette;
+
+    //! Colour of each layer value; pixels of any other image take the nearest one
+    std::vector<olc::Pixel> colors;
+};
+
+//! Read just the dimensions of a PNG image
+bool ReadImageDims(const std::string& fname, olc::vi2d& dims);
+
+/**
+ * @brief Decode a PNG image into the terrain of a static map, one pixel per tile
+ *
+ * The image is decoded a strip of rows at a time, straight into the
+ * chunk-tiled terrain, so no copy of the whole image is ever held.
+ * Interlaced images can't be decoded that way, and are refused.
+ *
+ * @param types Terrain type (TERRAIN_TYPE) of each layer value; values past
+ *              the end are clamped to the last one
+ */
+bool LoadImageTerrain(const std::string& fname, const ImageLegend& legend, const std::vector<uint8_t>& types,
+                      TiledTerrain& terrain);
@@ -0,0 +1,47 @@
+/**
+ * @File: maptmx.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Import of static map terrain from Tiled (.tmx) maps
+ */
+#pragma once
+
+#include "olcPixelGameEngine.h"
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mapfile.hpp"
+
+//! How the terrains of a Tiled map's tilesets translate to layer values
+struct TmxLegend
+{
+    //! Layer value of each terrain whose name contains the given text; the first match wins
+    std::vector<std::pair<std::string, uint8_t>> terrains;
+
+    //! Layer value of tiles with no terrain, or with one matching none of the above
+    uint8_t fallback {0};
+};
+
+//! Read just the dimensions of a Tiled map
+bool ReadTmxDims(const std::string& fname, olc::vi2d& dims);
+
+/**
+ * @brief Load the terrain of a static map from a Tiled map, one Tiled tile per tile
+ *
+ * Each tile takes the terrain of its Tiled tile's bottom-right corner (as
+ * set in the tileset's terrain editor), as that is the corner our tiles keep
+ * the layer of; tiles are flipped as needed first.  Every tile layer of the
+ * map is read in order, and each tile of a later one overrides those below.
+ *
+ * The layer data may be CSV or base64, uncompressed or compressed with zlib
+ * or gzip.  The map is memory-mapped, and each layer decoded a block at a
+ * time straight into the chunk-tiled terrain.  Infinite maps aren't supported.
+ *
+ * @param types Terrain type (TERRAIN_TYPE) of each layer value
+ */
+bool LoadTmxTerrain(const std::string& fname, const TmxLegend& legend, const std::vector<uint8_t>& types,
+                    TiledTerrain& terrain);
@@ -0,0 +1,72 @@
+/**
+ * @File: morton.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Morton (Z-order) encoding of 2D indices
+ */
+#pragma once
+
+#include <cstdint>
+
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
+
+namespace morton {
+
+const uint32_t EVEN_BITS = 0x55555555;
+const uint32_t ODD_BITS = 0xAAAAAAAA;
+
+#ifndef __BMI2__
+//! Spread the low 16 bits of x out to the even bits
+inline uint32_t Spread(uint32_t x)
+{
+    x &= 0x0000FFFF;
+    x = (x | (x << 8)) & 0x00FF00FF;
+    x = (x | (x << 4)) & 0x0F0F0F0F;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+//! Gather the even bits of x back into the low 16 bits
+inline uint32_t Compact(uint32_t x)
+{
+    x &= 0x55555555;
+    x = (x | (x >> 1)) & 0x33333333;
+    x = (x | (x >> 2)) & 0x0F0F0F0F;
+    x = (x | (x >> 4)) & 0x00FF00FF;
+    x = (x | (x >> 8)) & 0x0000FFFF;
+    return x;
+}
+#endif
+
+} // namespace morton
+
+/**
+ * @brief Morton index of (i, j): the bits of i and j interleaved, i in the even bits
+ *
+ * Tiles close in 2D stay close in the 1D order, in every direction.  Both
+ * i and j must fit in 16 bits.  Uses BMI2's pdep when built for it.
+ */
+inline uint32_t MortonEncode(uint32_t i, uint32_t j)
+{
+#ifdef __BMI2__
+    return _pdep_u32(i, morton::EVEN_BITS) | _pdep_u32(j, morton::ODD_BITS);
+#else
+    return morton::Spread(i) | (morton::Spread(j) << 1);
+#endif
+}
+
+//! Inverse of MortonEncode(); uses BMI2's pext when built for it
+inline void MortonDecode(uint32_t m, uint32_t& i, uint32_t& j)
+{
+#ifdef __BMI2__
+    i = _pext_u32(m, morton::EVEN_BITS);
+    j = _pext_u32(m, morton::ODD_BITS);
+#else
+    i = morton::Compact(m);
+    j = morton::Compact(m >> 1);
+#endif
+}
@@ -0,0 +1,268 @@
+/**
+ * @File: openlist.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Interchangeable open lists (priority queues) for the A*-style planners
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <new>
+#include <set>
+#include <tuple>
+#include <vector>
+
+#include "arena.hpp"
+
+//! A node waiting in an open list
+struct OpenEntry
+{
+    float f;          //!< Priority: g + heuristic
+    uint32_t counter; //!< Insertion order, to break ties and to spot stale entries
+    int32_t idx;      //!< Index of the node
+};
+
+/**
+ * All open lists provide the same interface, so that a search can be
+ * specialised on any of them:
+ *
+ *   Reset(ctx)    Empty the list; any storage comes from the context's arena,
+ *                 or is reused and reports its growth to the context
+ *   Push(entry)   Add a node
+ *   Pop()         Remove and return the entry with the lowest 'f'
+ *   Empty()
+ *   Erase(entry)  Remove a node whose priority is being changed
+ *
+ * Lists which can't remove an arbitrary entry set LAZY, and leave the old
+ * entry in place instead; the search must then skip any popped entry whose
+ * counter no longer matches its node's.
+ */
+
+//! Balanced-tree open list: exact ordering with real decrease-key; O(log n)
+class SetOpenList
+{
+public:
+    static constexpr bool LAZY = false;
+
+    //! The old tree is dropped without being walked, as its nodes' memory
+    //! may have been reset and reused since by another query on the arena
+    void Reset(QueryContext& ctx) {
+        void* mem = ctx.arena.Allocate(sizeof(Set), alignof(Set));
+        set = new (mem) Set(ArenaAllocator<Key>(&ctx.arena));
+    }
+
+    void Push(const OpenEntry& e) { set->insert(Key(e.f, e.counter, e.idx)); }
+
+    OpenEntry Pop() {
+        const Key k = *set->begin();
+        set->erase(set->begin());
+        return {std::get<0>(k), std::get<1>(k), std::get<2>(k)};
+    }
+
+    bool Empty() const { return set->empty(); }
+
+    void Erase(const OpenEntry& e) { set->erase(Key(e.f, e.counter, e.idx)); }
+
+private:
+    using Key = std::tuple<float, uint32_t, int32_t>;
+    using Set = std::set<Key, std::less<Key>, ArenaAllocator<Key>>;
+    Set* set {nullptr}; //!< Lives in the arena, along with its nodes
+};
+
+//! Binary-heap open list: exact ordering, lazy decrease-key; O(log n) with little overhead
+class HeapOpenList
+{
+public:
+    static constexpr bool LAZY = true;
+
+    void Reset(QueryContext& ctx) {
+        heap.clear();
+        context = &ctx;
+    }
+
+    void Push(const OpenEntry& e) {
+        const size_t cap = heap.capacity();
+        heap.push_back(e);
+        context->Track(heap, cap);
+        std::push_heap(heap.begin(), heap.end(), Later);
+    }
+
+    OpenEntry Pop() {
+        std::pop_heap(heap.begin(), heap.end(), Later);
+        const OpenEntry e = heap.back();
+        heap.pop_back();
+        return e;
+    }
+
+    bool Empty() const { return heap.empty(); }
+
+    void Erase(const OpenEntry&) { }
+
+private:
+    std::vector<OpenEntry> heap; //!< Kept between searches to reuse its storage
+    QueryContext* context {nullptr};
+
+    //! Same order as SetOpenList: lowest 'f', then oldest first
+    static bool Later(const OpenEntry& a, const OpenEntry& b) {
+        return a.f > b.f || (a.f == b.f && a.counter > b.counter);
+    }
+};
+
+//! A node waiting in a DepthHeap
+struct DepthEntry
+{
+    float f;     //!< Priority: g + heuristic
+    float g;     //!< Cost of getting to the node
+    int32_t idx; //!< Index of the node
+};
+
+/**
+ * @brief Binary-heap open list for the searches which key their entries on 'g'
+ *
+ * Pops the lowest 'f' first, breaking ties towards the deeper node (the
+ * higher 'g').  Decrease-key is lazy, as for HeapOpenList: the search skips
+ * any popped entry whose 'g' is worse than its node's.
+ */
+class DepthHeap
+{
+public:
+    //! Empty the heap; its growth from now on is reported to 'ctx', if given
+    void Clear(QueryContext* ctx = nullptr) {
+        heap.clear();
+        context = ctx;
+    }
+
+    void Push(const DepthEntry& e) {
+        const size_t cap = heap.capacity();
+        heap.push_back(e);
+        if (context) {
+            context->Track(heap, cap);
+        }
+        std::push_heap(heap.begin(), heap.end(), Later);
+    }
+
+    //! The entry Pop() would return
+    const DepthEntry& Top() const { return heap.front(); }
+
+    DepthEntry Pop() {
+        std::pop_heap(heap.begin(), heap.end(), Later);
+        const DepthEntry e = heap.back();
+        heap.pop_back();
+        return e;
+    }
+
+    bool Empty() const { return heap.empty(); }
+
+private:
+    std::vector<DepthEntry> heap; //!< Kept between searches to reuse its storage
+    QueryContext* context {nullptr};
+
+    static bool Later(const DepthEntry& a, const DepthEntry& b) {
+        return a.f > b.f || (a.f == b.f && a.g < b.g);
+    }
+};
+
+/**
+ * @brief Monotone bucket (Dial) open list: amortised O(1) push and pop
+ *
+ * Every step costs 1 or sqrt(2) plus a small whole-number effort, so 'f' is
+ * quantised to fixed point with SCALE steps per unit and each step of that
+ * gets its own bucket, in a ring which grows to span the keys in the list.
+ * Nodes within a bucket come out newest first, which favours the deeper ones.
+ *
+ * Keys must never go below the last one popped; this holds for a consistent
+ * heuristic, and any float rounding below it is clamped up.  A node is only
+ * ordered to within 1/SCALE, so a path may cost up to that much over optimal.
+ */
+class BucketOpenList
+{
+public:
+    static constexpr bool LAZY = true;
+    static constexpr float SCALE = 64.f;
+
+    void Reset(QueryContext& ctx) {
+        for (auto& b : buckets) {
+            b.clear();
+        }
+        if (buckets.empty()) {
+            buckets.resize(1024);
+            ctx.Track(buckets, 0);
+        }
+        context = &ctx;
+        count = 0;
+        cur = 0;
+        started = false;
+    }
+
+    void Push(const OpenEntry& e) {
+        uint32_t key = (uint32_t)(e.f * SCALE);
+        if (!started) {
+            cur = key;
+            started = true;
+        }
+        key = std::max(key, cur);
+
+        if (key - cur >= buckets.size()) {
+            Grow(key - cur + 1);
+        }
+
+        auto& b = buckets[key & (buckets.size() - 1)];
+        const size_t cap = b.capacity();
+        b.push_back({key, e});
+        context->Track(b, cap);
+        count++;
+    }
+
+    OpenEntry Pop() {
+        const size_t mask = buckets.size() - 1;
+        while (buckets[cur & mask].empty()) {
+            cur++;
+        }
+
+        auto& b = buckets[cur & mask];
+        const OpenEntry e = b.back().entry;
+        b.pop_back();
+        count--;
+        return e;
+    }
+
+    bool Empty() const { return count == 0; }
+
+    void Erase(const OpenEntry&) { }
+
+private:
+    struct Item
+    {
+        uint32_t key;
+        OpenEntry entry;
+    };
+
+    //! Ring of buckets, indexed by key modulo its (power of two) size; kept between searches
+    std::vector<std::vector<Item>> buckets;
+    QueryContext* context {nullptr};
+    size_t count {0};
+    uint32_t cur {0};    //!< Key of the lowest bucket which may be non-empty
+    bool started {false};
+
+    //! Enlarge the ring to span at least 'span' keys from 'cur'
+    void Grow(size_t span) {
+        size_t size = buckets.size();
+        while (size < span) {
+            size *= 2;
+        }
+
+        std::vector<std::vector<Item>> old(size);
+        old.swap(buckets);
+        context->Track(buckets, 0);
+        for (auto& b : old) {
+            for (const Item& item : b) {
+                auto& nb = buckets[item.key & (size - 1)];
+                const size_t cap = nb.capacity();
+                nb.push_back(item);
+                context->Track(nb, cap);
+            }
+        }
+    }
+};
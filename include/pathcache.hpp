@@ -0,0 +1,221 @@
+/**
+ * @File: pathcache.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     LRU cache of planner results which threads can share, and a Planner
+ *     which answers what it can from the cache before asking another planner
+ */
+#pragma once
+
+#include "olcPixelGameEngine.h"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "gamemap.hpp"
+#include "planner.hpp"
+#include "util.hpp"
+
+//! Counters of a PathCache's lookups
+struct PathCacheStats
+{
+    long hits {0};        //!< Queries answered by a result from the same start
+    long subPathHits {0}; //!< Queries answered by the rest of a cached path through the start
+    long misses {0};
+    long inserts {0};
+    long evictions {0};
+
+    double HitRate() const {
+        const long total = hits + subPathHits + misses;
+        return total > 0 ? (double)(hits + subPathHits) / total : 0.;
+    }
+};
+
+/**
+ * @brief Least-recently-used cache of paths, keyed by start, goal, planner settings and map version
+ *
+ * As the map's version is part of the key, a result can never outlive the
+ * terrain it was planned on; it just stops being found, and ages out.
+ *
+ * Every tile along a cached path is indexed, so a query from any of them to
+ * the same goal can be answered by the rest of that path.  For a planner
+ * which finds optimal paths, that rest is itself an optimal path.
+ *
+ * The entries are split into shards by goal, settings and version, each with
+ * its own lock, so threads asking about different goals rarely wait on each
+ * other.  Results are handed out as shared pointers, so they stay valid
+ * while in use even if they're evicted meanwhile.
+ */
+class PathCache
+{
+public:
+    //! A planner's result for one query; 'tiles' is empty if there was no path
+    struct Entry
+    {
+        WorldPos start;
+        WorldPos goal;
+        uint64_t config {0};           //!< Key of the planner's settings
+        uint64_t version {0};          //!< Version of the map the path was planned on
+        std::vector<WorldPos> tiles;
+        std::vector<float> costToGoal; //!< Cost from each tile to the end of the path
+        int expansions {0};            //!< Nodes the planner expanded to find it
+    };
+
+    //! A cached result, starting 'offset' tiles along its entry's path
+    struct Result
+    {
+        std::shared_ptr<const Entry> entry;
+        size_t offset {0};
+
+        bool Found() const { return entry && !entry->tiles.empty(); }
+        float Cost() const { return Found() ? entry->costToGoal[offset] : -1.f; }
+        PathView View() const;
+    };
+
+    /**
+     * @param capacity Max number of results to keep
+     * @param nShards  Number of independently-locked parts to split them over
+     */
+    PathCache(size_t capacity = 1024, int nShards = 16);
+
+    /**
+     * @brief Look for a cached result from 'start' to 'goal'
+     *
+     * @param subPaths Whether the rest of a cached path through 'start' will do
+     * @return Whether one was found, possibly saying there's no path
+     */
+    bool Find(WorldPos start, WorldPos goal, uint64_t config, uint64_t version, bool subPaths,
+              Result& result);
+
+    //! Add a result; the most recent path through a tile is the one found from it
+    void Insert(std::shared_ptr<const Entry> entry);
+
+    //! Drop every result
+    void Clear();
+
+    size_t Size() const;
+
+    PathCacheStats GetStats() const;
+    void ResetStats();
+
+private:
+    //! A tile along (or the start of) a cached result
+    struct Key
+    {
+        WorldPos tile;
+        WorldPos goal;
+        uint64_t config;
+        uint64_t version;
+
+        bool operator==(const Key& o) const {
+            return tile == o.tile && goal == o.goal && config == o.config && version == o.version;
+        }
+    };
+
+    struct KeyHash
+    {
+        size_t operator()(const Key& k) const;
+    };
+
+    using LRUList = std::list<std::shared_ptr<const Entry>>; //!< Most recently used first
+
+    //! Where a tile's path can be found
+    struct Slot
+    {
+        LRUList::iterator entry;
+        size_t offset;
+    };
+
+    struct alignas(64) Shard
+    {
+        mutable std::mutex mutex;
+        LRUList lru;
+        std::unordered_map<Key, Slot, KeyHash> index;
+    };
+
+    size_t shardCapacity;
+    std::vector<Shard> shards;
+
+    std::atomic<long> hits {0};
+    std::atomic<long> subPathHits {0};
+    std::atomic<long> misses {0};
+    std::atomic<long> inserts {0};
+    std::atomic<long> evictions {0};
+
+    //! Every tile of a result, to the same goal under the same settings and version, goes to one shard
+    Shard& ShardFor(WorldPos goal, uint64_t config, uint64_t version);
+
+    //! Remove a shard's least-recently-used entry; the shard must be locked
+    void Evict(Shard& shard);
+};
+
+/**
+ * @brief Planner which answers queries from a PathCache, and asks another planner on a miss
+ *
+ * Resumable searches pass straight through to the other planner, and their
+ * result is cached once they finish.  A query answered from the cache is
+ * done as soon as it starts, and reports no expansions.
+ */
+class CachedPlanner : public Planner
+{
+public:
+    /**
+     * @param planner  Planner for the queries which miss; not owned
+     * @param cache    Cache to use, which may be shared with other CachedPlanners; not owned
+     * @param config   Key of the planner's settings (see PlannerConfigKey()); results
+     *                 under different keys are kept apart
+     * @param subPaths Whether a query may be answered by the rest of a cached path
+     *                 through its start; only for planners which find optimal paths
+     */
+    CachedPlanner(Planner* planner, PathCache* cache, uint64_t config, bool subPaths) :
+        planner(planner), cache(cache), config(config), subPaths(subPaths) { };
+
+    void SetTerrainMap(GameMap& map) override;
+
+    bool ComputePath(WorldPos start, WorldPos goal) override;
+
+    PathView GetPath() override;
+    float GetPathCost() override;
+
+    void StartPath(WorldPos start, WorldPos goal) override;
+    PlanStatus StepPath(int maxExpansions, int maxMicros = 0) override;
+    PathView GetPartialPath() override;
+
+    void SetLandmarks(ALTHeuristic* alt) override { planner->SetLandmarks(alt); }
+
+    void SetQueryContext(QueryContext* ctx) override { planner->SetQueryContext(ctx); }
+
+    QueryStats GetQueryStats() override;
+
+    //! Whether the last query was answered from the cache
+    bool WasCached() const { return fromCache; }
+
+private:
+    Planner* planner {nullptr};
+    PathCache* cache {nullptr};
+    uint64_t config {0};
+    bool subPaths {false};
+    GameMap* map {nullptr};
+
+    PathCache::Result cached; //!< Answer to the last query, if it was cached
+    bool fromCache {false};
+
+    //! The query being planned, to be cached once it finishes
+    WorldPos start;
+    WorldPos goal;
+    uint64_t version {0};
+
+    //! Start a query, answering it from the cache if possible
+    bool Lookup(WorldPos start, WorldPos goal);
+
+    //! Cache the other planner's result for the current query
+    void Store();
+};
+
+//! Hash of the settings in the config which change the paths a planner finds
+uint64_t PlannerConfigKey(const Config& config);
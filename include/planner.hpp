@@ -11,17 +11,104 @@
 
 #include <vector>
 
+#include "arena.hpp"
 #include "gamemap.hpp"
+#include "landmarks.hpp"
+
+/**
+ * @brief Read-only view of the most recent path found by a Planner
+ *
+ * The tiles live in storage which the planner owns and reuses from one query
+ * to the next, so a view is only valid until the planner's next ComputePath().
+ */
+struct PathView
+{
+    const WorldPos* tiles {nullptr};
+    size_t count {0};
+    float cost {-1.f};  //!< Total cost of the path; negative if no path was found
+    int expansions {0}; //!< Number of nodes the search expanded to find it
+
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const WorldPos* begin() const { return tiles; }
+    const WorldPos* end() const { return tiles + count; }
+    const WorldPos& operator[](size_t i) const { return tiles[i]; }
+};
+
+//! Progress of a search started with Planner::StartPath()
+enum class PlanStatus
+{
+    IN_PROGRESS,
+    FOUND,
+    NO_PATH
+};
 
 class Planner
 {
 public:
     virtual void SetTerrainMap(GameMap& map) = 0;
 
-    virtual bool ComputePath(olc::vi2d start, olc::vi2d goal) = 0;
+    virtual bool ComputePath(WorldPos start, WorldPos goal) = 0;
 
-    virtual std::vector<olc::vi2d> GetPath() = 0;
+    virtual PathView GetPath() = 0;
     
     virtual float GetPathCost() = 0;
+
+    /**
+     * @brief Begin a resumable search, to be advanced with StepPath()
+     *
+     * Planners which can't pause part-way just run the whole search here.
+     *
+     * A paused search keeps its temporaries in the planner's query context,
+     * so nothing else may use that context until the search has finished:
+     * two planners sharing one through SetQueryContext() must not have
+     * searches in progress at the same time.
+     */
+    virtual void StartPath(WorldPos start, WorldPos goal) {
+        planStatus = ComputePath(start, goal) ? PlanStatus::FOUND : PlanStatus::NO_PATH;
+    }
+
+    /**
+     * @brief Advance the current search by up to the given budget
+     *
+     * @param maxExpansions Max number of nodes to expand before yielding
+     * @param maxMicros     Max time to spend before yielding; 0 for no limit
+     */
+    virtual PlanStatus StepPath(int /*maxExpansions*/, int /*maxMicros*/ = 0) { return planStatus; }
+
+    //! The best path found so far, for display while a search is in progress
+    virtual PathView GetPartialPath() { return GetPath(); }
+
+    //! Progress of the current search
+    PlanStatus GetStatus() const { return planStatus; }
+
+    /**
+     * @brief Use a landmark (ALT) heuristic alongside the planner's default one
+     *
+     * The planner refreshes the landmark tables itself before each search.
+     * Pass nullptr to go back to the default heuristic alone.
+     */
+    virtual void SetLandmarks(ALTHeuristic* alt) { landmarks = alt; }
+
+    /**
+     * @brief Allocate all search temporaries from the given context's arena
+     *
+     * By default each planner has its own context.  The context must outlive
+     * any query made with it, and may be shared by several planners only if
+     * their searches never overlap (see StartPath()).  Pass nullptr to go
+     * back to the default.
+     */
+    virtual void SetQueryContext(QueryContext* ctx) { context = ctx; }
+
+    //! Allocation counts for the most recent query made through this planner's context
+    virtual QueryStats GetQueryStats() { return Context().GetStats(); }
+
+protected:
+    PlanStatus planStatus {PlanStatus::NO_PATH};
+    ALTHeuristic* landmarks {nullptr};
+    QueryContext* context {nullptr};
+    QueryContext ownContext; //!< Used unless another is set; its arena only allocates once used
+
+    QueryContext& Context() { return context ? *context : ownContext; }
 };
 
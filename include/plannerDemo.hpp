@@ -7,6 +7,11 @@
 #include "olcPixelGameEngine.h"
 
 #include "astar.hpp"
+#include "contraction.hpp"
+#include "cpd.hpp"
+#include "hdastar.hpp"
+#include "pathcache.hpp"
+#include "rtaastar.hpp"
 #include "util.hpp"
 #include "gamemap.hpp"
 
@@ -15,7 +20,8 @@ class PlannerDemo : public olc::PixelGameEngine
 {
 public:
     PlannerDemo(const Config& _config) :
-        gameMap(_config)
+        gameMap(_config),
+        landmarks(_config.nLandmarks)
     {
         // Name your application
         sAppName = "PlannerDemo";
@@ -38,34 +44,42 @@ private:
 
     void PrintOverlay();
 
+    //! Screen position of a world pixel
+    olc::vf2d ToScreen(const WorldPos& pos) const { return {(float)(pos.x - camera.x), (float)(pos.y - camera.y)}; }
+
     olc::Renderable tileHighlight;
 
     // Cursor Location
     olc::vi2d mouse;   //!< Screen position of mouse
-    olc::vf2d wMouse;  //!< World position of mouse
-    olc::vi2d mTileIJ; //!< World I,J coordinates
-    olc::vi2d mTileXY; //!< World X,Y coordinates
+    WorldPos wMouse;   //!< World position of mouse
+    WorldPos mTileIJ;  //!< World I,J coordinates
+    WorldPos mTileXY;  //!< World X,Y coordinates
 
     // Screen motion with WASD
-    olc::vf2d viewOffset {0.f, 0.f};
+    WorldPos camera {0, 0};          //!< World pixel at the top-left of the screen
+    olc::vf2d cameraFrac {0.f, 0.f}; //!< Panning not yet amounting to a whole pixel
     bool wPressed {false};
     bool aPressed {false};
     bool sPressed {false};
     bool dPressed {false};
 
     // Planner Variables
-    olc::vi2d goalIJ;
-    olc::vi2d startIJ;
-    olc::vf2d goalPos;
+    WorldPos goalIJ;
+    WorldPos startIJ;
+    WorldPos goalPos;
     float pathCost {0.f};
     bool isGoalSet {false};
     bool havePath {false};
+    bool terrainChanged {false}; //!< Set by the map when the terrain is edited
+    PlanStatus planStatus {PlanStatus::NO_PATH};
     bool gamePaused {false};
 
     const olc::vf2d noscale = {1.f, 1.f};
 
     Planner* planner;
+    PathCache* pathCache {nullptr};
     GameMap gameMap;
+    ALTHeuristic landmarks;
     Config config;
 
     uint8_t layerBG;
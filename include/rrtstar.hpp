@@ -23,9 +23,9 @@ public:
 
     void SetTerrainMap(GameMap& map) override;
 
-    bool ComputePath(olc::vi2d start, olc::vi2d goal) override;
+    bool ComputePath(WorldPos start, WorldPos goal) override;
 
-    std::vector<olc::vi2d> GetPath() override;
+    PathView GetPath() override;
     float GetPathCost() override { return path_cost; }
 
 private:
@@ -36,6 +36,6 @@ private:
     bool goalReached {false};
     float path_cost {-1.f};
 
-    std::vector<olc::vi2d> final_path;
+    std::vector<WorldPos> final_path;
 };
 
@@ -0,0 +1,104 @@
+/**
+ * @File: rtaastar.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Real-Time Adaptive A* (RTAA*): an agent which moves every tick after a
+ *     bounded local search, learning better heuristic values as it goes
+ */
+#pragma once
+
+#include "olcPixelGameEngine.h"
+
+#include <cfloat>
+#include <vector>
+
+#include "gamemap.hpp"
+#include "openlist.hpp"
+#include "planner.hpp"
+
+/**
+ * @brief Real-time agent: each tick, a fixed-size lookahead and one move
+ *
+ * StartPath() puts the agent on the start tile, and each StepPath() is one
+ * tick of the agent's life: an A* search around it limited to 'lookahead'
+ * expansions, after which every expanded tile s learns the heuristic value
+ * h(s) = f(best open tile) - g(s), and the agent takes one step towards that
+ * best open tile.  As the learned values only ever grow, the agent can't get
+ * stuck for good in a dead end, and repeat trips to the same goal get better.
+ *
+ * The learned values are kept between searches for as long as the goal and
+ * the loaded window stay the same.  GetPath() gives the trail the agent took.
+ */
+class RTAAStar : public Planner
+{
+public:
+    /**
+     * @param lookahead    Max number of tiles to expand per tick
+     * @param heuristic    Initial distance heuristic, before any learning
+     * @param connectivity Number of neighbors of each tile (4 or 8)
+     */
+    RTAAStar(int lookahead = 64, HeuristicType heuristic = EFFORT_OCTILE, int connectivity = 8) :
+        lookahead(std::max(lookahead, 1)), heuristic(heuristic), connectivity(connectivity) { };
+
+    void SetTerrainMap(GameMap& map) override;
+
+    //! Run the agent tick by tick until it reaches the goal (or gives up)
+    bool ComputePath(WorldPos start, WorldPos goal) override;
+
+    void StartPath(WorldPos start, WorldPos goal) override;
+
+    /**
+     * @brief Advance the agent by one tick: one lookahead search and one move
+     *
+     * The expansions per tick are fixed by 'lookahead', so the budget is unused.
+     */
+    PlanStatus StepPath(int maxExpansions, int maxMicros = 0) override;
+
+    PathView GetPartialPath() override;
+
+    PathView GetPath() override;
+    float GetPathCost() override { return path_cost; }
+
+    //! Tile the agent is standing on
+    WorldPos GetPosition() const { return grid.LocOf(agent); }
+
+private:
+    GameMap* map {nullptr};
+
+    int lookahead {64};
+    HeuristicType heuristic {EFFORT_OCTILE};
+    int connectivity {8};
+
+    EffortGrid grid;            //!< Effort of each tile in the loaded window
+    std::vector<float> learned; //!< Learned heuristic of each tile; negative until learned
+    WorldPos goal {0, 0};
+    int gInd {-1};
+    int agent {-1};             //!< Index of the tile the agent is on
+    int moves {0};
+
+    // Scratch space for each tick's lookahead, reset by bumping 'stamp'
+    std::vector<float> gval;
+    std::vector<int32_t> parent;
+    std::vector<uint32_t> seen;  //!< Stamp of the tick in which each tile was last reached
+    DepthHeap open;              //!< The lookahead's open tiles
+    std::vector<int32_t> closed; //!< Tiles expanded this tick
+    uint32_t stamp {0};
+
+    float path_cost {-1.f};
+    int expansions {0};
+
+    std::vector<WorldPos> final_path; //!< Every tile the agent has stood on, in order
+
+    //! Pick the Lookahead() specialisation for the chosen heuristic and connectivity
+    template <class Heuristic>
+    PlanStatus Dispatch(const Heuristic& hval);
+
+    /**
+     * @brief One tick: search around the agent, learn from it, then move
+     *
+     * @tparam NN Number of neighbors per tile (4 or 8)
+     */
+    template <int NN, class Heuristic>
+    PlanStatus Lookahead(const Heuristic& hval);
+};
@@ -0,0 +1,159 @@
+/**
+ * @File: sipp.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Safe Interval Path Planning (SIPP): planning around moving obstacles
+ *     whose positions are known over time
+ */
+#pragma once
+
+#include "olcPixelGameEngine.h"
+
+#include <cfloat>
+#include <map>
+#include <unordered_map>
+#include <vector>
+
+#include "gamemap.hpp"
+#include "openlist.hpp"
+#include "planner.hpp"
+
+/**
+ * @brief When each tile is taken by a moving obstacle
+ *
+ * Each tile keeps a sorted list of disjoint unsafe intervals [from, to); the
+ * gaps between them are the tile's safe intervals, the last of which runs on
+ * forever.  Time is measured in the same units as path cost: crossing onto a
+ * tile takes the step length plus that tile's effort.
+ */
+class SafeIntervalTable
+{
+public:
+    struct Interval
+    {
+        float from;
+        float to;
+    };
+
+    void Clear() { unsafe.clear(); }
+
+    //! Mark 'tile' as taken from time 'from' until 'to'; overlapping intervals are merged
+    void AddUnsafe(WorldPos tile, float from, float to);
+
+    /**
+     * @brief Mark the tiles of a moving obstacle's route as taken
+     *
+     * The obstacle starts onto tiles[k] at times[k], and stays there until
+     * it starts onto the next tile; it leaves the last one at 'leaveTime'.
+     */
+    void AddTrajectory(const std::vector<WorldPos>& tiles, const std::vector<float>& times,
+                       float leaveTime = FLT_MAX);
+
+    //! Sorted unsafe intervals of a tile; nullptr if it's always safe
+    const std::vector<Interval>* GetUnsafe(WorldPos tile) const;
+
+    const std::map<WorldPos, std::vector<Interval>>& GetAll() const { return unsafe; }
+
+private:
+    std::map<WorldPos, std::vector<Interval>> unsafe;
+};
+
+/**
+ * @brief A* over (tile, safe interval) states, around scheduled moving obstacles
+ *
+ * Rather than a state per tile per timestep, SIPP has one per safe interval
+ * of each tile, holding the earliest time the agent can be there; as waiting
+ * is always allowed, arriving earlier is never worse.  Long waits and long
+ * horizons so cost no more than short ones.
+ *
+ * An agent is on a tile from when it starts moving onto it until it starts
+ * onto the next one, so both the tile it leaves and the tile it enters have
+ * to be safe for the whole of each move.  Time is cost: a path's cost is the
+ * time from the start until the agent reaches the goal for good, waits
+ * included, and the goal only counts once no obstacle will pass over it again.
+ */
+class SIPPlanner : public Planner
+{
+public:
+    //! A step along a timed path: the agent starts onto 'tile' at 'time'
+    struct TimedStep
+    {
+        WorldPos tile;
+        float time;
+    };
+
+    /**
+     * @param heuristic    Distance heuristic to guide the search
+     * @param connectivity Number of neighbors of each tile (4 or 8)
+     */
+    SIPPlanner(HeuristicType heuristic = EFFORT_OCTILE, int connectivity = 8) :
+        heuristic(heuristic), connectivity(connectivity) { };
+
+    void SetTerrainMap(GameMap& map) override;
+
+    //! Use the given obstacle schedule; nullptr to plan as if there were none
+    void SetSafeIntervals(const SafeIntervalTable* table) { intervals = table; }
+
+    //! Time at which the agent sets off from the start (default 0)
+    void SetStartTime(float t) { startTime = t; }
+
+    bool ComputePath(WorldPos start, WorldPos goal) override;
+
+    PathView GetPath() override;
+    float GetPathCost() override { return path_cost; }
+
+    //! Each tile of the last path, with the time the agent starts onto it
+    const std::vector<TimedStep>& GetTimedPath() const { return timed_path; }
+
+private:
+    struct Node
+    {
+        int32_t idx;
+        int32_t interval; //!< Which of the tile's safe intervals
+        float g;          //!< Earliest time at which the agent can leave the tile
+        float enter;      //!< Time at which the agent started onto the tile
+        int32_t parent;   //!< Index of the previous node in 'nodes'
+    };
+
+    GameMap* map {nullptr};
+    const SafeIntervalTable* intervals {nullptr};
+
+    HeuristicType heuristic {EFFORT_OCTILE};
+    int connectivity {8};
+    float startTime {0.f};
+
+    EffortGrid grid;
+    std::vector<const std::vector<SafeIntervalTable::Interval>*> unsafe; //!< Per tile of 'grid'; nullptr if always safe
+    WorldPos goal {0, 0};
+    int gInd {-1};
+
+    std::vector<Node> nodes;
+    DepthHeap open; //!< Entries index 'nodes'
+    std::unordered_map<uint64_t, int32_t> visited; //!< (tile, interval) -> index in 'nodes'
+
+    float path_cost {-1.f};
+    int expansions {0};
+
+    std::vector<WorldPos> final_path;
+    std::vector<TimedStep> timed_path;
+
+    //! Number of safe intervals of a tile
+    int NumIntervals(int idx) const { return unsafe[idx] ? (int)unsafe[idx]->size() + 1 : 1; }
+
+    //! Start and end of a tile's j'th safe interval
+    float IntervalStart(int idx, int j) const { return j > 0 ? (*unsafe[idx])[j - 1].to : -FLT_MAX; }
+    float IntervalEnd(int idx, int j) const { return unsafe[idx] && j < (int)unsafe[idx]->size() ? (*unsafe[idx])[j].from : FLT_MAX; }
+
+    //! Pick the Search() specialisation for the chosen heuristic and connectivity
+    template <class Heuristic>
+    bool Dispatch(const Heuristic& hval, int sInd);
+
+    /**
+     * @brief Run the search itself
+     *
+     * @tparam NN Number of neighbors per tile (4 or 8)
+     */
+    template <int NN, class Heuristic>
+    bool Search(const Heuristic& hval, int sInd);
+};
@@ -23,14 +23,13 @@
 //! A single tile in our game map.
 struct Tile
 {
-    void Draw(const olc::vi2d& ofset);
+    //! Draw the tile relative to the camera (the world pixel at the top-left of the screen)
+    void Draw(const WorldPos& camera);
 
     olc::PixelGameEngine* pge {nullptr};
 
     olc::Decal* dTexture {nullptr}; //!< The texture to display
-    olc::vi2d vTileCoord;           //!< The (i,j) coordinates of this tile within the game map
-    olc::vf2d vScreenPos;           //!< The location _of the sprite_ in the screen frame
-    float fEffort {0.f};            //!< The effort required to cross this tile
+    WorldPos vTileCoord;            //!< The (i,j) coordinates of this tile within the game map
     uint8_t layer {0};              //!< Which terrain-style layer this tile is
 };
 
@@ -53,7 +52,7 @@ public:
 
     olc::Sprite* GetBaseTile(uint8_t type);
     olc::Sprite* GetTileAt(uint8_t type, int idx);
-    olc::Decal* GetTextureFor(const std::array<uint8_t, 4>& bcs, olc::vi2d loc);
+    olc::Decal* GetTextureFor(const std::array<uint8_t, 4>& bcs, const WorldPos& loc);
 
     uint8_t GetNTypes() { return (uint8_t)tiles.size(); }
 
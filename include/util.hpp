@@ -10,6 +10,7 @@
 
 #include <algorithm>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "profile.hpp"
@@ -22,13 +23,49 @@ double GetNoise(double nx, double ny);
 
 float SimpleRand(int x, int y);
 
+/**
+ * @brief A position in world pixels (or tiles), 64-bit so that it stays exact anywhere in the world
+ *
+ * World pixels overflow 32 bits, and floats lose whole pixels, long before
+ * the edge of the world.  Positions on screen are found relative to the
+ * camera in 64 bits, and only the (small) difference is narrowed; likewise
+ * tiles within a chunk or an EffortGrid are addressed relative to its corner.
+ */
+typedef olc::v2d_generic<int64_t> WorldPos;
+
+//! Integer division rounding towards -infinity, e.g. for the tile holding a world pixel
+inline int64_t FloorDiv(int64_t a, int64_t b)
+{
+    return a / b - (a % b != 0 && (a < 0) != (b < 0));
+}
+
 enum PlannerMethod
 {
     ASTAR = 0,
     RRTSTAR,
+    CONTRACTION,
+    CPD,
+    HDASTAR,
+    RTAASTAR,
     METHOD_MAX
 };
 
+enum HeuristicType
+{
+    OCTILE = 0,
+    MANHATTAN,
+    EFFORT_OCTILE,
+    HEURISTIC_MAX
+};
+
+enum OpenListType
+{
+    OPEN_SET = 0,
+    OPEN_HEAP,
+    OPEN_BUCKET,
+    OPENLIST_MAX
+};
+
 enum MapType
 {
     STATIC = 0,
@@ -42,15 +79,43 @@ struct Config
     std::string fConfig;
     olc::vi2d dims;
     std::vector<uint8_t> map;
+    std::string mapFile;    //!< Binary map file (see TiledTerrain) to use instead of 'map'
+    std::string mapImage;   //!< PNG image to take a static map's terrain from, one pixel per tile
+    std::vector<uint8_t> imagePalette;   //!< Layer of each palette index of an indexed image
+    std::vector<olc::Pixel> imageColors; //!< Colour of each layer in an image; empty for the defaults
+    std::string mapTmx;     //!< Tiled map to take a static map's terrain from
+    std::vector<std::pair<std::string, uint8_t>> tmxTerrains; //!< Layer of each Tiled terrain, by name
     std::vector<float> terrainWeights;
     PlannerMethod method;
+    float epsilon;
+    HeuristicType heuristic;
+    OpenListType openList;
+    int connectivity;
+    int nThreads;
+    int lookahead;
     MapType mapType;
     int noiseSeed;
     double noiseScale;
+    int nLandmarks;
+    int frameBudget;
+    bool chCache;
+    bool cpdCache;
+    bool chunkCache;
+    int pathCache;
 };
 
+//! A path given in an input file, relative to that file unless absolute
+std::string RelativeTo(const std::string& fname, const std::string& path);
+
+//! Parse a colour given as "#rrggbb"
+olc::Pixel PixelFromString(const std::string& color);
+
 MapType MapTypeValFromString(const std::string& maptype);
 
 PlannerMethod MethodValFromString(const std::string& method);
 
+HeuristicType HeuristicValFromString(const std::string& heuristic);
+
+OpenListType OpenListValFromString(const std::string& openList);
+
 bool LoadInput(const std::string& fname, Config& config);
@@ -0,0 +1,63 @@
+/**
+ * @File: workerpool.hpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Threads kept waiting between parallel jobs, so that starting one costs wake-ups rather than new threads
+ */
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Runs a job on a fixed number of slots, the calling thread doubling as slot 0
+ *
+ * The other slots' threads are started on the first Run() and kept until the
+ * pool is destroyed.  Handing out a job neither copies nor allocates it.
+ * Only one thread may call Run() at a time.
+ */
+class WorkerPool
+{
+public:
+    WorkerPool(int nSlots = 1) : nSlots(nSlots > 0 ? nSlots : 1) { }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    ~WorkerPool();
+
+    int GetNumSlots() const { return nSlots; }
+
+    //! Run 'work(slot)' for every slot, and wait for them all to finish
+    template <class F>
+    void Run(const F& work) {
+        RunJob(&Call<F>, &work);
+    }
+
+private:
+    using JobFn = void (*)(const void* work, int slot);
+
+    int nSlots {1};
+    std::vector<std::thread> threads; //!< Slots 1 .. nSlots - 1
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    JobFn job {nullptr};
+    const void* jobArg {nullptr};
+    uint64_t generation {0}; //!< Bumped for each job, so each thread runs it once
+    int running {0};         //!< Threads still working on the current job
+    bool stop {false};
+
+    template <class F>
+    static void Call(const void* work, int slot) { (*static_cast<const F*>(work))(slot); }
+
+    void RunJob(JobFn fn, const void* arg);
+
+    //! Main loop of the thread for the given slot
+    void Loop(int slot);
+};
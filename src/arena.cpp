@@ -0,0 +1,60 @@
+/**
+ * @File: arena.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Bump ('arena') allocator for the temporaries of planner queries
+ */
+#include "arena.hpp"
+
+#include <algorithm>
+
+void* Arena::Allocate(size_t bytes, size_t align)
+{
+    nAllocs++;
+    bytesUsed += bytes;
+
+    while (current < blocks.size()) {
+        Block& block = blocks[current];
+        const size_t start = (offset + align - 1) & ~(align - 1);
+        if (start + bytes <= block.size) {
+            offset = start + bytes;
+            return block.data.get() + start;
+        }
+
+        // Doesn't fit; move on to the next block, if we already have one
+        current++;
+        offset = 0;
+    }
+
+    // Out of blocks; grab a new one, large enough for this request
+    Block block;
+    block.size = std::max(blockSize, bytes + align);
+    block.data.reset(new uint8_t[block.size]);
+    blocks.push_back(std::move(block));
+    nHeapAllocs++;
+
+    current = blocks.size() - 1;
+    uint8_t* base = blocks[current].data.get();
+    const size_t start = (size_t)((-(uintptr_t)base) & (align - 1));
+    offset = start + bytes;
+    return base + start;
+}
+
+void Arena::Reset()
+{
+    current = 0;
+    offset = 0;
+    nAllocs = 0;
+    nHeapAllocs = 0;
+    bytesUsed = 0;
+}
+
+size_t Arena::GetCapacity() const
+{
+    size_t capacity = 0;
+    for (const auto& block : blocks) {
+        capacity += block.size;
+    }
+    return capacity;
+}
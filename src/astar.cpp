@@ -7,206 +7,285 @@
  */
 
 #include "astar.hpp"
+#include "heuristics.hpp"
 #include "util.hpp"
 
 #include <cassert>
+#include <chrono>
 #include <map>
-#include <set>
 #include <unordered_set>
 #include <unistd.h>
 
-#define SQRT2 1.41421356f
-
-// Manhattan Distance
-float Manhattan(const olc::vi2d& t1, const olc::vi2d& t2)
+PathView AStar::GetPath()
 {
-    const int dx = abs(t1.x - t2.x);
-    const int dy = abs(t1.y - t2.y);
-    return static_cast<float>(dx + dy);
+    if (path_cost > 0)
+        return {final_path.data(), final_path.size(), path_cost, expansions};
+
+    return {nullptr, 0, path_cost, expansions};
 }
 
-// 'Diagonal Distance' (Straight lines and diagonals allowed)
-float Diagonal(const olc::vi2d& t1, const olc::vi2d& t2)
+void AStar::SetTerrainMap(GameMap& _map)
 {
-    // Here we assume we follow a 45deg diagonal,
-    // then a straignt line
-    const int dx = abs(t1.x - t2.x);
-    const int dy = abs(t1.y - t2.y);
-    const int mind = std::min(dx, dy);
-    const int maxd = std::max(dx, dy);
-    return SQRT2 * (float)mind + (float)(maxd - mind);
+    map = &_map;
 }
 
-float AStar::Hval(olc::vi2d t1, olc::vi2d t2)
+bool AStar::ComputePath(WorldPos start, WorldPos goal)
 {
-    //return Manhattan(t1, t2);
-    return Diagonal(t1, t2);
+    PROFILE_FUNC();
+
+    StartPath(start, goal);
+    while (planStatus == PlanStatus::IN_PROGRESS) {
+        StepPath(INT32_MAX);
+    }
+
+    return planStatus == PlanStatus::FOUND;
 }
 
-std::vector<olc::vi2d> AStar::GetPath()
+void AStar::StartPath(WorldPos start, WorldPos _goal)
 {
-    if (path_cost > 0)
-        return final_path;
+    path_cost = -1.f;
+    expansions = 0;
+    planStatus = PlanStatus::NO_PATH;
+
+    Context().Begin();
+
+    if (landmarks) {
+        landmarks->Update(*map);
+    }
+
+    // Grab a snapshot of the effort of every tile in the loaded window,
+    // unless the map hasn't changed since the last one
+    if (grid.version != map->GetVersion()) {
+        map->GetEffortGrid(grid);
+    }
+
+    // For now, if the start or goal are outside of the loaded chunk extents, quit
+    if (!grid.Contains(start) || !grid.Contains(_goal)) {
+        return;
+    }
 
-    return {};
+    // Reset the search state of every node
+    const int sInd = grid.IndexOf(start);
+    goal = _goal;
+    gInd = grid.IndexOf(goal);
+    const size_t nodesCap = nodes.capacity();
+    nodes.assign(grid.Size(), Node());
+    Context().Track(nodes, nodesCap);
+
+    // Start the algorithm with the start node.  As the only open node, its
+    // 'f' doesn't matter.
+    nodes[sInd].g = 0;
+    nodes[sInd].f = 0;
+    nodes[sInd].state = Node::OPEN;
+
+    // Setup the priority queue to track the active/'open' nodes
+    switch (openList) {
+        case OPEN_HEAP:
+            heapList.Reset(Context());
+            heapList.Push(nodes[sInd].GetEntry(sInd));
+            break;
+
+        case OPEN_BUCKET:
+            bucketList.Reset(Context());
+            bucketList.Push(nodes[sInd].GetEntry(sInd));
+            break;
+
+        case OPEN_SET:
+        default:
+            setList.Reset(Context());
+            setList.Push(nodes[sInd].GetEntry(sInd));
+            break;
+    }
+
+    counter = 0;
+    bestInd = sInd;
+    bestH = FLT_MAX;
+    planStatus = PlanStatus::IN_PROGRESS;
 }
 
-void AStar::SetTerrainMap(GameMap& _map)
+PlanStatus AStar::StepPath(int maxExpansions, int maxMicros)
 {
-    map = &_map;
+    PROFILE_FUNC();
+
+    if (planStatus != PlanStatus::IN_PROGRESS) {
+        return planStatus;
+    }
+
+    switch (heuristic) {
+        case MANHATTAN:
+            planStatus = Dispatch(ManhattanDist{}, maxExpansions, maxMicros);
+            break;
+
+        case EFFORT_OCTILE:
+            planStatus = Dispatch(EffortOctileDist{map->GetMinEffort()}, maxExpansions, maxMicros);
+            break;
+
+        case OCTILE:
+        default:
+            planStatus = Dispatch(OctileDist{}, maxExpansions, maxMicros);
+            break;
+    }
+
+    return planStatus;
 }
 
-bool AStar::ComputePath(olc::vi2d start, olc::vi2d goal)
+PathView AStar::GetPartialPath()
 {
-    PROFILE_FUNC();
+    if (planStatus != PlanStatus::IN_PROGRESS || bestInd < 0) {
+        return GetPath();
+    }
 
-    path_cost = -1.f;
+    BuildPath(bestInd);
+    return {final_path.data(), final_path.size(), nodes[bestInd].g, expansions};
+}
 
-    // Construct our local copy of the map in a format suitable for the algo.
-    auto extents = map->GetChunkExtents();
-    olc::vi2d dims = extents[1] - extents[0];
+void AStar::BuildPath(int idx)
+{
+    // Count the path's length first, so that it can be filled in from the end
+    // backwards without shifting, reusing the storage from previous queries
+    size_t len = 1;
+    for (int i = idx; nodes[i].parent >= 0; i = nodes[i].parent) {
+        len++;
+    }
 
-    // For now, if the start or goal are outside of the loaded chunk extents, quit
-    if (start < extents[0] || start > extents[1] ||
-        goal < extents[0] || goal > extents[1]) {
-        return false;
+    const size_t pathCap = final_path.capacity();
+    final_path.resize(len);
+    Context().Track(final_path, pathCap);
+    for (size_t k = len; k-- > 0;) {
+        final_path[k] = grid.LocOf(idx);
+        idx = nodes[idx].parent;
     }
+}
 
-    // Build up a copy of all Nodes (tiles) currently in the game map
-    const olc::vi2d loc_start = start - extents[0];
-    const olc::vi2d loc_goal = goal - extents[0];
-    int sInd = loc_start.x + loc_start.y * dims.x;
-
-    nodes.resize(dims.x * dims.y);
-    int cidx = 0;
-    for (int iy = extents[0].y; iy < extents[1].y; iy++) {
-        for (int ix = extents[0].x; ix < extents[1].x; ix++) {
-            Node& node = nodes[cidx];
-            node.loc = {ix, iy};
-            node.idx = cidx;
-            node.effort = map->GetEffortAt(ix, iy);
-
-            cidx++;
-        }
+template <class Heuristic>
+PlanStatus AStar::Dispatch(const Heuristic& hval, int maxExpansions, int maxMicros)
+{
+    if (landmarks) {
+        const LandmarkDist<Heuristic> lval {hval, landmarks};
+        if (connectivity == 4)
+            return DispatchOpen<4>(lval, maxExpansions, maxMicros);
+        return DispatchOpen<8>(lval, maxExpansions, maxMicros);
     }
 
-    // Reset all 'f' and 'g' scores for the A* alg.
-    for (auto& node : nodes) {
-        node.f = FLT_MAX;
-        node.g = FLT_MAX;
+    if (connectivity == 4)
+        return DispatchOpen<4>(hval, maxExpansions, maxMicros);
+    return DispatchOpen<8>(hval, maxExpansions, maxMicros);
+}
+
+template <int NN, class Heuristic>
+PlanStatus AStar::DispatchOpen(const Heuristic& hval, int maxExpansions, int maxMicros)
+{
+    switch (openList) {
+        case OPEN_HEAP:
+            return Search<NN>(heapList, hval, maxExpansions, maxMicros);
+
+        case OPEN_BUCKET:
+            return Search<NN>(bucketList, hval, maxExpansions, maxMicros);
+
+        case OPEN_SET:
+        default:
+            return Search<NN>(setList, hval, maxExpansions, maxMicros);
     }
+}
 
-    // Start the algorithm with the start node
-    nodes[sInd].g = 0;
-    nodes[sInd].f = Hval(start, goal);
+template <int NN, class Open, class Heuristic>
+PlanStatus AStar::Search(Open& open, const Heuristic& hval, int maxExpansions, int maxMicros)
+{
+    static_assert(NN == 4 || NN == 8, "Only 4- and 8-connectivity are supported");
 
-    // Setup the priority queue to track the active/'open' nodes
-    std::set<std::tuple<float, int, int> > pqueue;
-    std::set<int> open_set;
-    pqueue.insert(nodes[sInd].GetTuple());
-    open_set.insert(sInd);
-
-    std::map<int, int> tree;
-    int counter = 0;
-
-    while (!pqueue.empty()) {
-        auto tup = *(pqueue.begin());
-        const int id = std::get<2>(tup);
-        pqueue.erase(pqueue.begin());
-        open_set.erase(id);
+    const olc::vi2d dims = grid.dims;
+    const auto t0 = std::chrono::steady_clock::now();
+
+    for (int step = 0; !open.Empty(); step++) {
+        // Yield once we've used up our budget
+        if (step >= maxExpansions) {
+            return PlanStatus::IN_PROGRESS;
+        }
+        if (maxMicros > 0 && (step & 63) == 63) {
+            const auto dt = std::chrono::steady_clock::now() - t0;
+            if (std::chrono::duration_cast<std::chrono::microseconds>(dt).count() >= maxMicros) {
+                return PlanStatus::IN_PROGRESS;
+            }
+        }
+
+        const OpenEntry top = open.Pop();
+        const int id = top.idx;
         Node& current = nodes[id];
 
+        // Lazy open lists leave behind the old entry when a node's 'f' drops
+        if (Open::LAZY && (current.state != Node::OPEN || current.counter != top.counter)) {
+            continue;
+        }
+        current.state = Node::CLOSED;
+        expansions++;
+
         // Check to see if we've reached our destination
-        if (current.loc == goal) {
+        if (id == gInd) {
             /* --- A Path Was Found --- */
             path_cost = current.g;
 
             // Save the path to be drawn later
-            final_path.clear();
-            int idx = current.idx;
-            while (tree.count(idx)) {
-                auto loc = nodes[idx].loc;
-                final_path.insert(final_path.begin(), loc);
-                idx = tree[idx];
-            }
-            // Add the final node - the start node
-            auto loc = nodes[idx].loc;
-            final_path.insert(final_path.begin(), loc);
+            BuildPath(id);
+
+            return PlanStatus::FOUND;
+        }
 
-            return true;
+        // Keep track of our progress towards the goal
+        const float h = current.f - current.g;
+        if (current.parent >= 0 && h < bestH) {
+            bestH = h;
+            bestInd = id;
         }
 
-        if (current.effort < 0) continue;
-
-        // Get the indices of the current node's neighbors
-        // T/B/L/R; TL/TR/BL/BR
-        const int NN = 8;
-        int neighbors[NN] = {
-            id - dims.x, id + dims.x, id - 1, id + 1,
-            id - dims.x - 1, id - dims.x + 1,
-            id + dims.x - 1, id + dims.x + 1
-        };
-
-        // Handle boundary conditions
-        const int ci = current.loc.x;
-        const int cj = current.loc.y;
-        if (ci == 0) {
-             // Left Edge: Remove neighbors to the left
-             neighbors[2] = -1;
-             neighbors[4] = -1;
-             neighbors[6] = -1;
-         }
-         if (cj == 0) {
-             // Top Edge: Remove neighbors above
-             neighbors[0] = -1;
-             neighbors[4] = -1;
-             neighbors[5] = -1;
-         }
-         if (ci == dims.x - 1) {
-             // Right Edge: Remove neighbors to the right
-             neighbors[3] = -1;
-             neighbors[5] = -1;
-             neighbors[7] = -1;
-         }
-         if (cj == dims.y - 1) {
-             // Bottom Edge: Remove neighbors below
-             neighbors[1] = -1;
-             neighbors[6] = -1;
-             neighbors[7] = -1;
-         }
+        if (grid.effort[id] < 0) continue;
 
+        // Visit the neighbors (T/B/L/R, then TL/TR/BL/BR for 8-connectivity),
+        // skipping any which fall off the edge of the loaded window
+        const int ci = id % dims.x;
+        const int cj = id / dims.x;
         for (int n = 0; n < NN; n++) {
-            const int nidx = neighbors[n];
-            const int ni = nidx % dims.x;
-            const int nj = nidx / dims.x;
-            olc::vi2d n_loc = olc::vi2d({ni,nj}) + extents[0];
-            if (ni < 0 || ni >= dims.x || nj < 0 || nj >= dims.y || map->GetEffortAt(n_loc.x, n_loc.y) < 0) {
+            const int ni = ci + EffortGrid::DX[n];
+            const int nj = cj + EffortGrid::DY[n];
+            if (ni < 0 || ni >= dims.x || nj < 0 || nj >= dims.y) {
                 continue;
             }
 
-            // Get the cost to traverse this neighbor
+            const int nidx = nj * dims.x + ni;
+            const float effort = grid.effort[nidx];
+            if (effort < 0) {
+                continue;
+            }
+
+            // Get the cost to traverse this neighbor.  A weighted search never
+            // reopens a closed node: with a consistent heuristic, the path to
+            // it is already within the bound (as in ARA*), and reopening would
+            // throw away most of the saving.
             auto& neighbor = nodes[nidx];
-            float tmp_g = current.g + Hval(current.loc, neighbor.loc) + neighbor.effort;
+            if (weight > 1.f && neighbor.state == Node::CLOSED) {
+                continue;
+            }
+
+            float tmp_g = current.g + EffortGrid::STEP[n] + effort;
 
             if (tmp_g < neighbor.g) {
                 // If this is the 'best' neighbor so far, update our score
-                tree[nidx] = current.idx;
-                neighbor.g = tmp_g;
-                neighbor.f = tmp_g + Hval(neighbor.loc, goal);
-                const int idx = neighbor.idx;
-
-                if (open_set.count(idx) == 0) {
-                    // Insert the neighbor into our set of spots to check
-                    // Note that the 'f' score determines the priority in the queue
-                    counter += 1;
-                    neighbor.counter = counter;
-                    pqueue.insert(neighbor.GetTuple());
-                    open_set.insert(idx);
-                    neighbor.state = Node::State::OPEN;
+                if (!Open::LAZY && neighbor.state == Node::OPEN) {
+                    open.Erase(neighbor.GetEntry(nidx));
                 }
+
+                neighbor.parent = id;
+                neighbor.g = tmp_g;
+                neighbor.f = tmp_g + weight * hval(grid.LocOf(nidx), goal);
+
+                // (Re-)insert the neighbor into our set of spots to check
+                // Note that the 'f' score determines the priority in the queue
+                counter += 1;
+                neighbor.counter = counter;
+                neighbor.state = Node::OPEN;
+                open.Push(neighbor.GetEntry(nidx));
             }
         }
     }
 
-    return false;
+    return PlanStatus::NO_PATH;
 }
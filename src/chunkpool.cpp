@@ -0,0 +1,77 @@
+/**
+ * @File: chunkpool.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Pool of storage for the tiles of map chunks, reused as chunks come and go
+ */
+#include "chunkpool.hpp"
+
+#include <algorithm>
+#include <cassert>
+
+ChunkPool::ChunkPool(int tilesPerChunk, int chunksPerSlab) :
+    tilesPerChunk(tilesPerChunk),
+    chunksPerSlab(chunksPerSlab)
+{
+}
+
+void ChunkPool::Reserve(int nChunks)
+{
+    while (stats.capacity < nChunks) {
+        AddSlab();
+    }
+}
+
+void ChunkPool::AddSlab()
+{
+    Slab slab;
+    slab.tiles.reset(new Tile[(size_t)chunksPerSlab * tilesPerChunk]);
+    slab.effort.reset(new float[(size_t)chunksPerSlab * tilesPerChunk]);
+    slabs.push_back(std::move(slab));
+
+    stats.slabs++;
+    stats.capacity += chunksPerSlab;
+
+    // Room for every slot to be released at once, so that Release() never allocates
+    freeSlots.reserve(stats.capacity);
+}
+
+int ChunkPool::Acquire()
+{
+    int slot;
+    if (!freeSlots.empty()) {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+        stats.reused++;
+    } else {
+        if (nextFresh == stats.capacity) {
+            AddSlab();
+        }
+        slot = nextFresh++;
+    }
+
+    std::fill_n(TilesOf(slot), tilesPerChunk, Tile());
+    std::fill_n(EffortOf(slot), tilesPerChunk, 0.f);
+
+    stats.acquired++;
+    stats.inUse++;
+    return slot;
+}
+
+void ChunkPool::Release(int slot)
+{
+    assert(slot >= 0 && slot < nextFresh);
+    freeSlots.push_back(slot);
+    stats.inUse--;
+}
+
+Tile* ChunkPool::TilesOf(int slot)
+{
+    return slabs[slot / chunksPerSlab].tiles.get() + (size_t)(slot % chunksPerSlab) * tilesPerChunk;
+}
+
+float* ChunkPool::EffortOf(int slot)
+{
+    return slabs[slot / chunksPerSlab].effort.get() + (size_t)(slot % chunksPerSlab) * tilesPerChunk;
+}
@@ -0,0 +1,210 @@
+/**
+ * @File: chunkstore.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     On-disk store of procedurally-generated chunks, kept across runs
+ */
+#include "chunkstore.hpp"
+
+#include <zlib.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t CHUNK_MAGIC = 0x4B484350; // "PCHK"
+const uint32_t CHUNK_VERSION = 2;
+
+//! Longest file name of a chunk, or of its temporary file
+const size_t MAX_NAME = 4096;
+
+struct ChunkHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t key;
+    int64_t x;
+    int64_t y;
+    uint32_t rawSize;    //!< Number of layers (tiles)
+    uint32_t packedSize; //!< Size of the compressed layers which follow
+};
+
+//! Make a directory, unless it's already there
+bool MakeDir(const std::string& dir)
+{
+    return mkdir(dir.c_str(), 0755) == 0 || errno == EEXIST;
+}
+
+//! Read exactly 'len' bytes
+bool ReadAll(int fd, void* data, size_t len)
+{
+    return read(fd, data, len) == (ssize_t)len;
+}
+
+//! Write exactly 'len' bytes
+bool WriteAll(int fd, const void* data, size_t len)
+{
+    return write(fd, data, len) == (ssize_t)len;
+}
+
+} // namespace
+
+ChunkStore::ChunkStore(const std::string& dir, uint64_t key) :
+    key(key)
+{
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", (unsigned long long)key);
+    path = dir + "/" + name;
+
+    usable = MakeDir(dir) && MakeDir(path);
+    if (!usable) {
+        std::cout << "WARNING: Unable to create chunk cache directory " << path << std::endl;
+        return;
+    }
+
+    writer = std::thread(&ChunkStore::WriteLoop, this);
+}
+
+ChunkStore::~ChunkStore()
+{
+    if (!writer.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_one();
+    writer.join();
+}
+
+bool ChunkStore::FileFor(WorldPos start, const char* suffix, char* buf, size_t len) const
+{
+    const int n = snprintf(buf, len, "%s/%lld_%lld.chunk%s", path.c_str(), (long long)start.x,
+                           (long long)start.y, suffix);
+    return n >= 0 && (size_t)n < len;
+}
+
+bool ChunkStore::Read(WorldPos start, uint8_t* layers, size_t size)
+{
+    // Plain file descriptors, as stdio would allocate a buffer for every file
+    char fname[MAX_NAME];
+    const int fd = usable && FileFor(start, "", fname, sizeof(fname)) ? open(fname, O_RDONLY) : -1;
+    if (fd < 0) {
+        misses++;
+        return false;
+    }
+
+    // A damaged header mustn't have us allocate more than any chunk could pack to
+    ChunkHeader header;
+    bool valid = ReadAll(fd, &header, sizeof(header)) && header.magic == CHUNK_MAGIC &&
+                 header.version == CHUNK_VERSION && header.key == key && header.x == start.x &&
+                 header.y == start.y && header.rawSize == size &&
+                 header.packedSize <= compressBound(header.rawSize);
+    if (valid) {
+        readPacked.resize(header.packedSize);
+        valid = ReadAll(fd, readPacked.data(), readPacked.size());
+    }
+    close(fd);
+
+    if (valid) {
+        uLongf rawSize = size;
+        valid = uncompress(layers, &rawSize, readPacked.data(), readPacked.size()) == Z_OK && rawSize == size;
+    }
+
+    (valid ? hits : misses)++;
+    return valid;
+}
+
+void ChunkStore::Write(WorldPos start, const uint8_t* layers, size_t size)
+{
+    if (!usable) return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<uint8_t> buf;
+        if (!spare.empty()) {
+            buf = std::move(spare.back());
+            spare.pop_back();
+        }
+        buf.assign(layers, layers + size);
+        queue.push_back({start, std::move(buf)});
+    }
+    wake.notify_one();
+}
+
+void ChunkStore::Flush()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return queue.empty() && !busy; });
+}
+
+void ChunkStore::WriteLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this] { return stop || !queue.empty(); });
+        if (queue.empty()) break; // Stopping, with nothing left to write
+
+        // Take every queued write at once; both lists keep their storage
+        writing.swap(queue);
+        busy = true;
+
+        lock.unlock();
+        for (const PendingWrite& w : writing) {
+            WriteChunk(w.start, w.layers);
+        }
+        lock.lock();
+
+        for (PendingWrite& w : writing) {
+            spare.push_back(std::move(w.layers));
+        }
+        writing.clear();
+
+        busy = false;
+        if (queue.empty()) {
+            idle.notify_all();
+        }
+    }
+}
+
+void ChunkStore::WriteChunk(WorldPos start, const std::vector<uint8_t>& layers)
+{
+    uLongf size = compressBound(layers.size());
+    writePacked.resize(size);
+    if (compress2(writePacked.data(), &size, layers.data(), layers.size(), Z_BEST_SPEED) != Z_OK) return;
+
+    const ChunkHeader header {CHUNK_MAGIC, CHUNK_VERSION, key, start.x, start.y,
+                              (uint32_t)layers.size(), (uint32_t)size};
+
+    // Written aside and renamed into place, so a reader only ever sees whole chunks
+    char fname[MAX_NAME];
+    char temp[MAX_NAME];
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".%d.tmp", (int)getpid());
+    if (!FileFor(start, "", fname, sizeof(fname)) || !FileFor(start, suffix, temp, sizeof(temp))) return;
+
+    const int fd = open(temp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return;
+
+    const bool ok = WriteAll(fd, &header, sizeof(header)) && WriteAll(fd, writePacked.data(), size);
+    if (close(fd) == 0 && ok && rename(temp, fname) == 0) {
+        writes++;
+    } else {
+        remove(temp);
+    }
+}
+
+ChunkStoreStats ChunkStore::GetStats() const
+{
+    ChunkStoreStats stats;
+    stats.hits = hits;
+    stats.misses = misses;
+    stats.writes = writes;
+    return stats;
+}
@@ -0,0 +1,464 @@
+/**
+ * @File: contraction.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Contraction Hierarchy (CH) preprocessing and queries for static maps
+ */
+#include "contraction.hpp"
+
+#include <cfloat>
+#include <fstream>
+#include <functional>
+#include <queue>
+
+namespace {
+
+const uint32_t CH_MAGIC = 0x48434450; // "PDCH"
+const uint32_t CH_VERSION = 1;
+
+//! Max number of nodes settled by a single witness search during contraction
+const int WITNESS_SETTLE_LIMIT = 64;
+
+using Entry = std::pair<float, int>;
+using MinQueue = std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>>;
+
+template <typename T>
+void WriteVec(std::ofstream& out, const std::vector<T>& vec)
+{
+    const uint64_t n = vec.size();
+    out.write(reinterpret_cast<const char*>(&n), sizeof(n));
+    out.write(reinterpret_cast<const char*>(vec.data()), n * sizeof(T));
+}
+
+template <typename T>
+bool ReadVec(std::ifstream& in, std::vector<T>& vec)
+{
+    uint64_t n = 0;
+    in.read(reinterpret_cast<char*>(&n), sizeof(n));
+    if (!in) return false;
+    vec.resize(n);
+    in.read(reinterpret_cast<char*>(vec.data()), n * sizeof(T));
+    return (bool)in;
+}
+
+} // namespace
+
+void ContractionHierarchy::Build(const EffortGrid& grid)
+{
+    PROFILE_FUNC();
+
+    const int N = grid.Size();
+
+    // Working copy of the graph.  in[v] holds the edges u->v, with 'to' = u.
+    std::vector<std::vector<Edge>> out(N), in(N);
+    for (int u = 0; u < N; u++) {
+        if (grid.effort[u] < 0) continue;
+
+        const int ui = u % grid.dims.x;
+        const int uj = u / grid.dims.x;
+        for (int n = 0; n < EffortGrid::NN; n++) {
+            const int vi = ui + EffortGrid::DX[n];
+            const int vj = uj + EffortGrid::DY[n];
+            if (vi < 0 || vi >= grid.dims.x || vj < 0 || vj >= grid.dims.y) continue;
+
+            const int v = vj * grid.dims.x + vi;
+            if (grid.effort[v] < 0) continue;
+
+            const float cost = EffortGrid::STEP[n] + grid.effort[v];
+            out[u].push_back({v, cost, -1});
+            in[v].push_back({u, cost, -1});
+        }
+    }
+
+    std::vector<bool> contracted(N, false);
+    std::vector<int> rank(N, -1);
+    std::vector<int> deleted(N, 0); //!< Number of already-contracted neighbors
+
+    // Scratch space for the witness searches
+    std::vector<float> wdist(N, FLT_MAX);
+    std::vector<int> touched;
+
+    auto witnessSearch = [&](int source, int skip, float maxCost) {
+        for (int t : touched) {
+            wdist[t] = FLT_MAX;
+        }
+        touched.clear();
+
+        MinQueue pqueue;
+        wdist[source] = 0.f;
+        touched.push_back(source);
+        pqueue.push({0.f, source});
+
+        int settled = 0;
+        while (!pqueue.empty()) {
+            const auto [d, x] = pqueue.top();
+            pqueue.pop();
+            if (d > wdist[x]) continue;
+            if (d > maxCost || ++settled > WITNESS_SETTLE_LIMIT) break;
+
+            for (const auto& e : out[x]) {
+                if (contracted[e.to] || e.to == skip) continue;
+
+                const float nd = d + e.cost;
+                if (nd < wdist[e.to]) {
+                    if (wdist[e.to] == FLT_MAX) touched.push_back(e.to);
+                    wdist[e.to] = nd;
+                    pqueue.push({nd, e.to});
+                }
+            }
+        }
+    };
+
+    auto addOrUpdate = [](std::vector<Edge>& edges, int to, float cost, int middle) {
+        for (auto& e : edges) {
+            if (e.to == to) {
+                if (cost < e.cost) {
+                    e.cost = cost;
+                    e.middle = middle;
+                }
+                return;
+            }
+        }
+        edges.push_back({to, cost, middle});
+    };
+
+    // Contract node v, returning the number of shortcuts required.
+    // When simulating, the shortcuts are only counted, not added.
+    auto contract = [&](int v, bool simulate) {
+        int added = 0;
+        for (const auto& ein : in[v]) {
+            const int u = ein.to;
+            if (contracted[u]) continue;
+
+            float maxCost = -1.f;
+            for (const auto& eout : out[v]) {
+                if (!contracted[eout.to] && eout.to != u) {
+                    maxCost = std::max(maxCost, ein.cost + eout.cost);
+                }
+            }
+            if (maxCost < 0) continue;
+
+            witnessSearch(u, v, maxCost);
+
+            for (const auto& eout : out[v]) {
+                const int w = eout.to;
+                if (contracted[w] || w == u) continue;
+
+                const float cost = ein.cost + eout.cost;
+                if (wdist[w] <= cost) continue;
+
+                added++;
+                if (!simulate) {
+                    addOrUpdate(out[u], w, cost, v);
+                    addOrUpdate(in[w], u, cost, v);
+                }
+            }
+        }
+        return added;
+    };
+
+    auto priority = [&](int v) {
+        int removed = 0;
+        for (const auto& e : in[v]) removed += !contracted[e.to];
+        for (const auto& e : out[v]) removed += !contracted[e.to];
+        return contract(v, true) - removed + deleted[v];
+    };
+
+    // Lazily-updated queue of nodes ordered by 'edge difference'
+    using PEntry = std::pair<int, int>;
+    std::priority_queue<PEntry, std::vector<PEntry>, std::greater<PEntry>> order;
+    for (int v = 0; v < N; v++) {
+        order.push({priority(v), v});
+    }
+
+    int nextRank = 0;
+    while (!order.empty()) {
+        const int v = order.top().second;
+        order.pop();
+        if (contracted[v]) continue;
+
+        // Re-evaluate; if it's no longer the cheapest node, put it back
+        const int prio = priority(v);
+        if (!order.empty() && prio > order.top().first) {
+            order.push({prio, v});
+            continue;
+        }
+
+        contract(v, false);
+        contracted[v] = true;
+        rank[v] = nextRank++;
+
+        for (const auto& e : in[v]) deleted[e.to]++;
+        for (const auto& e : out[v]) deleted[e.to]++;
+    }
+
+    // Split all edges into the upward (forward) and downward (backward) graphs
+    std::vector<std::vector<Edge>> up(N), down(N);
+    for (int u = 0; u < N; u++) {
+        for (const auto& e : out[u]) {
+            if (rank[e.to] > rank[u]) {
+                up[u].push_back(e);
+            } else {
+                down[e.to].push_back({u, e.cost, e.middle});
+            }
+        }
+    }
+
+    auto flatten = [N](const std::vector<std::vector<Edge>>& adj, std::vector<int>& offsets, std::vector<Edge>& edges) {
+        offsets.assign(N + 1, 0);
+        edges.clear();
+        for (int u = 0; u < N; u++) {
+            offsets[u] = (int)edges.size();
+            edges.insert(edges.end(), adj[u].begin(), adj[u].end());
+        }
+        offsets[N] = (int)edges.size();
+    };
+
+    flatten(up, upOffsets, upEdges);
+    flatten(down, downOffsets, downEdges);
+
+    nNodes = N;
+    mapHash = grid.Hash();
+}
+
+bool ContractionHierarchy::Save(const std::string& fname) const
+{
+    std::ofstream out(fname, std::ios::binary);
+    if (!out) {
+        std::cout << "Unable to write contraction hierarchy to " << fname << std::endl;
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&CH_MAGIC), sizeof(CH_MAGIC));
+    out.write(reinterpret_cast<const char*>(&CH_VERSION), sizeof(CH_VERSION));
+    out.write(reinterpret_cast<const char*>(&nNodes), sizeof(nNodes));
+    out.write(reinterpret_cast<const char*>(&mapHash), sizeof(mapHash));
+    WriteVec(out, upOffsets);
+    WriteVec(out, upEdges);
+    WriteVec(out, downOffsets);
+    WriteVec(out, downEdges);
+
+    return (bool)out;
+}
+
+bool ContractionHierarchy::Load(const std::string& fname, const EffortGrid& grid)
+{
+    std::ifstream in(fname, std::ios::binary);
+    if (!in) return false;
+
+    uint32_t magic = 0, version = 0;
+    int n = 0;
+    uint64_t hash = 0;
+    in.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+    in.read(reinterpret_cast<char*>(&version), sizeof(version));
+    in.read(reinterpret_cast<char*>(&n), sizeof(n));
+    in.read(reinterpret_cast<char*>(&hash), sizeof(hash));
+    if (!in || magic != CH_MAGIC || version != CH_VERSION ||
+        n != grid.Size() || hash != grid.Hash()) {
+        return false;
+    }
+
+    if (!ReadVec(in, upOffsets) || !ReadVec(in, upEdges) ||
+        !ReadVec(in, downOffsets) || !ReadVec(in, downEdges)) {
+        nNodes = 0;
+        return false;
+    }
+
+    nNodes = n;
+    mapHash = hash;
+    return true;
+}
+
+void ContractionHierarchy::ResetQueryData()
+{
+    if ((int)distF.size() != nNodes) {
+        distF.assign(nNodes, FLT_MAX);
+        distB.assign(nNodes, FLT_MAX);
+        parentF.assign(nNodes, -1);
+        parentB.assign(nNodes, -1);
+        seenF.assign(nNodes, 0);
+        seenB.assign(nNodes, 0);
+        stamp = 0;
+    }
+
+    if (++stamp == 0) {
+        // Wrapped around; actually clear the stamps this once
+        std::fill(seenF.begin(), seenF.end(), 0);
+        std::fill(seenB.begin(), seenB.end(), 0);
+        stamp = 1;
+    }
+}
+
+float ContractionHierarchy::Query(int source, int target, Arena& arena, std::vector<int>* path, int* settled)
+{
+    if (source < 0 || source >= nNodes || target < 0 || target >= nNodes) {
+        return -1.f;
+    }
+
+    ResetQueryData();
+
+    using ArenaQueue = std::priority_queue<Entry, std::vector<Entry, ArenaAllocator<Entry>>, std::greater<Entry>>;
+    const ArenaAllocator<Entry> alloc(&arena);
+    ArenaQueue pqF(std::greater<Entry>(), alloc);
+    ArenaQueue pqB(std::greater<Entry>(), alloc);
+    distF[source] = 0.f;
+    parentF[source] = -1;
+    seenF[source] = stamp;
+    pqF.push({0.f, source});
+
+    distB[target] = 0.f;
+    parentB[target] = -1;
+    seenB[target] = stamp;
+    pqB.push({0.f, target});
+
+    float best = (source == target) ? 0.f : FLT_MAX;
+    int meet = (source == target) ? source : -1;
+    int nSettled = 0;
+
+    // Each direction may stop once its smallest key can't improve on 'best'
+    while (true) {
+        const float minF = pqF.empty() ? FLT_MAX : pqF.top().first;
+        const float minB = pqB.empty() ? FLT_MAX : pqB.top().first;
+        if (minF >= best && minB >= best) break;
+
+        const bool forward = minF <= minB;
+        ArenaQueue& pqueue = forward ? pqF : pqB;
+        std::vector<float>& dist = forward ? distF : distB;
+        std::vector<int>& parent = forward ? parentF : parentB;
+        std::vector<uint32_t>& seen = forward ? seenF : seenB;
+        const std::vector<float>& odist = forward ? distB : distF;
+        const std::vector<uint32_t>& oseen = forward ? seenB : seenF;
+        const std::vector<int>& offsets = forward ? upOffsets : downOffsets;
+        const std::vector<Edge>& edges = forward ? upEdges : downEdges;
+
+        const auto [d, x] = pqueue.top();
+        pqueue.pop();
+        if (d > dist[x]) continue;
+        nSettled++;
+
+        for (int k = offsets[x]; k < offsets[x + 1]; k++) {
+            const Edge& e = edges[k];
+            const float nd = d + e.cost;
+            if (seen[e.to] != stamp || nd < dist[e.to]) {
+                seen[e.to] = stamp;
+                dist[e.to] = nd;
+                parent[e.to] = x;
+                pqueue.push({nd, e.to});
+
+                if (oseen[e.to] == stamp && nd + odist[e.to] < best) {
+                    best = nd + odist[e.to];
+                    meet = e.to;
+                }
+            }
+        }
+    }
+
+    if (settled) *settled = nSettled;
+
+    if (meet < 0) return -1.f;
+
+    if (path) {
+        path->clear();
+
+        // Walk the forward search back to the source...
+        std::vector<int, ArenaAllocator<int>> upward(alloc);
+        for (int x = meet; x >= 0; x = parentF[x]) {
+            upward.push_back(x);
+        }
+        path->push_back(source);
+        for (int k = (int)upward.size() - 1; k > 0; k--) {
+            Unpack(upward[k], upward[k - 1], *path);
+        }
+
+        // ...and the backward search on to the target
+        for (int x = meet; parentB[x] >= 0; x = parentB[x]) {
+            Unpack(x, parentB[x], *path);
+        }
+    }
+
+    return best;
+}
+
+float ContractionHierarchy::EdgeCost(int from, int to, int* middle) const
+{
+    for (int k = upOffsets[from]; k < upOffsets[from + 1]; k++) {
+        if (upEdges[k].to == to) {
+            *middle = upEdges[k].middle;
+            return upEdges[k].cost;
+        }
+    }
+    for (int k = downOffsets[to]; k < downOffsets[to + 1]; k++) {
+        if (downEdges[k].to == from) {
+            *middle = downEdges[k].middle;
+            return downEdges[k].cost;
+        }
+    }
+
+    *middle = -1;
+    return -1.f;
+}
+
+void ContractionHierarchy::Unpack(int from, int to, std::vector<int>& path) const
+{
+    // Appends the tiles of the edge from->to, excluding 'from' itself
+    int middle = -1;
+    EdgeCost(from, to, &middle);
+    if (middle < 0) {
+        path.push_back(to);
+        return;
+    }
+
+    Unpack(from, middle, path);
+    Unpack(middle, to, path);
+}
+
+void CHPlanner::SetTerrainMap(GameMap& _map)
+{
+    map = &_map;
+}
+
+PathView CHPlanner::GetPath()
+{
+    if (path_cost > 0)
+        return {final_path.data(), final_path.size(), path_cost, expansions};
+
+    return {nullptr, 0, path_cost, expansions};
+}
+
+bool CHPlanner::ComputePath(WorldPos start, WorldPos goal)
+{
+    PROFILE_FUNC();
+
+    path_cost = -1.f;
+    expansions = 0;
+    Context().Begin();
+
+    // Rebuild whenever the terrain has been edited
+    if (!ch.IsBuilt() || grid.version != map->GetTerrainVersion()) {
+        map->GetStaticEffortGrid(grid);
+        if (cacheFile.empty() || !ch.Load(cacheFile, grid)) {
+            ch.Build(grid);
+            if (!cacheFile.empty()) {
+                ch.Save(cacheFile);
+            }
+        }
+    }
+
+    if (!grid.Contains(start) || !grid.Contains(goal)) {
+        return false;
+    }
+
+    const float cost = ch.Query(grid.IndexOf(start), grid.IndexOf(goal), Context().arena, &path_idx, &expansions);
+    if (cost < 0) {
+        return false;
+    }
+
+    path_cost = cost;
+    final_path.resize(path_idx.size());
+    for (size_t k = 0; k < path_idx.size(); k++) {
+        final_path[k] = grid.LocOf(path_idx[k]);
+    }
+
+    return true;
+}
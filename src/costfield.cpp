@@ -0,0 +1,549 @@
+/**
+ * @File: costfield.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Single-source shortest-path cost fields over an EffortGrid
+ */
+#include "costfield.hpp"
+#include "heuristics.hpp"
+#include "openlist.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <queue>
+#include <thread>
+
+namespace {
+
+//! Reusable barrier for a fixed number of threads
+class SpinBarrier
+{
+public:
+    SpinBarrier(int n) : n(n) { }
+
+    void Wait() {
+        const int gen = generation.load(std::memory_order_acquire);
+        if (count.fetch_add(1, std::memory_order_acq_rel) == n - 1) {
+            count.store(0, std::memory_order_relaxed);
+            generation.fetch_add(1, std::memory_order_release);
+        } else {
+            while (generation.load(std::memory_order_acquire) == gen) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+private:
+    const int n;
+    std::atomic<int> count {0};
+    std::atomic<int> generation {0};
+};
+
+/**
+ * @brief Shared state of one delta-stepping run
+ *
+ * Each tile's cost and parent are packed into one 64-bit word, so they can be
+ * updated together with a single compare-and-swap.  Every thread keeps its own
+ * buckets and only ever pushes to those; the threads take turns at the
+ * barriers to agree on which bucket to work on next.
+ */
+class DeltaStepping
+{
+public:
+    DeltaStepping(const EffortGrid& grid, int nThreads, float delta) :
+        grid(grid), nThreads(nThreads), delta(delta), barrier(nThreads),
+        state(new std::atomic<uint64_t>[grid.Size()]), threads(nThreads), minBucket(nThreads), more(nThreads)
+    {
+        for (int i = 0; i < grid.Size(); i++) {
+            state[i].store(Pack(FLT_MAX, -1), std::memory_order_relaxed);
+        }
+    }
+
+    void Run(int source, std::vector<float>& cost, std::vector<int>& parent) {
+        state[source].store(Pack(0.f, -1));
+        threads[0].buckets.resize(1);
+        threads[0].buckets[0].push_back({source, 0.f});
+
+        // The calling thread doubles as worker 0
+        std::vector<std::thread> workers;
+        for (int t = 1; t < nThreads; t++) {
+            workers.emplace_back([this, t] { Work(t); });
+        }
+        Work(0);
+        for (auto& w : workers) {
+            w.join();
+        }
+
+        cost.resize(grid.Size());
+        parent.resize(grid.Size());
+        for (int i = 0; i < grid.Size(); i++) {
+            const uint64_t s = state[i].load(std::memory_order_relaxed);
+            cost[i] = Cost(s);
+            parent[i] = (int32_t)(uint32_t)s;
+        }
+    }
+
+private:
+    struct Entry
+    {
+        int idx;
+        float g; //!< Cost when queued; the entry is stale once the tile's cost drops below it
+    };
+
+    //! Per-thread work lists, padded to keep threads off each other's cache lines
+    struct alignas(64) ThreadState
+    {
+        std::vector<std::vector<Entry>> buckets; //!< Tiles queued by this thread, by bucket
+        std::vector<Entry> cur;  //!< Tiles in the current bucket still to be processed
+        std::vector<Entry> next; //!< Tiles put back into the current bucket while processing 'cur'
+        std::vector<Entry> done; //!< Tiles processed in the current bucket, for the heavy edges
+    };
+
+    static constexpr int BLOCK = 64; //!< Entries handed to a thread at a time
+    static constexpr int NONE = INT32_MAX;
+
+    const EffortGrid& grid;
+    const int nThreads;
+    const float delta;
+    SpinBarrier barrier;
+
+    std::unique_ptr<std::atomic<uint64_t>[]> state; //!< Packed cost and parent of each tile
+    std::vector<ThreadState> threads;
+    std::vector<int> minBucket; //!< Each thread's lowest non-empty bucket
+    std::vector<char> more;     //!< Whether each thread put tiles back into the current bucket
+
+    // Non-negative floats order the same as their bit patterns
+    static uint64_t Pack(float g, int parent) {
+        uint32_t bits;
+        std::memcpy(&bits, &g, sizeof(bits));
+        return ((uint64_t)bits << 32) | (uint32_t)parent;
+    }
+
+    static float Cost(uint64_t s) {
+        const uint32_t bits = (uint32_t)(s >> 32);
+        float g;
+        std::memcpy(&g, &bits, sizeof(g));
+        return g;
+    }
+
+    int BucketOf(float g) const { return (int)(g / delta); }
+
+    /**
+     * @brief Relax the edges out of the given tile, either the light or heavy ones
+     *
+     * Tiles whose cost drops are queued in 'ts': back into the current bucket
+     * if they still fall within it, or else into their own bucket.
+     */
+    void Relax(ThreadState& ts, const Entry& e, bool light, int bucket) {
+        const int ci = e.idx % grid.dims.x;
+        const int cj = e.idx / grid.dims.x;
+        for (int n = 0; n < EffortGrid::NN; n++) {
+            const int ni = ci + EffortGrid::DX[n];
+            const int nj = cj + EffortGrid::DY[n];
+            if (ni < 0 || ni >= grid.dims.x || nj < 0 || nj >= grid.dims.y) continue;
+
+            const int nidx = nj * grid.dims.x + ni;
+            if (grid.effort[nidx] < 0) continue;
+
+            const float w = EffortGrid::STEP[n] + grid.effort[nidx];
+            if ((w <= delta) != light) continue;
+
+            const float tmp_g = e.g + w;
+            const uint64_t packed = Pack(tmp_g, e.idx);
+            uint64_t old = state[nidx].load(std::memory_order_relaxed);
+            bool improved = false;
+            while (tmp_g < Cost(old)) {
+                if (state[nidx].compare_exchange_weak(old, packed, std::memory_order_relaxed)) {
+                    improved = true;
+                    break;
+                }
+            }
+            if (!improved) continue;
+
+            // (Heavy edges always lead out of the bucket, even if rounding says otherwise)
+            const int b = light ? BucketOf(tmp_g) : std::max(BucketOf(tmp_g), bucket + 1);
+            if (b == bucket) {
+                ts.next.push_back({nidx, tmp_g});
+            } else {
+                if ((int)ts.buckets.size() <= b) {
+                    ts.buckets.resize(b + 1);
+                }
+                ts.buckets[b].push_back({nidx, tmp_g});
+            }
+        }
+    }
+
+    bool IsCurrent(const Entry& e) const {
+        return Cost(state[e.idx].load(std::memory_order_relaxed)) == e.g;
+    }
+
+    void Work(int tid) {
+        ThreadState& ts = threads[tid];
+        int bucket = -1;
+
+        while (true) {
+            // Agree on the lowest bucket which any thread still has tiles in
+            minBucket[tid] = NONE;
+            for (int b = bucket + 1; b < (int)ts.buckets.size(); b++) {
+                if (!ts.buckets[b].empty()) {
+                    minBucket[tid] = b;
+                    break;
+                }
+            }
+            barrier.Wait();
+
+            bucket = *std::min_element(minBucket.begin(), minBucket.end());
+            if (bucket == NONE) break;
+
+            ts.cur.clear();
+            ts.done.clear();
+            if (bucket < (int)ts.buckets.size()) {
+                ts.cur.swap(ts.buckets[bucket]);
+            }
+            barrier.Wait();
+
+            // Settle the bucket over its light edges, which may land back in it
+            while (true) {
+                // Share out every thread's list a block at a time
+                for (int t = 0; t < nThreads; t++) {
+                    const std::vector<Entry>& cur = threads[t].cur;
+                    const int nBlocks = ((int)cur.size() + BLOCK - 1) / BLOCK;
+                    for (int blk = (tid - t + nThreads) % nThreads; blk < nBlocks; blk += nThreads) {
+                        const int end = std::min((int)cur.size(), (blk + 1) * BLOCK);
+                        for (int i = blk * BLOCK; i < end; i++) {
+                            const Entry& e = cur[i];
+                            if (!IsCurrent(e) || grid.effort[e.idx] < 0) continue;
+                            ts.done.push_back(e);
+                            Relax(ts, e, true, bucket);
+                        }
+                    }
+                }
+                barrier.Wait();
+
+                ts.cur.clear();
+                ts.cur.swap(ts.next);
+                more[tid] = !ts.cur.empty();
+                barrier.Wait();
+
+                if (std::find(more.begin(), more.end(), 1) == more.end()) break;
+            }
+
+            // The bucket's costs are now final, so the heavy edges need relaxing just once
+            for (const Entry& e : ts.done) {
+                if (IsCurrent(e)) {
+                    Relax(ts, e, false, bucket);
+                }
+            }
+        }
+    }
+};
+
+using CostQueue = std::priority_queue<std::pair<float, int>, std::vector<std::pair<float, int>>,
+                                      std::greater<std::pair<float, int>>>;
+
+//! Dijkstra's algorithm from the tiles in the queue, lowering the cost of every tile it can
+void RunDijkstra(const EffortGrid& grid, CostQueue& pqueue, std::vector<float>& cost)
+{
+    while (!pqueue.empty()) {
+        const auto [g, id] = pqueue.top();
+        pqueue.pop();
+
+        // Skip stale queue entries and impassable tiles
+        if (g > cost[id] || grid.effort[id] < 0) continue;
+
+        const int ci = id % grid.dims.x;
+        const int cj = id / grid.dims.x;
+        for (int n = 0; n < EffortGrid::NN; n++) {
+            const int ni = ci + EffortGrid::DX[n];
+            const int nj = cj + EffortGrid::DY[n];
+            if (ni < 0 || ni >= grid.dims.x || nj < 0 || nj >= grid.dims.y) continue;
+
+            const int nidx = nj * grid.dims.x + ni;
+            if (grid.effort[nidx] < 0) continue;
+
+            const float tmp_g = g + EffortGrid::STEP[n] + grid.effort[nidx];
+            if (tmp_g < cost[nidx]) {
+                cost[nidx] = tmp_g;
+                pqueue.push({tmp_g, nidx});
+            }
+        }
+    }
+}
+
+} // namespace
+
+void ComputeCostField(const EffortGrid& grid, int source, std::vector<float>& cost)
+{
+    PROFILE_FUNC();
+
+    cost.assign(grid.Size(), FLT_MAX);
+    if (source < 0 || source >= grid.Size()) return;
+
+    CostQueue pqueue;
+    cost[source] = 0.f;
+    pqueue.push({0.f, source});
+
+    RunDijkstra(grid, pqueue, cost);
+}
+
+void RepairCostField(const EffortGrid& oldGrid, const EffortGrid& grid, int source, std::vector<float>& cost)
+{
+    PROFILE_FUNC();
+
+    enum : char { VALID, INVALID, SEEDED };
+
+    const int N = grid.Size();
+    std::vector<float> newCost(N, FLT_MAX);
+    std::vector<char> state(N, INVALID); // Tiles new to the window have nothing to keep
+    std::vector<int> stack;
+
+    // Carry the old costs over to where the windows overlap.  A tile whose
+    // effort changed, or which a tile that's left the window may have been
+    // reached from, can no longer trust its cost.
+    const WorldPos lo = {std::max(grid.origin.x, oldGrid.origin.x), std::max(grid.origin.y, oldGrid.origin.y)};
+    const WorldPos hi = {std::min(grid.origin.x + grid.dims.x, oldGrid.origin.x + oldGrid.dims.x),
+                         std::min(grid.origin.y + grid.dims.y, oldGrid.origin.y + oldGrid.dims.y)};
+    for (int64_t y = lo.y; y < hi.y; y++) {
+        for (int64_t x = lo.x; x < hi.x; x++) {
+            const int id = grid.IndexOf({x, y});
+            const int oid = oldGrid.IndexOf({x, y});
+            newCost[id] = cost[oid];
+
+            if (id != source && grid.effort[id] != oldGrid.effort[oid]) {
+                stack.push_back(id);
+                continue;
+            }
+            state[id] = VALID;
+
+            // Only the edge of the overlap borders tiles which have left
+            const bool edge = x == lo.x || x == hi.x - 1 || y == lo.y || y == hi.y - 1;
+            if (!edge || id == source || newCost[id] == FLT_MAX) continue;
+
+            for (int n = 0; n < EffortGrid::NN; n++) {
+                const WorldPos from = {x + EffortGrid::DX[n], y + EffortGrid::DY[n]};
+                if (!oldGrid.Contains(from) || grid.Contains(from)) continue;
+
+                const float g = cost[oldGrid.IndexOf(from)];
+                if (g != FLT_MAX && g + EffortGrid::STEP[n] + grid.effort[id] <= newCost[id]) {
+                    state[id] = INVALID;
+                    stack.push_back(id);
+                    break;
+                }
+            }
+        }
+    }
+
+    cost = std::move(newCost);
+
+    // Follow the old costs on from each invalid tile: any neighbor which may
+    // have been reached through it is invalid too
+    while (!stack.empty()) {
+        const int id = stack.back();
+        stack.pop_back();
+
+        const float g = cost[id];
+        if (g == FLT_MAX) continue;
+
+        const int ci = id % grid.dims.x;
+        const int cj = id / grid.dims.x;
+        for (int n = 0; n < EffortGrid::NN; n++) {
+            const int ni = ci + EffortGrid::DX[n];
+            const int nj = cj + EffortGrid::DY[n];
+            if (ni < 0 || ni >= grid.dims.x || nj < 0 || nj >= grid.dims.y) continue;
+
+            const int nidx = nj * grid.dims.x + ni;
+            if (state[nidx] != VALID || nidx == source || cost[nidx] == FLT_MAX) continue;
+
+            if (g + EffortGrid::STEP[n] + grid.effort[nidx] <= cost[nidx]) {
+                state[nidx] = INVALID;
+                stack.push_back(nidx);
+            }
+        }
+    }
+
+    // Throw the invalid costs away, and resume the search from the valid
+    // tiles around them
+    CostQueue pqueue;
+    for (int id = 0; id < N; id++) {
+        if (state[id] != INVALID) continue;
+        cost[id] = FLT_MAX;
+
+        const int ci = id % grid.dims.x;
+        const int cj = id / grid.dims.x;
+        for (int n = 0; n < EffortGrid::NN; n++) {
+            const int ni = ci + EffortGrid::DX[n];
+            const int nj = cj + EffortGrid::DY[n];
+            if (ni < 0 || ni >= grid.dims.x || nj < 0 || nj >= grid.dims.y) continue;
+
+            const int nidx = nj * grid.dims.x + ni;
+            if (state[nidx] == VALID && cost[nidx] != FLT_MAX) {
+                state[nidx] = SEEDED;
+                pqueue.push({cost[nidx], nidx});
+            }
+        }
+    }
+
+    RunDijkstra(grid, pqueue, cost);
+}
+
+void ComputeCostFieldTo(const EffortGrid& grid, int target, std::vector<float>& cost, int nn)
+{
+    PROFILE_FUNC();
+
+    cost.assign(grid.Size(), FLT_MAX);
+    if (target < 0 || target >= grid.Size()) return;
+
+    // Buckets only order the tiles to within 1/SCALE, so a tile may be popped
+    // before its cost is final; it's simply pushed and popped again once it
+    // improves, so the costs still come out exact
+    QueryContext ctx;
+    BucketOpenList open;
+    open.Reset(ctx);
+
+    uint32_t counter = 0;
+    cost[target] = 0.f;
+    open.Push({0.f, counter++, target});
+
+    while (!open.Empty()) {
+        const OpenEntry top = open.Pop();
+        const float g = top.f;
+        const int id = top.idx;
+
+        // Skip stale queue entries; nothing can move onto an impassable tile
+        if (g > cost[id] || grid.effort[id] < 0) continue;
+
+        const int ci = id % grid.dims.x;
+        const int cj = id / grid.dims.x;
+        for (int n = 0; n < nn; n++) {
+            const int ni = ci + EffortGrid::DX[n];
+            const int nj = cj + EffortGrid::DY[n];
+            if (ni < 0 || ni >= grid.dims.x || nj < 0 || nj >= grid.dims.y) continue;
+
+            // Only passable tiles can be moved off of
+            const int nidx = nj * grid.dims.x + ni;
+            if (grid.effort[nidx] < 0) continue;
+
+            const float tmp_g = g + EffortGrid::STEP[n] + grid.effort[id];
+            if (tmp_g < cost[nidx]) {
+                cost[nidx] = tmp_g;
+                open.Push({tmp_g, counter++, nidx});
+            }
+        }
+    }
+}
+
+void LazyCostField::Reset(const EffortGrid& _grid, int target, int _toward, int _nn, float _minEffort,
+                          const ALTHeuristic* _alt)
+{
+    grid = &_grid;
+    alt = _alt;
+    nn = _nn;
+    toward = grid->LocOf(_toward);
+    minEffort = _minEffort;
+    settled = 0;
+
+    tiles.Clear();
+    open.Clear();
+
+    if (target < 0 || target >= grid->Size()) return;
+
+    tiles[{target % grid->dims.x, target / grid->dims.x}] = {0.f, false};
+    open.Push({0.f, 0.f, target});
+}
+
+float LazyCostField::Get(int idx, std::chrono::steady_clock::time_point deadline)
+{
+    const int width = grid->dims.x;
+
+    const Tile* tile = tiles.Find({idx % width, idx / width});
+    if (tile && tile->closed) {
+        return tile->g;
+    }
+
+    // Backwards, the cost of reaching a tile from 'toward' is the heuristic
+    const LandmarkDist<EffortOctileDist> dist {{minEffort}, alt};
+    auto H = [&](const WorldPos& loc) { return alt ? dist(toward, loc) : dist.base(toward, loc); };
+
+    for (int steps = 1; !open.Empty(); steps++) {
+        // Checking the clock every tile would cost more than settling it;
+        // the search is left as it is, to be resumed by the next call
+        if (steps % 1024 == 0 && std::chrono::steady_clock::now() > deadline) {
+            return FLT_MAX;
+        }
+
+        const DepthEntry top = open.Pop();
+        const int id = top.idx;
+
+        const int ci = id % width;
+        const int cj = id / width;
+
+        Tile& cur = tiles[{ci, cj}];
+        if (cur.closed || top.g > cur.g) continue;
+        cur.closed = true;
+        settled++;
+
+        // Nothing can move onto an impassable tile
+        if (grid->effort[id] >= 0) {
+            for (int n = 0; n < nn; n++) {
+                const int ni = ci + EffortGrid::DX[n];
+                const int nj = cj + EffortGrid::DY[n];
+                if (ni < 0 || ni >= width || nj < 0 || nj >= grid->dims.y) continue;
+
+                // Only passable tiles can be moved off of
+                const int nidx = nj * width + ni;
+                if (grid->effort[nidx] < 0) continue;
+
+                const float tmp_g = top.g + EffortGrid::STEP[n] + grid->effort[id];
+
+                Tile* next = tiles.Find({ni, nj});
+                if (!next) {
+                    tiles[{ni, nj}] = {tmp_g, false};
+                } else if (next->closed || tmp_g >= next->g) {
+                    continue;
+                } else {
+                    next->g = tmp_g;
+                }
+
+                open.Push({tmp_g + H(grid->origin + WorldPos({ni, nj})), tmp_g, nidx});
+            }
+        }
+
+        if (id == idx) return top.g;
+    }
+
+    return FLT_MAX;
+}
+
+void ComputeCostFieldParallel(const EffortGrid& grid, int source, std::vector<float>& cost,
+                              std::vector<int>& parent, int nThreads, float delta)
+{
+    PROFILE_FUNC();
+
+    if (source < 0 || source >= grid.Size()) {
+        cost.assign(grid.Size(), FLT_MAX);
+        parent.assign(grid.Size(), -1);
+        return;
+    }
+
+    if (nThreads <= 0) {
+        nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    }
+
+    if (delta <= 0.f) {
+        // The costliest edge: each bucket then holds a wide wavefront for the
+        // threads to share, at the price of re-relaxing some tiles within it
+        float maxEffort = 0.f;
+        for (float e : grid.effort) {
+            maxEffort = std::max(maxEffort, e);
+        }
+        delta = SQRT2 + maxEffort;
+    }
+
+    DeltaStepping ds(grid, nThreads, delta);
+    ds.Run(source, cost, parent);
+}
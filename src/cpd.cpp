@@ -0,0 +1,338 @@
+/**
+ * @File: cpd.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Compressed Path Database (first-move tables) for static maps
+ */
+#include "cpd.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <queue>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t CPD_MAGIC = 0x50434450; // "PDCP"
+const uint32_t CPD_VERSION = 1;
+
+//! Marker for targets whose first move we don't care about
+const uint8_t ANY_MOVE = 0xF;
+
+struct CPDHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    int32_t dimsX;
+    int32_t dimsY;
+    uint64_t mapHash;
+    uint64_t nRuns;
+};
+
+/**
+ * Dijkstra search from 'source', recording for each tile which neighbor of
+ * the source the optimal path to it leaves through
+ */
+void ComputeFirstMoves(const EffortGrid& grid, int source, std::vector<float>& dist, std::vector<uint8_t>& moves)
+{
+    dist.assign(grid.Size(), FLT_MAX);
+    moves.assign(grid.Size(), ANY_MOVE);
+    if (grid.effort[source] < 0) return;
+
+    using Entry = std::pair<float, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> pqueue;
+    dist[source] = 0.f;
+    pqueue.push({0.f, source});
+
+    while (!pqueue.empty()) {
+        const auto [g, id] = pqueue.top();
+        pqueue.pop();
+        if (g > dist[id]) continue;
+
+        const int ci = id % grid.dims.x;
+        const int cj = id / grid.dims.x;
+        for (int n = 0; n < EffortGrid::NN; n++) {
+            const int ni = ci + EffortGrid::DX[n];
+            const int nj = cj + EffortGrid::DY[n];
+            if (ni < 0 || ni >= grid.dims.x || nj < 0 || nj >= grid.dims.y) continue;
+
+            const int nidx = nj * grid.dims.x + ni;
+            if (grid.effort[nidx] < 0) continue;
+
+            const float tmp_g = g + EffortGrid::STEP[n] + grid.effort[nidx];
+            if (tmp_g < dist[nidx]) {
+                dist[nidx] = tmp_g;
+                moves[nidx] = (id == source) ? (uint8_t)n : moves[id];
+                pqueue.push({tmp_g, nidx});
+            }
+        }
+    }
+}
+
+} // namespace
+
+CompressedPathDatabase::~CompressedPathDatabase()
+{
+    Unmap();
+}
+
+void CompressedPathDatabase::Unmap()
+{
+    if (mapping) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+}
+
+void CompressedPathDatabase::Build(const EffortGrid& grid)
+{
+    PROFILE_FUNC();
+
+    Unmap();
+
+    const int N = grid.Size();
+
+    auto neighbor = [&grid](int id, int n) {
+        const int ni = id % grid.dims.x + EffortGrid::DX[n];
+        const int nj = id / grid.dims.x + EffortGrid::DY[n];
+        if (ni < 0 || ni >= grid.dims.x || nj < 0 || nj >= grid.dims.y) return -1;
+        const int nidx = nj * grid.dims.x + ni;
+        return grid.effort[nidx] < 0 ? -1 : nidx;
+    };
+
+    // Label the connected components, and order the tiles depth-first so that
+    // tiles which are close in the ordering are close on the map
+    ownComp.assign(N, NO_COMPONENT);
+    ownOrder.assign(N, 0);
+    uint32_t nextPos = 0;
+    uint32_t nComp = 0;
+    std::vector<int> stack;
+    for (int root = 0; root < N; root++) {
+        if (grid.effort[root] < 0 || ownComp[root] != NO_COMPONENT) continue;
+
+        stack.push_back(root);
+        ownComp[root] = nComp;
+        while (!stack.empty()) {
+            const int id = stack.back();
+            stack.pop_back();
+            ownOrder[id] = nextPos++;
+
+            for (int n = EffortGrid::NN - 1; n >= 0; n--) {
+                const int nidx = neighbor(id, n);
+                if (nidx >= 0 && ownComp[nidx] == NO_COMPONENT) {
+                    ownComp[nidx] = nComp;
+                    stack.push_back(nidx);
+                }
+            }
+        }
+        nComp++;
+    }
+    for (int id = 0; id < N; id++) {
+        if (grid.effort[id] < 0) ownOrder[id] = nextPos++;
+    }
+
+    std::vector<int> byPos(N);
+    for (int id = 0; id < N; id++) {
+        byPos[ownOrder[id]] = id;
+    }
+
+    // Build each source's run-length-encoded row of first moves in parallel
+    std::vector<std::vector<uint32_t>> rows(N);
+    const int nThreads = std::max(1, (int)std::thread::hardware_concurrency());
+    std::vector<std::thread> workers;
+    for (int t = 0; t < nThreads; t++) {
+        workers.emplace_back([&, t]() {
+            std::vector<float> dist;
+            std::vector<uint8_t> moves;
+            for (int s = t; s < N; s += nThreads) {
+                ComputeFirstMoves(grid, s, dist, moves);
+
+                auto& row = rows[s];
+                uint8_t current = ANY_MOVE;
+                for (int k = 0; k < N; k++) {
+                    const uint8_t m = moves[byPos[k]];
+                    if (m == ANY_MOVE || m == current) continue;
+
+                    // The first run always starts at 0, covering any leading "don't care"s
+                    row.push_back(((row.empty() ? 0 : (uint32_t)k) << 4) | m);
+                    current = m;
+                }
+                row.shrink_to_fit();
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    ownOffsets.assign(N + 1, 0);
+    ownRuns.clear();
+    for (int s = 0; s < N; s++) {
+        ownOffsets[s] = (uint32_t)ownRuns.size();
+        ownRuns.insert(ownRuns.end(), rows[s].begin(), rows[s].end());
+    }
+    ownOffsets[N] = (uint32_t)ownRuns.size();
+
+    order = ownOrder.data();
+    comp = ownComp.data();
+    offsets = ownOffsets.data();
+    runs = ownRuns.data();
+    nRuns = ownRuns.size();
+    nNodes = N;
+    dims = grid.dims;
+    mapHash = grid.Hash();
+}
+
+bool CompressedPathDatabase::Save(const std::string& fname) const
+{
+    std::ofstream out(fname, std::ios::binary);
+    if (!out || !IsBuilt()) {
+        std::cout << "Unable to write path database to " << fname << std::endl;
+        return false;
+    }
+
+    const CPDHeader header {CPD_MAGIC, CPD_VERSION, dims.x, dims.y, mapHash, nRuns};
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(order), nNodes * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(comp), nNodes * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(offsets), (nNodes + 1) * sizeof(uint32_t));
+    out.write(reinterpret_cast<const char*>(runs), nRuns * sizeof(uint32_t));
+
+    return (bool)out;
+}
+
+bool CompressedPathDatabase::Load(const std::string& fname, const EffortGrid& grid)
+{
+    const int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(CPDHeader)) {
+        close(fd);
+        return false;
+    }
+
+    void* data = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) return false;
+
+    const CPDHeader* header = static_cast<const CPDHeader*>(data);
+    const size_t N = grid.Size();
+    const size_t expected = sizeof(CPDHeader) + (3 * N + 1 + header->nRuns) * sizeof(uint32_t);
+    if (header->magic != CPD_MAGIC || header->version != CPD_VERSION ||
+        header->dimsX != grid.dims.x || header->dimsY != grid.dims.y ||
+        header->mapHash != grid.Hash() ||
+        (size_t)st.st_size != expected) {
+        munmap(data, st.st_size);
+        return false;
+    }
+
+    Unmap();
+    mapping = data;
+    mappingSize = st.st_size;
+
+    const uint32_t* arrays = reinterpret_cast<const uint32_t*>(header + 1);
+    order = arrays;
+    comp = order + N;
+    offsets = comp + N;
+    runs = offsets + N + 1;
+    nRuns = header->nRuns;
+    nNodes = (int)N;
+    dims = grid.dims;
+    mapHash = header->mapHash;
+
+    ownOrder.clear();
+    ownComp.clear();
+    ownOffsets.clear();
+    ownRuns.clear();
+
+    return true;
+}
+
+int CompressedPathDatabase::FirstMove(int source, int target) const
+{
+    if (source < 0 || source >= nNodes || target < 0 || target >= nNodes) return -1;
+    if (source == target || comp[source] == NO_COMPONENT || comp[source] != comp[target]) return -1;
+
+    // Find the last run starting at or before the target's position
+    const uint32_t key = (order[target] << 4) | 0xF;
+    const uint32_t* first = runs + offsets[source];
+    const uint32_t* last = runs + offsets[source + 1];
+    const uint32_t* it = std::upper_bound(first, last, key);
+    if (it == first) return -1;
+
+    return (int)(*(it - 1) & 0xF);
+}
+
+void CPDPlanner::SetTerrainMap(GameMap& _map)
+{
+    map = &_map;
+}
+
+PathView CPDPlanner::GetPath()
+{
+    if (path_cost > 0)
+        return {final_path.data(), final_path.size(), path_cost, expansions};
+
+    return {nullptr, 0, path_cost, expansions};
+}
+
+bool CPDPlanner::ComputePath(WorldPos start, WorldPos goal)
+{
+    PROFILE_FUNC();
+
+    path_cost = -1.f;
+    expansions = 0;
+    Context().Begin();
+
+    // Rebuild whenever the terrain has been edited
+    if (!cpd.IsBuilt() || grid.version != map->GetTerrainVersion()) {
+        map->GetStaticEffortGrid(grid);
+        if (cacheFile.empty() || !cpd.Load(cacheFile, grid)) {
+            cpd.Build(grid);
+            if (!cacheFile.empty()) {
+                cpd.Save(cacheFile);
+            }
+        }
+    }
+
+    if (!grid.Contains(start) || !grid.Contains(goal)) {
+        return false;
+    }
+
+    final_path.clear();
+    final_path.push_back(start);
+    if (start == goal) {
+        path_cost = 0.f;
+        return true;
+    }
+
+    // Follow the first moves; every step lands on an optimal path to the goal
+    const int target = grid.IndexOf(goal);
+    int id = grid.IndexOf(start);
+    float cost = 0.f;
+    while (id != target) {
+        const int n = cpd.FirstMove(id, target);
+        if (n < 0 || (int)final_path.size() > grid.Size()) {
+            final_path.clear();
+            return false;
+        }
+
+        expansions++;
+        const WorldPos loc = grid.LocOf(id) + WorldPos({EffortGrid::DX[n], EffortGrid::DY[n]});
+        id = grid.IndexOf(loc);
+        cost += EffortGrid::STEP[n] + grid.effort[id];
+        final_path.push_back(loc);
+    }
+
+    path_cost = cost;
+    return true;
+}
@@ -8,6 +8,9 @@
  */
 #include "gamemap.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
 #include <set>
 
 GameMap::~GameMap()
@@ -15,6 +18,10 @@ GameMap::~GameMap()
     if (tileSet) {
         delete tileSet;
     }
+
+    if (chunkStore) {
+        delete chunkStore;
+    }
 }
 
 void GameMap::GenerateMap()
@@ -47,24 +54,22 @@ void GameMap::GenerateMap()
         tileSet = nullptr;
     }
 
-    tileSet = new TileSet(pge, "resources/lpc-terrains/reduced-tileset-1.png", layers, N_LAYERS);
+    if (pge) {
+        tileSet = new TileSet(pge, "resources/lpc-terrains/reduced-tileset-1.png", layers, N_LAYERS);
+    }
 
     // Load / Create the map definition
-
     int32_t nx = config.dims.x;
     int32_t ny = config.dims.y;
-    int32_t n_tiles = nx * ny;
-    int32_t n_grid = (nx - 1) * (ny - 1);
 
     dims.x = nx;
     dims.y = ny;
 
-    std::vector<uint8_t> texmap(n_tiles);
-
     switch (config.mapType) {
         case MapType::PROCEDURAL: {
 #ifdef ENABLE_LIBNOISE
             PROFILE("Perlin MapGen");
+
             // Configure the relative amounts of each terrain type
             if (config.terrainWeights.size() != N_LAYERS) {
                 printf("ERROR: Incorrect number of terrain weights given (expected %d, got %lu)\n", N_LAYERS, config.terrainWeights.size());
@@ -88,18 +93,29 @@ void GameMap::GenerateMap()
 
             /// Experimenting with Perlin noise from libnoise
             SetNoiseSeed(config.noiseSeed);
-            for (int j = 0; j < ny; j++) {
-                for (int i = 0; i < nx; i++) {
-                    TERRAIN_TYPE val = GetTerrainAt(i, j);
 
-                    texmap[j*nx + i] = (uint8_t)val;
-                }
+            // Layers are generated as their chunks are first needed, unless already on disk
+            noiseBlocks.Clear();
+            noiseOrder.clear();
+            noiseOrder.reserve(MAX_NOISE_BLOCKS);
+            noiseOldest = 0;
+            lastNoiseBlock = nullptr;
+
+            if (chunkStore) {
+                delete chunkStore;
+                chunkStore = nullptr;
+            }
+            if (config.chunkCache) {
+                chunkStore = new ChunkStore(config.fConfig + ".chunks", NoiseKey());
             }
 
-            olc::vi2d nchunks = {pge->ScreenWidth()/TH/ChunkSize.x + 3, pge->ScreenHeight()/TH/ChunkSize.y + 3};
+            // Room in the pool for the whole chunk window, so that scrolling needn't allocate
+            const olc::vi2d nchunks = ViewChunks();
+            chunkPool.Reserve(nchunks.x * nchunks.y);
+
             for (int j = -1; j < nchunks.y - 1; j++) {
                 for (int i = -1; i < nchunks.x - 1; i++) {
-                    olc::vi2d start = {ChunkSize.x*i, ChunkSize.y*j};
+                    WorldPos start = {ChunkSize.x*i, ChunkSize.y*j};
                     if (start.x >= dims.x || start.y >= dims.y)
                         continue;
 
@@ -107,8 +123,8 @@ void GameMap::GenerateMap()
                 }
             }
 
-            chidTL = -ChunkSize;
-            chidBR = (nchunks - olc::vi2d({1,1})) * ChunkSize;
+            chidTL = {-ChunkSize.x, -ChunkSize.y};
+            chidBR = {(nchunks.x - 1) * ChunkSize.x, (nchunks.y - 1) * ChunkSize.y};
 #else
             printf("Unable to generate procedural map without libnoise\nSet ENABLE_LIBNOISE to build");
             exit(1);
@@ -117,24 +133,25 @@ void GameMap::GenerateMap()
         }
 
         case MapType::STATIC: {
-            texmap = config.map;
-            if (texmap.size() != (size_t)n_tiles) {
-                printf("Invalid map input - expected %d tiles, got %lu\n", n_tiles, texmap.size());
+            if (!LoadStaticMap()) {
                 exit(1);
             }
-
-            // Constrain the inputs to be within our layer definitions
-            for (uint32_t i = 0; i < texmap.size(); i++) {
-                texmap[i] = (uint8_t)std::min(std::max(0, (int)texmap[i]), N_LAYERS - 1);
-            }
-
-            for (int j = 0; j < pge->ScreenHeight()/ChunkSize.y + 1; j++) {
-                for (int i = 0; i < pge->ScreenWidth()/ChunkSize.x + 1; i++) {
-                    olc::vi2d start = {ChunkSize.x*i, ChunkSize.y*j};
-                    if (start.x > dims.x || start.y > dims.y)
-                        continue;
-
+            dims = terrain.GetDims();
+
+            // Load the chunk window, or the whole map if it's smaller, and make
+            // room in the pool for that many chunks
+            const olc::vi2d nchunks = {
+                std::min(ViewChunks().x, (dims.x + ChunkSize.x - 1) / ChunkSize.x),
+                std::min(ViewChunks().y, (dims.y + ChunkSize.y - 1) / ChunkSize.y)};
+            chunkPool.Reserve(nchunks.x * nchunks.y);
+
+            chidTL = {0, 0};
+            chidBR = {0, 0};
+            for (int j = 0; j < nchunks.y; j++) {
+                for (int i = 0; i < nchunks.x; i++) {
+                    WorldPos start = {ChunkSize.x*i, ChunkSize.y*j};
                     AddChunk(start, ChunkSize);
+                    chidBR = {std::max(chidBR.x, start.x), std::max(chidBR.y, start.y)};
                 }
             }
 
@@ -146,148 +163,640 @@ void GameMap::GenerateMap()
             exit(1);
             break;
     }
+
+    version = NextVersion();
+    terrainVersion = version;
+
+    MapChange change;
+    change.kind = MAP_GENERATED;
+    change.version = version;
+    change.tl = GetChunkExtents()[0];
+    change.br = GetChunkExtents()[1];
+    for (const auto& entry : chunks) {
+        change.chunks.push_back(entry.first);
+        change.nTiles += entry.second.NumTiles();
+    }
+    Notify(change);
 };
 
-void GameMap::AddChunk(olc::vi2d start, olc::vi2d size)
+uint64_t GameMap::NextVersion()
+{
+    static std::atomic<uint64_t> counter {0};
+    return ++counter;
+}
+
+void GameMap::Notify(const MapChange& change)
 {
-    if (chunks.count(start)) return;
+    for (const auto& entry : subscribers) {
+        entry.second(change);
+    }
+}
+
+void GameMap::ChunkChange(MapChange& change, MapChangeKind kind, WorldPos start, olc::vi2d size) const
+{
+    change.kind = kind;
+    change.tl = start;
+    change.br = start + WorldPos({size.x, size.y});
+    change.chunks.assign(1, start);
+    change.nTiles = size.x * size.y;
+}
+
+uint64_t GameMap::GetChunkVersion(const WorldPos& start) const
+{
+    const MapChunk* chunk = chunks.Find(start);
+    return chunk ? chunk->version : 0;
+}
+
+void GameMap::AddChunk(WorldPos start, olc::vi2d size)
+{
+    if (chunks.Contains(start)) return;
+
+    version = NextVersion();
 
     auto& chunk = chunks[start];
     chunk.coord = start;
     chunk.dims = size;
-    chunk.tiles.resize(size.x * size.y);
+    chunk.slot = chunkPool.Acquire();
+    chunk.tiles = chunkPool.TilesOf(chunk.slot);
+    chunk.effort = chunkPool.EffortOf(chunk.slot);
+    chunk.version = version;
 
     // First, assign the terrain type to each tile
     for (int j = 0; j < size.y; j++) {
-        const int iy = start.y + j;
+        const int64_t iy = start.y + j;
         for (int i = 0; i < size.x; i++) {
-            const int ix = start.x + i;
+            const int64_t ix = start.x + i;
             const uint8_t layer = GetLayerAt(ix, iy);
             const TERRAIN_TYPE tt = (TERRAIN_TYPE)layers[layer];
 
-            Tile& tile = chunk.tiles[j*size.x + i];
-            tile.layer = layer;
-            tile.fEffort = teffort.at(tt);
+            const int k = chunk.IndexOf(i, j);
+            chunk.effort[k] = effortEdits.empty() ? teffort.at(tt) : EffortOf({ix, iy}, layer);
 
-            // Note:
-            // With how we're currently creating the terrain, we need to offset
-            // the sprites by half a tile size for this to actually work
+            Tile& tile = chunk.tiles[k];
+            tile.layer = layer;
             tile.vTileCoord = {ix, iy};
-            tile.vScreenPos = {(float)(ix * TW - TW/2), float(iy * TH - TH/2)};
             tile.pge = pge;
         }
     }
 
-    // Next, apply the correct texture for each tile
-    for (int j = 0; j < size.y; j++) {
-        for (int i = 0; i < size.x; i++) {
-            Tile& tile = chunk.tiles[j*size.x + i];
-            const uint8_t myL = tile.layer;
-            std::array<uint8_t, 4> bcs = {myL, myL, myL, myL};
-            const int ix = tile.vTileCoord.x;
-            const int iy = tile.vTileCoord.y;
-
-            // Copy the neighborhood
-            bcs[0] = GetLayerAt(ix - 1, iy - 1);
-            bcs[1] = GetLayerAt(ix, iy - 1);
-            bcs[2] = GetLayerAt(ix, iy);
-            bcs[3] = GetLayerAt(ix - 1, iy);
-
-            tile.dTexture = tileSet->GetTextureFor(bcs, tile.vTileCoord);
+    // Next, apply the correct texture for each tile (none when running headless)
+    if (!tileSet) return;
+
+    for (int k = 0; k < chunk.NumTiles(); k++) {
+        UpdateTexture(chunk.tiles[k]);
+    }
+}
+
+void GameMap::UpdateTexture(Tile& tile)
+{
+    const int64_t ix = tile.vTileCoord.x;
+    const int64_t iy = tile.vTileCoord.y;
+
+    // Copy the neighborhood
+    std::array<uint8_t, 4> bcs;
+    bcs[0] = GetLayerAt(ix - 1, iy - 1);
+    bcs[1] = GetLayerAt(ix, iy - 1);
+    bcs[2] = GetLayerAt(ix, iy);
+    bcs[3] = GetLayerAt(ix - 1, iy);
+
+    tile.dTexture = tileSet->GetTextureFor(bcs, tile.vTileCoord);
+}
+
+void GameMap::RemoveChunk(WorldPos start)
+{
+    const MapChunk* chunk = chunks.Find(start);
+    if (!chunk) return;
+
+    chunkPool.Release(chunk->slot);
+    chunks.Erase(start);
+
+    version = NextVersion();
+}
+
+bool GameMap::LoadStaticMap()
+{
+    // Already set up by an earlier GenerateMap()
+    if (terrain.IsLoaded()) return true;
+
+    if (!config.mapImage.empty()) {
+        ImageLegend legend;
+        legend.palette = config.imagePalette;
+        legend.colors = config.imageColors;
+        if (legend.colors.empty()) {
+            legend.colors.assign(layerColors, layerColors + N_LAYERS);
         }
+
+        if (!LoadImageTerrain(config.mapImage, legend, std::vector<uint8_t>(layers, layers + N_LAYERS), terrain)) {
+            return false;
+        }
+
+    } else if (!config.mapTmx.empty()) {
+        TmxLegend legend;
+        legend.terrains = config.tmxTerrains;
+        legend.terrains.insert(legend.terrains.end(), tmxTerrains.begin(), tmxTerrains.end());
+        legend.fallback = 1; // Grass
+
+        if (!LoadTmxTerrain(config.mapTmx, legend, std::vector<uint8_t>(layers, layers + N_LAYERS), terrain)) {
+            return false;
+        }
+
+    } else if (!config.mapFile.empty()) {
+        if (!terrain.Load(config.mapFile)) {
+            return false;
+        }
+
+    } else {
+        const int32_t n_tiles = config.dims.x * config.dims.y;
+        if (config.map.size() != (size_t)n_tiles) {
+            printf("Invalid map input - expected %d tiles, got %lu\n", n_tiles, config.map.size());
+            return false;
+        }
+
+        if (!terrain.Create(config.dims, std::vector<uint8_t>(layers, layers + N_LAYERS))) {
+            return false;
+        }
+
+        // Constrain the inputs to be within our layer definitions
+        for (int j = 0; j < config.dims.y; j++) {
+            for (int i = 0; i < config.dims.x; i++) {
+                const int val = config.map[j*config.dims.x + i];
+                terrain.Set(i, j, (uint8_t)std::min(std::max(0, val), N_LAYERS - 1));
+            }
+        }
+
+        // The terrain holds its own copy now
+        config.map.clear();
+        config.map.shrink_to_fit();
     }
+
+    // Match each terrain type of the map to one of our layers
+    const std::vector<uint8_t>& types = terrain.GetTypes();
+    for (int v = 0; v < 256; v++) {
+        fileLayer[v] = N_LAYERS - 1;
+        for (uint8_t l = 0; l < N_LAYERS && v < (int)types.size(); l++) {
+            if (layers[l] == types[v]) {
+                fileLayer[v] = l;
+                break;
+            }
+        }
+    }
+
+    return true;
 }
 
-void GameMap::RemoveChunk(olc::vi2d start)
+bool GameMap::SaveMapFile(const std::string& fname)
 {
-    if (!chunks.count(start)) return;
+    if (config.mapType != MapType::STATIC || !terrain.IsLoaded()) {
+        printf("Only a generated static map can be saved to a map file\n");
+        return false;
+    }
 
-    chunks.erase(start);
+    return terrain.Save(fname);
 }
 
-uint8_t GameMap::GetLayerAt(int ix, int iy)
+uint8_t GameMap::GetLayerAt(int64_t ix, int64_t iy)
 {
+    if (!layerEdits.empty()) {
+        const auto it = layerEdits.find({ix, iy});
+        if (it != layerEdits.end()) {
+            return it->second;
+        }
+    }
+
     // Not in an existing chunk; calculate it, look it up, or
     if (config.mapType == MapType::STATIC) {
         if (ix >= 0 && ix < dims.x && iy >= 0 && iy < dims.y) {
-            return config.map[iy*dims.x + ix];
+            return fileLayer[terrain.Get((int)ix, (int)iy)];
         }
         return N_LAYERS;
 
     } else {
-        double x = (double)iy  / (double)config.dims.x;
-        double y = (double)ix  / (double)config.dims.y;
-        double val = GetNoise(config.noiseScale*x, config.noiseScale*y); // Noise value in range [0, 1]
-        if (val <= tRangeSums[0]) { val = 0; }
-        else if (val <= tRangeSums[1]) { val = 1; }
-        else if (val <= tRangeSums[2]) { val = 2; }
-        else if (val <= tRangeSums[3]) { val = 3; }
-        else { val = 4; }
+        const WorldPos start = ChunkOf({ix, iy});
+        if (!lastNoiseBlock || start != lastNoiseStart) {
+            lastNoiseBlock = NoiseBlock(start);
+            lastNoiseStart = start;
+        }
+
+        return lastNoiseBlock[(iy - start.y) * CHUNK_SIZE + (ix - start.x)];
+    }
+}
+
+const uint8_t* GameMap::NoiseBlock(WorldPos start)
+{
+    constexpr size_t blockSize = CHUNK_SIZE * CHUNK_SIZE;
+
+    if (const int* slot = noiseBlocks.Find(start)) {
+        return noiseSlabs[*slot / NOISE_SLAB_BLOCKS].get() + (*slot % NOISE_SLAB_BLOCKS) * blockSize;
+    }
+
+    // Once full, take over the oldest block's slot; it can always be made again
+    size_t slot;
+    if (noiseOrder.size() >= MAX_NOISE_BLOCKS) {
+        slot = noiseOldest;
+        noiseBlocks.Erase(noiseOrder[slot]);
+        noiseOrder[slot] = start;
+        noiseOldest = (noiseOldest + 1) % MAX_NOISE_BLOCKS;
+        lastNoiseBlock = nullptr;
+    } else {
+        slot = noiseOrder.size();
+        noiseOrder.push_back(start);
+        if (slot / NOISE_SLAB_BLOCKS >= noiseSlabs.size()) {
+            noiseSlabs.emplace_back(new uint8_t[NOISE_SLAB_BLOCKS * blockSize]);
+        }
+    }
+    noiseBlocks[start] = (int)slot;
 
-        return (uint8_t)val;
+    uint8_t* block = noiseSlabs[slot / NOISE_SLAB_BLOCKS].get() + (slot % NOISE_SLAB_BLOCKS) * blockSize;
+
+    if (chunkStore && chunkStore->Read(start, block, blockSize)) {
+        return block;
+    }
+
+    for (int j = 0; j < CHUNK_SIZE; j++) {
+        for (int i = 0; i < CHUNK_SIZE; i++) {
+            block[j * CHUNK_SIZE + i] = NoiseLayerAt(start.x + i, start.y + j);
+        }
     }
+
+    if (chunkStore) {
+        chunkStore->Write(start, block, blockSize);
+    }
+
+    return block;
 }
 
-TERRAIN_TYPE GameMap::GetTerrainAt(int ix, int iy)
+uint64_t GameMap::NoiseKey() const
+{
+    // FNV-1a over the generator's parameters
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t len) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < len; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+
+    const int32_t chunkSize = CHUNK_SIZE;
+    mix(&config.noiseSeed, sizeof(config.noiseSeed));
+    mix(&config.noiseScale, sizeof(config.noiseScale));
+    mix(&config.dims.x, sizeof(config.dims.x)); // The noise is scaled by the map's dims
+    mix(&config.dims.y, sizeof(config.dims.y));
+    mix(&chunkSize, sizeof(chunkSize));
+    mix(tRangeSums.data(), tRangeSums.size() * sizeof(float));
+    return hash;
+}
+
+uint8_t GameMap::NoiseLayerAt(int64_t ix, int64_t iy)
+{
+    double x = (double)iy  / (double)config.dims.x;
+    double y = (double)ix  / (double)config.dims.y;
+    double val = GetNoise(config.noiseScale*x, config.noiseScale*y); // Noise value in range [0, 1]
+    if (val <= tRangeSums[0]) { val = 0; }
+    else if (val <= tRangeSums[1]) { val = 1; }
+    else if (val <= tRangeSums[2]) { val = 2; }
+    else if (val <= tRangeSums[3]) { val = 3; }
+    else { val = 4; }
+
+    return (uint8_t)val;
+}
+
+TERRAIN_TYPE GameMap::GetTerrainAt(int64_t ix, int64_t iy)
 {
     return (TERRAIN_TYPE)layers[GetLayerAt(ix, iy)];
 }
 
-float GameMap::GetEffortAt(int ix, int iy)
+float GameMap::GetEffortAt(int64_t ix, int64_t iy)
+{
+    int k;
+    const MapChunk* chunk = FindChunk({ix, iy}, k);
+    return chunk ? chunk->effort[k] : -1.f;
+}
+
+float GameMap::EffortOf(WorldPos loc, uint8_t layer) const
+{
+    const auto it = effortEdits.find(loc);
+    if (it != effortEdits.end()) {
+        return it->second;
+    }
+
+    return teffort.at((TERRAIN_TYPE)layers[layer]);
+}
+
+WorldPos GameMap::ChunkOf(WorldPos loc) const
+{
+    // Chunks start at whole multiples of the chunk size
+    return {FloorDiv(loc.x, ChunkSize.x) * ChunkSize.x, FloorDiv(loc.y, ChunkSize.y) * ChunkSize.y};
+}
+
+MapChunk* GameMap::FindChunk(WorldPos loc, int& index)
+{
+    MapChunk* chunk = chunks.Find(ChunkOf(loc));
+    if (!chunk) return nullptr;
+
+    // Within a chunk, tiles are addressed in 32 bits
+    const int i = (int)(loc.x - chunk->coord.x);
+    const int j = (int)(loc.y - chunk->coord.y);
+    if (i >= chunk->dims.x || j >= chunk->dims.y) return nullptr;
+
+    index = chunk->IndexOf(i, j);
+    return chunk;
+}
+
+Tile* GameMap::FindTile(WorldPos loc)
+{
+    int k;
+    MapChunk* chunk = FindChunk(loc, k);
+    return chunk ? &chunk->tiles[k] : nullptr;
+}
+
+void GameMap::SetLayerAt(int64_t ix, int64_t iy, uint8_t layer)
+{
+    pendingEdits.push_back({{ix, iy}, true, std::min(layer, (uint8_t)(N_LAYERS - 1)), 0.f});
+    if (editDepth == 0) {
+        CommitEdits();
+    }
+}
+
+void GameMap::SetTerrainAt(int64_t ix, int64_t iy, TERRAIN_TYPE type)
+{
+    for (uint8_t l = 0; l < N_LAYERS; l++) {
+        if (layers[l] == type) {
+            SetLayerAt(ix, iy, l);
+            return;
+        }
+    }
+
+    printf("ERROR: No layer for terrain type %d\n", type);
+}
+
+void GameMap::SetEffortAt(int64_t ix, int64_t iy, float effort)
 {
+    pendingEdits.push_back({{ix, iy}, false, 0, effort});
+    if (editDepth == 0) {
+        CommitEdits();
+    }
+}
+
+void GameMap::EndEdits()
+{
+    if (editDepth == 0) {
+        printf("ERROR: EndEdits() called without BeginEdits()\n");
+        return;
+    }
+
+    if (--editDepth == 0) {
+        CommitEdits();
+    }
+}
+
+int GameMap::Subscribe(MapCallback callback)
+{
+    subscribers[nextSubscriber] = std::move(callback);
+    return nextSubscriber++;
+}
+
+void GameMap::Unsubscribe(int id)
+{
+    subscribers.erase(id);
+}
+
+void GameMap::CommitEdits()
+{
+    PROFILE_FUNC();
+
+    std::set<WorldPos> changed;
+    std::set<WorldPos> retexture;
+    std::set<WorldPos> dirtyChunks;
+
+    // The minimum effort only needs a rescan if the tile holding it is edited
+    bool rescanMin = false;
+
+    for (const PendingEdit& edit : pendingEdits) {
+        const WorldPos loc = edit.loc;
+        const uint8_t oldLayer = GetLayerAt(loc.x, loc.y);
+        const float oldEffort = EffortOf(loc, oldLayer);
+
+        const auto old = effortEdits.find(loc);
+        if (old != effortEdits.end() && old->second == minEffort) {
+            rescanMin = true;
+        }
+
+        if (edit.isLayer) {
+            layerEdits[loc] = edit.layer;
+            effortEdits.erase(loc);
+        } else {
+            effortEdits[loc] = edit.effort;
+            if (edit.effort >= 0) {
+                minEffort = std::min(minEffort, edit.effort);
+            }
+        }
+
+        const uint8_t layer = GetLayerAt(loc.x, loc.y);
+        const float effort = EffortOf(loc, layer);
+        if (layer == oldLayer && effort == oldEffort) continue;
+
+        changed.insert(loc);
+
+        int k;
+        if (MapChunk* chunk = FindChunk(loc, k)) {
+            chunk->tiles[k].layer = layer;
+            chunk->effort[k] = effort;
+            dirtyChunks.insert(chunk->coord);
+        }
+
+        // Each tile's texture is built from the layers at its four corners:
+        // itself, and its neighbors up and to the left
+        if (layer != oldLayer) {
+            retexture.insert({loc.x, loc.y});
+            retexture.insert({loc.x + 1, loc.y});
+            retexture.insert({loc.x, loc.y + 1});
+            retexture.insert({loc.x + 1, loc.y + 1});
+        }
+    }
+    pendingEdits.clear();
+
+    if (rescanMin) {
+        minEffort = TerrainMinEffort();
+        for (const auto& entry : effortEdits) {
+            if (entry.second >= 0) {
+                minEffort = std::min(minEffort, entry.second);
+            }
+        }
+    }
+
+    if (changed.empty()) return;
+
+    version = NextVersion();
+    terrainVersion = version;
+    for (const WorldPos& chid : dirtyChunks) {
+        chunks[chid].version = version;
+    }
+
+    if (tileSet) {
+        for (const WorldPos& loc : retexture) {
+            if (Tile* tile = FindTile(loc)) {
+                UpdateTexture(*tile);
+            }
+        }
+    }
+
+    MapChange change;
+    change.kind = TERRAIN_EDITED;
+    change.version = version;
+    change.tl = *changed.begin();
+    change.br = change.tl;
+    for (const WorldPos& loc : changed) {
+        change.tl = {std::min(change.tl.x, loc.x), std::min(change.tl.y, loc.y)};
+        change.br = {std::max(change.br.x, loc.x + 1), std::max(change.br.y, loc.y + 1)};
+    }
+    change.chunks.assign(dirtyChunks.begin(), dirtyChunks.end());
+    change.nTiles = (int)changed.size();
+
+    Notify(change);
+}
+
+float GameMap::TerrainMinEffort() const
+{
+    float minTerrain = FLT_MAX;
+    for (const auto& entry : teffort) {
+        if (entry.second >= 0) {
+            minTerrain = std::min(minTerrain, entry.second);
+        }
+    }
+    return minTerrain;
+}
+
+uint64_t EffortGrid::Hash() const
+{
+    // FNV-1a over the dimensions and effort values
+    uint64_t hash = 14695981039346656037ull;
+    auto mix = [&hash](const void* data, size_t len) {
+        const uint8_t* bytes = static_cast<const uint8_t*>(data);
+        for (size_t i = 0; i < len; i++) {
+            hash = (hash ^ bytes[i]) * 1099511628211ull;
+        }
+    };
+
+    mix(&dims.x, sizeof(dims.x));
+    mix(&dims.y, sizeof(dims.y));
+    mix(effort.data(), effort.size() * sizeof(float));
+    return hash;
+}
+
+void GameMap::GetEffortGrid(EffortGrid& grid)
+{
+    PROFILE_FUNC();
+
+    auto extents = GetChunkExtents();
+    grid.origin = extents[0];
+    grid.dims = {(int)(extents[1].x - extents[0].x), (int)(extents[1].y - extents[0].y)};
+    grid.effort.assign(grid.Size(), -1.f);
+    grid.version = version;
+
+    // Walk each chunk's tiles in memory order, whatever its layout
     for (const auto& entry : chunks) {
-        auto& chunk = entry.second;
-        if (ix >= chunk.coord.x && ix < chunk.coord.x + chunk.dims.x &&
-            iy >= chunk.coord.y && iy < chunk.coord.y + chunk.dims.y) {
-                int i = ix - chunk.coord.x;
-                int j = iy - chunk.coord.y;
-                return chunk.tiles[j*chunk.dims.x + i].fEffort;
+        const auto& chunk = entry.second;
+        for (int k = 0; k < chunk.NumTiles(); k++) {
+            const olc::vi2d ij = chunk.LocalOf(k);
+            const WorldPos loc = chunk.coord + WorldPos({ij.x, ij.y});
+            if (grid.Contains(loc)) {
+                grid.effort[grid.IndexOf(loc)] = chunk.effort[k];
             }
+        }
+    }
+}
+
+void GameMap::GetStaticEffortGrid(EffortGrid& grid)
+{
+    grid.origin = {0, 0};
+    grid.dims = dims;
+    grid.effort.resize(grid.Size());
+    grid.version = terrainVersion;
+
+    for (int j = 0; j < dims.y; j++) {
+        for (int i = 0; i < dims.x; i++) {
+            grid.effort[j*dims.x + i] = EffortOf({i, j}, GetLayerAt(i, j));
+        }
     }
+}
 
-    return -1.f;
+olc::vi2d GameMap::ViewChunks() const
+{
+    const olc::vi2d view = GetViewSize();
+    return {view.x/TH/ChunkSize.x + 3, view.y/TH/ChunkSize.y + 3};
 }
 
-void GameMap::Draw(const olc::vi2d& offset)
+void GameMap::Draw(const WorldPos& camera)
 {
     for (auto& entry : chunks) {
-        for (auto& tile : entry.second.tiles) {
-            tile.Draw(offset);
+        const MapChunk& chunk = entry.second;
+        for (int k = 0; k < chunk.NumTiles(); k++) {
+            chunk.tiles[k].Draw(camera);
         }
     }
 
-    olc::vi2d new_idxTL = offset / olc::vi2d({TW, TH});
-    olc::vi2d new_idxBR = new_idxTL + olc::vi2d({(pge->ScreenWidth() + TW/2) / TW, (pge->ScreenHeight() + TH/2) / TH});
+    UpdateView(camera);
+}
+
+void GameMap::UpdateView(const WorldPos& camera)
+{
+    const olc::vi2d view = GetViewSize();
+    const WorldPos new_idxTL = {FloorDiv(camera.x, TW), FloorDiv(camera.y, TH)};
+    const WorldPos new_idxBR = new_idxTL + WorldPos({(view.x + TW/2) / TW, (view.y + TH/2) / TH});
 
     if (new_idxTL.x != idxTL.x || new_idxTL.y != idxTL.y) {
         // Remove "dead" chunks, add new chunks
-        const olc::vi2d nchunks = {pge->ScreenWidth()/TH/ChunkSize.x + 3, pge->ScreenHeight()/TH/ChunkSize.y + 3};
-        const olc::vi2d new_chidTL = (idxTL / ChunkSize) * ChunkSize - ChunkSize; // Integer multiples of ChunkSize
-        const olc::vi2d new_chidBR = new_chidTL + ChunkSize * nchunks;
+        const olc::vi2d nchunks = ViewChunks();
+        const WorldPos new_chidTL = ChunkOf(new_idxTL) - WorldPos({ChunkSize.x, ChunkSize.y}); // Integer multiples of ChunkSize
+        const WorldPos new_chidBR = new_chidTL + WorldPos({ChunkSize.x * nchunks.x, ChunkSize.y * nchunks.y});
 
         if (new_chidTL != chidTL) {
             // std::cout << "Old chunk extents: " << chidTL << " -> " << chidBR << std::endl;
             // std::cout << "New chunk extents: " << new_chidTL << " -> " << new_chidBR << std::endl;
 
-            std::set<olc::vi2d> desired_chids;
-            for (int i = 0; i < nchunks.x; i++) {
-                for (int j = 0; j < nchunks.y; j++) {
-                    desired_chids.insert({new_chidTL.x + i*ChunkSize.x, new_chidTL.y + j*ChunkSize.y});
+            // Everything here reuses storage from earlier moves: with the chunks' tiles
+            // drawn from the pool, scrolling the map makes no heap allocations
+            dropChunks.clear();
+            for (auto& entry : chunks) {
+                const WorldPos chid = entry.first;
+                if (chid.x < new_chidTL.x || chid.x >= new_chidBR.x ||
+                    chid.y < new_chidTL.y || chid.y >= new_chidBR.y) {
+                    dropChunks.push_back(chid);
                 }
             }
 
-            std::set<olc::vi2d> remove_chids;
-            for (auto& entry : chunks) {
-                if (!desired_chids.count(entry.first)) {
-                    remove_chids.insert(entry.first);
+            // Move the window first, so that subscribers see the map as it now is
+            chidTL = new_chidTL;
+            chidBR = new_chidBR;
+
+            size_t nChanges = 0;
+            auto nextChange = [this, &nChanges]() -> MapChange& {
+                if (nChanges == viewChanges.size()) {
+                    viewChanges.emplace_back();
                 }
-            }
-            for (auto chid : remove_chids) {
+                return viewChanges[nChanges++];
+            };
+
+            for (auto chid : dropChunks) {
+                const olc::vi2d size = chunks[chid].dims;
                 RemoveChunk(chid);
+                ChunkChange(nextChange(), CHUNK_REMOVED, chid, size);
+            }
+
+            for (int i = 0; i < nchunks.x; i++) {
+                for (int j = 0; j < nchunks.y; j++) {
+                    const WorldPos chid = {new_chidTL.x + i*ChunkSize.x, new_chidTL.y + j*ChunkSize.y};
+                    if (!chunks.Contains(chid)) {
+                        AddChunk(chid, ChunkSize);
+                        ChunkChange(nextChange(), CHUNK_ADDED, chid, ChunkSize);
+                    }
+                }
             }
 
-            for (auto chid : desired_chids) {
-                AddChunk(chid, ChunkSize);
+            // Only tell of the changes once they've all been made
+            for (size_t k = 0; k < nChanges; k++) {
+                viewChanges[k].version = version;
+                Notify(viewChanges[k]);
             }
         }
 
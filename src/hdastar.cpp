@@ -0,0 +1,342 @@
+/**
+ * @File: hdastar.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Hash-Distributed A* (HDA*): a single A* query split across threads
+ */
+
+#include "hdastar.hpp"
+#include "heuristics.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <thread>
+
+namespace
+{
+
+int ThreadCount(int nThreads)
+{
+    nThreads = nThreads > 0 ? nThreads : (int)std::thread::hardware_concurrency();
+    return std::max(nThreads, 1);
+}
+
+}
+
+HDAStar::HDAStar(int _nThreads, HeuristicType heuristic, int connectivity, float epsilon) :
+    nThreads(ThreadCount(_nThreads)), heuristic(heuristic), connectivity(connectivity), weight(1.f + epsilon),
+    pool(nThreads)
+{
+    for (int i = 0; i < nThreads; i++) {
+        workers.emplace_back(new Worker);
+        workers.back()->id = i;
+        workers.back()->outbox.assign(nThreads, nullptr);
+    }
+}
+
+HDAStar::~HDAStar() = default;
+
+void HDAStar::SetTerrainMap(GameMap& _map)
+{
+    map = &_map;
+}
+
+PathView HDAStar::GetPath()
+{
+    if (path_cost > 0)
+        return {final_path.data(), final_path.size(), path_cost, expansions};
+
+    return {nullptr, 0, path_cost, expansions};
+}
+
+int HDAStar::OwnerOf(int idx) const
+{
+    // Hash the tile's 8x8 block, so most neighbours share an owner
+    const uint32_t bx = (uint32_t)(idx % grid.dims.x) >> 3;
+    const uint32_t by = (uint32_t)(idx / grid.dims.x) >> 3;
+    uint32_t h = bx * 0x9E3779B1u ^ by * 0x85EBCA77u;
+    h ^= h >> 15;
+    h *= 0x2C1B3C6Du;
+    h ^= h >> 13;
+    return (int)(h % (uint32_t)nThreads);
+}
+
+bool HDAStar::ComputePath(WorldPos start, WorldPos _goal)
+{
+    PROFILE_FUNC();
+
+    path_cost = -1.f;
+    expansions = 0;
+
+    Context().Begin();
+
+    if (landmarks) {
+        landmarks->Update(*map);
+    }
+
+    // Grab a snapshot of the effort of every tile in the loaded window,
+    // unless the map hasn't changed since the last one
+    if (grid.version != map->GetVersion()) {
+        map->GetEffortGrid(grid);
+    }
+
+    // For now, if the start or goal are outside of the loaded chunk extents, quit
+    if (!grid.Contains(start) || !grid.Contains(_goal)) {
+        return false;
+    }
+
+    const int sInd = grid.IndexOf(start);
+    goal = _goal;
+    gInd = grid.IndexOf(goal);
+    const size_t gvalCap = gval.capacity();
+    const size_t parentCap = parent.capacity();
+    gval.assign(grid.Size(), FLT_MAX);
+    parent.assign(grid.Size(), -1);
+    Context().Track(gval, gvalCap);
+    Context().Track(parent, parentCap);
+
+    incumbent.store(FLT_MAX);
+    sent.store(0);
+    received.store(0);
+    done.store(false);
+    for (auto& w : workers) {
+        w->context.Begin();
+        w->open.Clear(&w->context);
+        w->idle.store(false);
+        w->expansions = 0;
+    }
+
+    // Seed the start node's owner; 'f' doesn't matter for the only open node
+    gval[sInd] = 0;
+    if (sInd == gInd) {
+        incumbent.store(0.f);
+    } else {
+        workers[OwnerOf(sInd)]->open.Push({0.f, 0.f, sInd});
+    }
+
+    switch (heuristic) {
+        case MANHATTAN:
+            Dispatch(ManhattanDist{});
+            break;
+
+        case EFFORT_OCTILE:
+            Dispatch(EffortOctileDist{map->GetMinEffort()});
+            break;
+
+        case OCTILE:
+        default:
+            Dispatch(OctileDist{});
+            break;
+    }
+
+    for (auto& w : workers) {
+        expansions += w->expansions;
+
+        const QueryStats ws = w->context.GetStats();
+        Context().Count(ws.heapAllocs, ws.bytes);
+    }
+
+    if (incumbent.load() == FLT_MAX) {
+        return false;
+    }
+
+    /* --- A Path Was Found --- */
+    size_t len = 1;
+    for (int i = gInd; parent[i] >= 0; i = parent[i]) {
+        len++;
+    }
+
+    // Total up the path as we go: with a weighted heuristic, tiles on it may
+    // have been reached more cheaply after the goal was, making it cheaper
+    // than the goal's own cost says
+    const size_t pathCap = final_path.capacity();
+    final_path.resize(len);
+    Context().Track(final_path, pathCap);
+    path_cost = 0.f;
+    int idx = gInd;
+    for (size_t k = len; k-- > 0;) {
+        final_path[k] = grid.LocOf(idx);
+        if (parent[idx] >= 0) {
+            const WorldPos d = grid.LocOf(idx) - grid.LocOf(parent[idx]);
+            path_cost += (d.x != 0 && d.y != 0 ? SQRT2 : 1.f) + grid.effort[idx];
+        }
+        idx = parent[idx];
+    }
+
+    return true;
+}
+
+template <class Heuristic>
+void HDAStar::Dispatch(const Heuristic& hval)
+{
+    if (landmarks) {
+        const LandmarkDist<Heuristic> lval {hval, landmarks};
+        if (connectivity == 4)
+            return Run<4>(lval);
+        return Run<8>(lval);
+    }
+
+    if (connectivity == 4)
+        return Run<4>(hval);
+    return Run<8>(hval);
+}
+
+template <int NN, class Heuristic>
+void HDAStar::Run(const Heuristic& hval)
+{
+    // The calling thread doubles as worker 0
+    pool.Run([this, &hval](int tid) { Work<NN>(tid, hval); });
+}
+
+template <int NN, class Heuristic>
+void HDAStar::Work(int tid, const Heuristic& hval)
+{
+    static_assert(NN == 4 || NN == 8, "Only 4- and 8-connectivity are supported");
+
+    Worker& w = *workers[tid];
+    const olc::vi2d dims = grid.dims;
+    int sinceFlush = 0;
+
+    while (!done.load(std::memory_order_acquire)) {
+        // Take in the nodes the other workers have generated for us
+        while (Batch* b = w.inbox.Pop()) {
+            w.idle.store(false);
+            for (int i = 0; i < b->count; i++) {
+                const Message& m = b->msgs[i];
+                Relax(w, m.idx, m.parent, m.g, hval);
+            }
+            received.fetch_add(b->count);
+            workers[b->owner]->spare.Push(b);
+        }
+
+        // Nodes which can't beat the best path found so far are never needed
+        if (w.open.Empty() || w.open.Top().f >= incumbent.load(std::memory_order_relaxed)) {
+            // Out of useful work: hand off whatever is still buffered, then
+            // wait for more to arrive or for every other worker to run dry too
+            w.open.Clear();
+            Flush(w);
+            w.idle.store(true);
+            sinceFlush = 0;
+
+            if (tid == 0 && Quiescent()) {
+                done.store(true, std::memory_order_release);
+            } else {
+                std::this_thread::yield();
+            }
+            continue;
+        }
+
+        const DepthEntry current = w.open.Pop();
+
+        // Skip entries left behind when a node was reached more cheaply
+        const int id = current.idx;
+        if (current.g > gval[id]) continue;
+        w.expansions++;
+
+        if (grid.effort[id] >= 0) {
+            // Visit the neighbors (T/B/L/R, then TL/TR/BL/BR for 8-connectivity),
+            // skipping any which fall off the edge of the loaded window
+            const int ci = id % dims.x;
+            const int cj = id / dims.x;
+            for (int n = 0; n < NN; n++) {
+                const int ni = ci + EffortGrid::DX[n];
+                const int nj = cj + EffortGrid::DY[n];
+                if (ni < 0 || ni >= dims.x || nj < 0 || nj >= dims.y) {
+                    continue;
+                }
+
+                const int nidx = nj * dims.x + ni;
+                const float effort = grid.effort[nidx];
+                if (effort < 0) {
+                    continue;
+                }
+
+                const float tmp_g = current.g + EffortGrid::STEP[n] + effort;
+                const int dest = OwnerOf(nidx);
+                if (dest == tid) {
+                    Relax(w, nidx, id, tmp_g, hval);
+                } else {
+                    Send(w, dest, nidx, id, tmp_g);
+                }
+            }
+        }
+
+        // Don't let the other workers starve waiting on a partly-filled batch
+        if (++sinceFlush >= FLUSH_INTERVAL) {
+            Flush(w);
+            sinceFlush = 0;
+        }
+    }
+}
+
+template <class Heuristic>
+void HDAStar::Relax(Worker& w, int idx, int from, float g, const Heuristic& hval)
+{
+    if (g >= gval[idx]) return;
+
+    gval[idx] = g;
+    parent[idx] = from;
+
+    if (idx == gInd) {
+        // Reaching the goal costs nothing more, so this is a complete path
+        float best = incumbent.load();
+        while (g < best && !incumbent.compare_exchange_weak(best, g)) { }
+        return;
+    }
+
+    const float f = g + weight * hval(grid.LocOf(idx), goal);
+    if (f >= incumbent.load(std::memory_order_relaxed)) return;
+
+    w.open.Push({f, g, idx});
+}
+
+void HDAStar::Send(Worker& w, int dest, int idx, int from, float g)
+{
+    Batch*& b = w.outbox[dest];
+    if (!b) {
+        b = w.spare.Pop();
+        if (!b) {
+            const size_t cap = w.batches.capacity();
+            w.batches.emplace_back(new Batch);
+            w.context.Track(w.batches, cap);
+            w.context.Count(1, sizeof(Batch));
+
+            b = w.batches.back().get();
+            b->owner = w.id;
+        }
+        b->count = 0;
+    }
+
+    b->msgs[b->count++] = {idx, from, g};
+
+    if (b->count == BATCH_SIZE) {
+        sent.fetch_add(b->count);
+        workers[dest]->inbox.Push(b);
+        b = nullptr;
+    }
+}
+
+void HDAStar::Flush(Worker& w)
+{
+    for (int dest = 0; dest < nThreads; dest++) {
+        Batch*& b = w.outbox[dest];
+        if (b && b->count > 0) {
+            // Count the nodes as sent before they can possibly be received
+            sent.fetch_add(b->count);
+            workers[dest]->inbox.Push(b);
+            b = nullptr;
+        }
+    }
+}
+
+bool HDAStar::Quiescent() const
+{
+    const int64_t nReceived = received.load();
+
+    for (auto& w : workers) {
+        if (!w->idle.load()) return false;
+    }
+
+    return sent.load() == nReceived;
+}
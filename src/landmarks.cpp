@@ -0,0 +1,196 @@
+/**
+ * @File: landmarks.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     ALT (A*, Landmarks, Triangle inequality) heuristic over the active map window
+ */
+#include "landmarks.hpp"
+#include "costfield.hpp"
+
+#include <cfloat>
+#include <thread>
+
+bool ALTHeuristic::Update(GameMap& map)
+{
+    PROFILE_FUNC();
+
+    if (grid.version == map.GetVersion() && !landmarks.empty()) {
+        return false;
+    }
+
+    EffortGrid new_grid;
+    map.GetEffortGrid(new_grid);
+
+    // The map may have changed and changed back, e.g. by scrolling away and back
+    if (new_grid.origin == grid.origin && new_grid.dims == grid.dims &&
+        new_grid.effort == grid.effort && !landmarks.empty()) {
+        grid.version = new_grid.version;
+        return false;
+    }
+
+    const EffortGrid oldGrid = std::move(grid);
+    const std::vector<WorldPos> oldLandmarks = landmarks;
+    grid = std::move(new_grid);
+
+    SelectLandmarks();
+    UpdateTables(oldGrid, oldLandmarks);
+
+    return true;
+}
+
+float ALTHeuristic::Eval(const WorldPos& t1, const WorldPos& t2) const
+{
+    if (landmarks.empty() || !grid.Contains(t1) || !grid.Contains(t2)) {
+        return 0.f;
+    }
+
+    const int i1 = grid.IndexOf(t1);
+    const int i2 = grid.IndexOf(t2);
+    const float e1 = grid.effort[i1];
+    const float e2 = grid.effort[i2];
+    if (e1 < 0 || e2 < 0) return 0.f;
+
+    const int L = (int)landmarks.size();
+    const float* d1 = &dist[i1 * L];
+    const float* d2 = &dist[i2 * L];
+
+    // With d(L,x) the cost from landmark L to tile x, and e(x) the effort of x:
+    //   d(t1,t2) >= d(L,t2) - d(L,t1)
+    //   d(t1,t2) >= d(L,t1) - d(L,t2) + e(t2) - e(t1)
+    float h = 0.f;
+    for (int l = 0; l < L; l++) {
+        if (d1[l] == FLT_MAX || d2[l] == FLT_MAX) continue;
+        h = std::max(h, d2[l] - d1[l]);
+        h = std::max(h, d1[l] - d2[l] + e2 - e1);
+    }
+
+    return h;
+}
+
+void ALTHeuristic::SelectLandmarks()
+{
+    // Landmarks work best at the fringes of the graph, so we place them along
+    // the border of the window.  Keep any existing ones which are still there.
+    const int band = CHUNK_SIZE;
+    std::vector<WorldPos> chosen;
+    for (const auto& lm : landmarks) {
+        if (!grid.Contains(lm) || grid.effort[grid.IndexOf(lm)] < 0) continue;
+
+        const WorldPos loc = lm - grid.origin;
+        if (loc.x < band || loc.y < band ||
+            loc.x >= grid.dims.x - band || loc.y >= grid.dims.y - band) {
+            chosen.push_back(lm);
+        }
+    }
+
+    // Candidate locations evenly spaced around the perimeter, each snapped to
+    // the closest passable tile
+    const int perim = 2 * (grid.dims.x + grid.dims.y);
+    const int nCandidates = 4 * nLandmarks;
+    std::vector<WorldPos> candidates;
+    for (int k = 0; k < nCandidates && perim > 0; k++) {
+        int p = k * perim / nCandidates;
+        WorldPos b;
+        if (p < grid.dims.x) {
+            b = {p, 0};
+        } else if ((p -= grid.dims.x) < grid.dims.y) {
+            b = {grid.dims.x - 1, p};
+        } else if ((p -= grid.dims.y) < grid.dims.x) {
+            b = {grid.dims.x - 1 - p, grid.dims.y - 1};
+        } else {
+            p -= grid.dims.x;
+            b = {0, grid.dims.y - 1 - p};
+        }
+
+        // Search outwards in square rings for a passable tile
+        const int maxR = std::max(grid.dims.x, grid.dims.y);
+        for (int r = 0; r < maxR; r++) {
+            bool found = false;
+            for (int dj = -r; dj <= r && !found; dj++) {
+                for (int di = -r; di <= r && !found; di++) {
+                    if (std::max(abs(di), abs(dj)) != r) continue;
+                    const WorldPos loc = b + WorldPos({di, dj}) + grid.origin;
+                    if (grid.Contains(loc) && grid.effort[grid.IndexOf(loc)] >= 0) {
+                        candidates.push_back(loc);
+                        found = true;
+                    }
+                }
+            }
+            if (found) break;
+        }
+    }
+
+    // Greedily fill the remaining slots with the candidate farthest from all
+    // of the landmarks chosen so far
+    while ((int)chosen.size() < nLandmarks && !candidates.empty()) {
+        int best = -1;
+        int bestDist = -1;
+        for (int c = 0; c < (int)candidates.size(); c++) {
+            int minDist = INT32_MAX;
+            for (const auto& lm : chosen) {
+                const WorldPos d = candidates[c] - lm;
+                minDist = std::min(minDist, (int)(std::abs(d.x) + std::abs(d.y)));
+            }
+            if (minDist > bestDist) {
+                bestDist = minDist;
+                best = c;
+            }
+        }
+
+        if (bestDist == 0) break; // Every candidate is already a landmark
+        chosen.push_back(candidates[best]);
+        candidates.erase(candidates.begin() + best);
+    }
+
+    landmarks = std::move(chosen);
+}
+
+void ALTHeuristic::UpdateTables(const EffortGrid& oldGrid, const std::vector<WorldPos>& oldLandmarks)
+{
+    PROFILE_FUNC();
+
+    const int L = (int)landmarks.size();
+    const int N = grid.Size();
+
+    // Hand each landmark which was kept its old field, to be repaired
+    std::vector<std::vector<float>> oldFields = std::move(fields);
+    std::vector<char> repair(L, 0);
+    fields.assign(L, {});
+    for (int l = 0; l < L; l++) {
+        for (int k = 0; k < (int)oldLandmarks.size() && k < (int)oldFields.size(); k++) {
+            if (oldLandmarks[k] == landmarks[l]) {
+                fields[l] = std::move(oldFields[k]);
+                repair[l] = 1;
+                break;
+            }
+        }
+    }
+
+    // Each landmark's field is independent; spread them over threads
+    const int nThreads = std::max(1, std::min(L, (int)std::thread::hardware_concurrency()));
+    std::vector<std::thread> workers;
+    for (int t = 0; t < nThreads; t++) {
+        workers.emplace_back([this, &oldGrid, &repair, t, nThreads, L]() {
+            for (int l = t; l < L; l += nThreads) {
+                const int source = grid.IndexOf(landmarks[l]);
+                if (repair[l]) {
+                    RepairCostField(oldGrid, grid, source, fields[l]);
+                } else {
+                    ComputeCostField(grid, source, fields[l]);
+                }
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+
+    // Interleave so that a heuristic lookup touches one contiguous row per tile
+    dist.resize((size_t)N * L);
+    for (int l = 0; l < L; l++) {
+        for (int i = 0; i < N; i++) {
+            dist[(size_t)i * L + l] = fields[l][i];
+        }
+    }
+}
@@ -0,0 +1,996 @@
+/**
+ * @File: mapf.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Multi-agent path finding: collision-free paths for many agents at once,
+ *     using Conflict-Based Search over a space-time A*
+ */
+
+#include "mapf.hpp"
+#include "costfield.hpp"
+#include "heuristics.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cfloat>
+#include <climits>
+#include <deque>
+#include <numeric>
+#include <set>
+#include <thread>
+#include <tuple>
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+//! Most constraint-tree nodes to expand before giving up on CBS, when it has no time limit
+constexpr int MAX_CT_NODES = 1 << 16;
+
+double Millis(Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+int ThreadCount(int nThreads)
+{
+    nThreads = nThreads > 0 ? nThreads : (int)std::thread::hardware_concurrency();
+    return std::max(nThreads, 1);
+}
+
+//! Tile an agent is on at time 't'; agents stay on their goal once they reach it
+inline int TileAt(const std::vector<int>& path, int t)
+{
+    return path[std::min(t, (int)path.size() - 1)];
+}
+
+//! Exact cost to the goal, from its cost field
+struct FieldDist
+{
+    const std::vector<float>& cost;
+
+    float operator()(int idx) const { return cost[idx]; }
+};
+
+//! Cost to the goal, from a field built as it's asked for; FLT_MAX everywhere new once out of time
+struct LazyDist
+{
+    LazyCostField* field;
+    Clock::time_point deadline;
+
+    float operator()(int idx) const { return field->Get(idx, deadline); }
+};
+
+} // namespace
+
+void ReservationTable::Clear()
+{
+    vertices.clear();
+    edges.clear();
+    goals.clear();
+    last.clear();
+    held.clear();
+    maxTime = 0;
+}
+
+void ReservationTable::ReserveVertex(int idx, int t)
+{
+    vertices.insert(SpaceTimeKey(idx, t));
+    maxTime = std::max(maxTime, t);
+
+    auto it = last.find(idx);
+    if (it == last.end()) {
+        last[idx] = t;
+    } else {
+        it->second = std::max(it->second, t);
+    }
+}
+
+void ReservationTable::ReserveEdge(int from, int to, int t)
+{
+    edges.insert({from, to, t});
+    maxTime = std::max(maxTime, t + 1);
+}
+
+void ReservationTable::ReserveGoal(int idx, int t)
+{
+    auto it = goals.find(idx);
+    if (it == goals.end()) {
+        goals[idx] = t;
+    } else {
+        it->second = std::min(it->second, t);
+    }
+    maxTime = std::max(maxTime, t);
+}
+
+void ReservationTable::ReservePath(const std::vector<int>& path)
+{
+    if (path.empty()) return;
+
+    const int len = (int)path.size();
+    for (int t = 0; t < len; t++) {
+        ReserveVertex(path[t], t);
+        if (t + 1 < len && path[t + 1] != path[t]) {
+            ReserveEdge(path[t + 1], path[t], t);
+        }
+    }
+
+    ReserveGoal(path.back(), len - 1);
+}
+
+bool ReservationTable::IsVertexFree(int idx, int t, int own) const
+{
+    if (vertices.count(SpaceTimeKey(idx, t))) return false;
+    if (!held.empty() && idx != own && held.count(idx)) return false;
+
+    const auto it = goals.find(idx);
+    return it == goals.end() || t < it->second;
+}
+
+bool ReservationTable::IsEdgeFree(int from, int to, int t) const
+{
+    return edges.empty() || !edges.count({from, to, t});
+}
+
+bool ReservationTable::IsPathFree(const std::vector<int>& path) const
+{
+    const int len = (int)path.size();
+    if (len == 0 || LastReservation(path.back(), path[0]) >= len - 1) return false;
+
+    for (int t = 0; t < len; t++) {
+        if (!IsVertexFree(path[t], t, path[0])) return false;
+        if (t + 1 < len && !IsEdgeFree(path[t], path[t + 1], t)) return false;
+    }
+
+    return true;
+}
+
+int ReservationTable::LastReservation(int idx, int own) const
+{
+    if (goals.count(idx) || (!held.empty() && idx != own && held.count(idx))) return INT32_MAX;
+
+    const auto it = last.find(idx);
+    return it == last.end() ? -1 : it->second;
+}
+
+void ConflictTable::Build(const std::vector<std::shared_ptr<const std::vector<int>>>& _paths)
+{
+    paths = _paths;
+    vertices.clear();
+    moves.clear();
+    parked.clear();
+
+    for (const auto& p : paths) {
+        const std::vector<int>& path = *p;
+        const int len = (int)path.size();
+        for (int t = 0; t < len; t++) {
+            vertices[SpaceTimeKey(path[t], t)]++;
+            if (t + 1 < len && path[t + 1] != path[t]) {
+                moves[{path[t], path[t + 1], t}]++;
+            }
+        }
+
+        const auto [it, added] = parked.try_emplace(path.back(), len);
+        if (!added) it->second = std::min(it->second, len);
+    }
+}
+
+int ConflictTable::Count(int from, int to, int t, int agent) const
+{
+    int count = 0;
+
+    // Others on 'to' at t+1, whether passing through or there for good
+    const auto v = vertices.find(SpaceTimeKey(to, t + 1));
+    if (v != vertices.end()) count += v->second;
+
+    const auto p = parked.find(to);
+    if (p != parked.end() && t + 1 >= p->second) count++;
+
+    // Others swapping places with us
+    if (from != to) {
+        const auto m = moves.find({to, from, t});
+        if (m != moves.end()) count += m->second;
+    }
+
+    // Less our own path's share of the above
+    const std::vector<int>& own = *paths[agent];
+    if (TileAt(own, t + 1) == to) count--;
+    if (from != to && TileAt(own, t) == to && TileAt(own, t + 1) == from) count--;
+
+    return count;
+}
+
+template <class Heuristic>
+bool SpaceTimeAStar::Search(const EffortGrid& grid, int start, int goal, const Heuristic& hval,
+                            const ReservationTable& blocked, int horizon, int nn, std::vector<int>& path,
+                            float& cost, std::chrono::steady_clock::time_point deadline)
+{
+    nodes.clear();
+    open.Clear();
+    visited.clear();
+    expansions = 0;
+    path.clear();
+    cost = -1.f;
+
+    // The agent has to be able to reach the goal, and then stay on it for good
+    const int goalFrom = blocked.LastReservation(goal, start);
+    if (hval(start) == FLT_MAX || goalFrom == INT32_MAX || !blocked.IsVertexFree(start, 0, start)) {
+        return false;
+    }
+
+    // Every step costs at least this much, and the agent can't finish before
+    // its goal is free for good; without this, an agent made to arrive late
+    // would first try every way of wasting the time
+    const float minStep = std::min(WAIT_COST, 1.f);
+    auto H = [&](int idx, int t) { return std::max(hval(idx), (goalFrom + 1 - t) * minStep); };
+
+    nodes.push_back({start, 0, 0.f, -1});
+    visited[SpaceTimeKey(start, 0)] = 0;
+    open.Push({H(start, 0), 0.f, 0});
+
+    const olc::vi2d dims = grid.dims;
+
+    // Add or improve the state (idx, t) reached from node 'from'
+    auto relax = [&](int idx, int t, float g, int from) {
+        auto [it, added] = visited.try_emplace(SpaceTimeKey(idx, t), (int32_t)nodes.size());
+        if (added) {
+            nodes.push_back({idx, t, g, from});
+        } else if (g < nodes[it->second].g) {
+            nodes[it->second].g = g;
+            nodes[it->second].parent = from;
+        } else {
+            return;
+        }
+
+        open.Push({g + H(idx, t), g, it->second});
+    };
+
+    while (!open.Empty()) {
+        const DepthEntry top = open.Pop();
+
+        const Node cur = nodes[top.idx];
+        if (top.g > cur.g) continue;
+
+        // Checking the clock every expansion would cost more than the search itself
+        if (++expansions % 1024 == 0 && std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+
+        if (cur.idx == goal && cur.t > goalFrom) {
+            path.resize(cur.t + 1);
+            for (int n = top.idx; n >= 0; n = nodes[n].parent) {
+                path[nodes[n].t] = nodes[n].idx;
+            }
+            cost = cur.g;
+            return true;
+        }
+
+        const int t = cur.t + 1;
+        if (t > horizon) continue;
+
+        // Wait where we are
+        if (blocked.IsVertexFree(cur.idx, t, start)) {
+            relax(cur.idx, t, cur.g + WAIT_COST, top.idx);
+        }
+
+        // Nothing can move off of an impassable tile
+        if (grid.effort[cur.idx] < 0) continue;
+
+        const int ci = cur.idx % dims.x;
+        const int cj = cur.idx / dims.x;
+        for (int n = 0; n < nn; n++) {
+            const int ni = ci + EffortGrid::DX[n];
+            const int nj = cj + EffortGrid::DY[n];
+            if (ni < 0 || ni >= dims.x || nj < 0 || nj >= dims.y) {
+                continue;
+            }
+
+            const int nidx = nj * dims.x + ni;
+            const float effort = grid.effort[nidx];
+            if (effort < 0 || hval(nidx) == FLT_MAX) {
+                continue;
+            }
+
+            if (!blocked.IsVertexFree(nidx, t, start) || !blocked.IsEdgeFree(cur.idx, nidx, cur.t)) {
+                continue;
+            }
+
+            relax(nidx, t, cur.g + EffortGrid::STEP[n] + effort, top.idx);
+        }
+    }
+
+    return false;
+}
+
+template <class Heuristic>
+bool SpaceTimeAStar::SearchFocal(const EffortGrid& grid, int start, int goal, const Heuristic& hval,
+                                 const ReservationTable& blocked, const ConflictTable& conflicts, int agent,
+                                 float weight, int horizon, int nn, std::vector<int>& path, float& cost,
+                                 float& lowerBound, std::chrono::steady_clock::time_point deadline)
+{
+    nodes.clear();
+    visited.clear();
+    openSet.clear();
+    focal.clear();
+    expansions = 0;
+    path.clear();
+    cost = -1.f;
+    lowerBound = 0.f;
+
+    const int goalFrom = blocked.LastReservation(goal, start);
+    if (hval(start) == FLT_MAX || goalFrom == INT32_MAX || !blocked.IsVertexFree(start, 0, start)) {
+        return false;
+    }
+
+    const float minStep = std::min(WAIT_COST, 1.f);
+    auto H = [&](int idx, int t) { return std::max(hval(idx), (goalFrom + 1 - t) * minStep); };
+
+    // Fewest collisions first, then as for the open list
+    auto later = [](const FocalEntry& a, const FocalEntry& b) {
+        if (a.conflicts != b.conflicts) return a.conflicts > b.conflicts;
+        if (a.f != b.f) return a.f > b.f;
+        return a.g < b.g;
+    };
+
+    auto pushFocal = [&](int32_t id) {
+        const Node& n = nodes[id];
+        focal.push_back({n.conflicts, n.f, n.g, id});
+        std::push_heap(focal.begin(), focal.end(), later);
+    };
+
+    // Open states with f up to 'bound' are also in the focal list
+    float bound = 0.f;
+
+    // Add or improve the state (idx, t) reached from node 'from'; ties on
+    // cost go to the path with fewer collisions
+    auto relax = [&](int idx, int t, float g, int nConflicts, int from) {
+        auto [it, added] = visited.try_emplace(SpaceTimeKey(idx, t), (int32_t)nodes.size());
+        const int32_t id = it->second;
+        if (added) {
+            nodes.push_back({idx, t, g, from, g + H(idx, t), nConflicts, false});
+        } else {
+            Node& n = nodes[id];
+            if (g > n.g || (g == n.g && nConflicts >= n.conflicts)) return;
+
+            if (!n.closed) openSet.erase({n.f, id});
+            n.g = g;
+            n.f = g + H(idx, t);
+            n.parent = from;
+            n.conflicts = nConflicts;
+            n.closed = false;
+        }
+
+        openSet.insert({nodes[id].f, id});
+        if (nodes[id].f <= bound) pushFocal(id);
+    };
+
+    bound = weight * H(start, 0);
+    relax(start, 0, 0.f, 0, -1);
+
+    const olc::vi2d dims = grid.dims;
+
+    while (!openSet.empty()) {
+        // As the lowest f rises, let the open states it now covers into the focal list
+        const float fmin = openSet.begin()->first;
+        if (weight * fmin > bound) {
+            const float newBound = weight * fmin;
+            for (auto it = openSet.upper_bound({bound, INT32_MAX}); it != openSet.end() && it->first <= newBound;
+                 ++it) {
+                pushFocal(it->second);
+            }
+            bound = newBound;
+        }
+
+        std::pop_heap(focal.begin(), focal.end(), later);
+        const FocalEntry top = focal.back();
+        focal.pop_back();
+
+        Node& node = nodes[top.idx];
+        if (node.closed || top.f != node.f || top.conflicts != node.conflicts) continue;
+
+        openSet.erase({node.f, top.idx});
+        node.closed = true;
+        const Node cur = node;
+
+        if (++expansions % 1024 == 0 && std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+
+        if (cur.idx == goal && cur.t > goalFrom) {
+            path.resize(cur.t + 1);
+            for (int n = top.idx; n >= 0; n = nodes[n].parent) {
+                path[nodes[n].t] = nodes[n].idx;
+            }
+            cost = cur.g;
+            lowerBound = fmin;
+            return true;
+        }
+
+        const int t = cur.t + 1;
+        if (t > horizon) continue;
+
+        if (blocked.IsVertexFree(cur.idx, t, start)) {
+            relax(cur.idx, t, cur.g + WAIT_COST, cur.conflicts + conflicts.Count(cur.idx, cur.idx, cur.t, agent),
+                  top.idx);
+        }
+
+        if (grid.effort[cur.idx] < 0) continue;
+
+        const int ci = cur.idx % dims.x;
+        const int cj = cur.idx / dims.x;
+        for (int n = 0; n < nn; n++) {
+            const int ni = ci + EffortGrid::DX[n];
+            const int nj = cj + EffortGrid::DY[n];
+            if (ni < 0 || ni >= dims.x || nj < 0 || nj >= dims.y) {
+                continue;
+            }
+
+            const int nidx = nj * dims.x + ni;
+            const float effort = grid.effort[nidx];
+            if (effort < 0 || hval(nidx) == FLT_MAX) {
+                continue;
+            }
+
+            if (!blocked.IsVertexFree(nidx, t, start) || !blocked.IsEdgeFree(cur.idx, nidx, cur.t)) {
+                continue;
+            }
+
+            relax(nidx, t, cur.g + EffortGrid::STEP[n] + effort,
+                  cur.conflicts + conflicts.Count(cur.idx, nidx, cur.t, agent), top.idx);
+        }
+    }
+
+    return false;
+}
+
+MAPFSolver::MAPFSolver(int _nThreads, int connectivity, float epsilon) :
+    nThreads(ThreadCount(_nThreads)), connectivity(connectivity), weight(1.f + std::max(epsilon, 0.f)),
+    pool(nThreads)
+{
+    for (int i = 0; i < nThreads; i++) {
+        searches.emplace_back(new SpaceTimeAStar);
+    }
+    slotStats.resize(nThreads);
+}
+
+void MAPFSolver::SetTerrainMap(GameMap& _map)
+{
+    map = &_map;
+}
+
+bool MAPFSolver::Solve(const std::vector<MAPFAgent>& agents, int maxMillis)
+{
+    PROFILE_FUNC();
+
+    const auto t0 = Clock::now();
+    const int nAgents = (int)agents.size();
+
+    stats = MAPFStats();
+    stats.agents = nAgents;
+    paths.assign(nAgents, {});
+    for (auto& s : slotStats) {
+        s = SlotStats();
+    }
+
+    if (landmarks) {
+        landmarks->Update(*map);
+    }
+
+    // Grab a snapshot of the effort of every tile in the loaded window; the
+    // cost fields from the last Solve() still hold if the map is unchanged
+    if (grid.version != map->GetVersion()) {
+        map->GetEffortGrid(grid);
+        fieldCache.clear();
+        minEffort = map->GetMinEffort();
+    }
+
+    // For now, every agent has to start and end within the loaded chunk extents;
+    // and no two agents can ever be on the same tile, not even to begin with or
+    // once they've arrived
+    starts.resize(nAgents);
+    goals.resize(nAgents);
+    std::unordered_set<int> startSet, goalSet;
+    for (int a = 0; a < nAgents; a++) {
+        const char* error = nullptr;
+        if (!grid.Contains(agents[a].start) || !grid.Contains(agents[a].goal)) {
+            error = "is outside of the loaded map";
+        } else if (!startSet.insert(grid.IndexOf(agents[a].start)).second) {
+            error = "starts on the same tile as another agent";
+        } else if (!goalSet.insert(grid.IndexOf(agents[a].goal)).second) {
+            error = "has the same goal as another agent";
+        }
+
+        if (error) {
+            printf("MAPF: agent %d %s\n", a, error);
+            stats.failed = nAgents;
+            stats.msTotal = Millis(t0);
+            return false;
+        }
+        starts[a] = grid.IndexOf(agents[a].start);
+        goals[a] = grid.IndexOf(agents[a].goal);
+    }
+
+    const auto end = maxMillis > 0 ? t0 + std::chrono::milliseconds(maxMillis) : Clock::time_point::max();
+    deadline = end;
+
+    // The exact cost to each goal makes the best heuristic.  The fields are
+    // built in parallel for up to a quarter of the time budget, and kept for
+    // the next Solve(); fields for goals which are no longer wanted are dropped.
+    if (maxMillis > 0) {
+        deadline = t0 + (end - t0) / 4;
+    }
+
+    for (auto it = fieldCache.begin(); it != fieldCache.end();) {
+        it = goalSet.count(it->first) ? std::next(it) : fieldCache.erase(it);
+    }
+
+    std::vector<int> targets;
+    for (int g : goals) {
+        if (fieldCache.try_emplace(g).second) {
+            targets.push_back(g);
+        }
+    }
+
+    std::atomic<int> next {0};
+    std::vector<char> built(targets.size(), 0);
+    pool.Run([&](int) {
+        for (int i; !OutOfTime() && (i = next.fetch_add(1)) < (int)targets.size();) {
+            ComputeCostFieldTo(grid, targets[i], fieldCache.at(targets[i]), connectivity);
+            built[i] = 1;
+        }
+    });
+
+    for (size_t i = 0; i < targets.size(); i++) {
+        if (!built[i]) fieldCache.erase(targets[i]);
+    }
+
+    // Agents whose goal's field there wasn't time for build theirs only as
+    // far as their searches look, which is far less than the whole window
+    hfields.resize(nAgents);
+    if ((int)lazyFields.size() < nAgents) {
+        lazyFields.resize(nAgents);
+    }
+    for (int a = 0; a < nAgents; a++) {
+        const auto it = fieldCache.find(goals[a]);
+        hfields[a] = it != fieldCache.end() ? &it->second : nullptr;
+        if (!hfields[a]) {
+            lazyFields[a].Reset(grid, goals[a], starts[a], connectivity, minEffort, landmarks);
+        }
+    }
+
+    // CBS for an optimal solution (or ECBS, for one within the bound), in up
+    // to half of what's left of the time budget if there is one; then, if
+    // need be, prioritised planning in the rest
+    deadline = end;
+    if (maxMillis > 0) {
+        deadline = Clock::now() + (end - Clock::now()) / 2;
+    }
+
+    std::vector<Path> result(nAgents);
+    const bool solved = SolveCBS(result);
+    stats.optimal = solved && weight == 1.f;
+    stats.bound = solved ? weight : 0.f;
+    if (!solved) {
+        deadline = end;
+        SolvePrioritised(result);
+    }
+
+    /* --- Collect the paths and stats --- */
+    for (int a = 0; a < nAgents; a++) {
+        const std::vector<int>& path = *result[a];
+        paths[a].resize(path.size());
+        for (size_t t = 0; t < path.size(); t++) {
+            paths[a][t] = grid.LocOf(path[t]);
+        }
+
+        if (path.back() != goals[a]) {
+            stats.failed++;
+            continue;
+        }
+
+        // Waiting costs nothing once the agent is at its goal for good
+        float cost = 0.f;
+        for (size_t t = 1; t < path.size(); t++) {
+            const WorldPos d = grid.LocOf(path[t]) - grid.LocOf(path[t - 1]);
+            if (d.x == 0 && d.y == 0) {
+                cost += SpaceTimeAStar::WAIT_COST;
+            } else {
+                cost += (d.x != 0 && d.y != 0 ? SQRT2 : 1.f) + grid.effort[path[t]];
+            }
+        }
+        stats.sumOfCosts += cost;
+        stats.makespan = std::max(stats.makespan, (int)path.size() - 1);
+    }
+
+    Conflict first;
+    stats.conflictFree = FindConflicts(result, first) == 0;
+
+    for (const auto& s : slotStats) {
+        stats.msLowLevel += s.ms;
+        stats.expansions += s.expansions;
+        stats.searches += s.searches;
+    }
+    stats.msTotal = Millis(t0);
+
+    return stats.failed == 0 && stats.conflictFree;
+}
+
+float MAPFSolver::LowerBound(int agent, int idx) const
+{
+    if (hfields[agent]) return (*hfields[agent])[idx];
+
+    const LandmarkDist<EffortOctileDist> dist {{minEffort}, landmarks};
+    const WorldPos from = grid.LocOf(idx);
+    const WorldPos to = grid.LocOf(goals[agent]);
+    return landmarks ? dist(from, to) : dist.base(from, to);
+}
+
+bool MAPFSolver::PlanAgent(int agent, const ReservationTable& blocked, int slot, std::vector<int>& path,
+                           float& cost, const ConflictTable* conflicts, float* lowerBound)
+{
+    const auto t0 = Clock::now();
+
+    const int start = starts[agent];
+    const int goal = goals[agent];
+    SpaceTimeAStar& search = *searches[slot];
+
+    auto run = [&](const auto& hval) {
+        // Long enough to wait out every reservation, then walk around the whole window
+        const int horizon = blocked.MaxTime() + (int)std::min(hval(start), 1e6f) + grid.dims.x + grid.dims.y;
+        if (conflicts) {
+            return search.SearchFocal(grid, start, goal, hval, blocked, *conflicts, agent, weight, horizon,
+                                      connectivity, path, cost, *lowerBound, deadline);
+        }
+
+        const bool found = search.Search(grid, start, goal, hval, blocked, horizon, connectivity, path, cost,
+                                         deadline);
+        if (lowerBound) *lowerBound = cost;
+        return found;
+    };
+
+    const bool found = hfields[agent] ? run(FieldDist {*hfields[agent]})
+                                      : run(LazyDist {&lazyFields[agent], deadline});
+
+    SlotStats& s = slotStats[slot];
+    s.ms += Millis(t0);
+    s.expansions += search.GetExpansions();
+    s.searches++;
+
+    return found;
+}
+
+void MAPFSolver::GetConstraints(const std::vector<CTNode>& tree, int node, int agent,
+                                ReservationTable& table) const
+{
+    table.Clear();
+    for (int n = node; n > 0; n = tree[n].parent) {
+        const Constraint& c = tree[n].constraint;
+        if (c.agent != agent) continue;
+
+        if (c.to < 0) {
+            table.ReserveVertex(c.tile, c.t);
+        } else {
+            table.ReserveEdge(c.tile, c.to, c.t);
+        }
+    }
+}
+
+int MAPFSolver::FindConflicts(const std::vector<Path>& paths, Conflict& first) const
+{
+    const int nAgents = (int)paths.size();
+
+    int tMax = 0;
+    for (const Path& p : paths) {
+        tMax = std::max(tMax, (int)p->size());
+    }
+
+    first.t = INT_MAX;
+    int count = 0;
+
+    // Once every agent has arrived nothing moves, so there's nothing new to find
+    std::unordered_map<int, int> occupied; //!< Tile -> first agent on it at time t
+    for (int t = 0; t < tMax; t++) {
+        occupied.clear();
+        for (int a = 0; a < nAgents; a++) {
+            const auto [it, added] = occupied.try_emplace(TileAt(*paths[a], t), a);
+            if (!added) {
+                if (count++ == 0) {
+                    first = {it->second, a, it->first, it->first, t, true};
+                }
+            }
+        }
+
+        if (t + 1 >= tMax) break;
+
+        // Swaps: a moves u -> v while whoever was on v moves v -> u
+        for (int a = 0; a < nAgents; a++) {
+            const int u = TileAt(*paths[a], t);
+            const int v = TileAt(*paths[a], t + 1);
+            if (u == v) continue;
+
+            const auto it = occupied.find(v);
+            if (it == occupied.end()) continue;
+
+            const int b = it->second;
+            if (b > a && TileAt(*paths[b], t + 1) == u) {
+                if (count++ == 0) {
+                    first = {a, b, u, v, t, false};
+                }
+            }
+        }
+    }
+
+    return count;
+}
+
+bool MAPFSolver::SolveCBS(std::vector<Path>& result)
+{
+    PROFILE_FUNC();
+
+    const bool timed = deadline != Clock::time_point::max();
+    const int nAgents = (int)starts.size();
+
+    std::vector<CTNode> tree;
+    std::vector<Conflict> firstConflict;
+
+    // Plan every agent on its own, spread over the threads
+    CTNode root;
+    root.paths.resize(nAgents);
+    root.costs.resize(nAgents);
+    root.lowerBounds.resize(nAgents);
+
+    std::atomic<int> next {0};
+    std::atomic<bool> failed {false};
+    const ReservationTable none;
+    pool.Run([&](int slot) {
+        std::vector<int> path;
+        float cost;
+        for (int a; !failed.load() && (a = next.fetch_add(1)) < nAgents;) {
+            if (PlanAgent(a, none, slot, path, cost)) {
+                root.paths[a] = std::make_shared<const std::vector<int>>(path);
+                root.costs[a] = cost;
+                root.lowerBounds[a] = cost;
+            } else if (OutOfTime()) {
+                failed.store(true);
+            }
+        }
+    });
+
+    // Out of time, or some agent can't reach its goal even alone, where no
+    // amount of splitting will help; hand back what was planned
+    result = root.paths;
+    if (failed.load() || std::find(result.begin(), result.end(), nullptr) != result.end()) {
+        return false;
+    }
+
+    Conflict conflict;
+    root.cost = std::accumulate(root.costs.begin(), root.costs.end(), 0.f);
+    root.lowerBound = root.cost;
+    root.conflicts = FindConflicts(root.paths, conflict);
+    tree.push_back(std::move(root));
+    firstConflict.push_back(conflict);
+
+    // Best-first over the constraint tree, from a focal list of the nodes
+    // costing at most 'weight' times the lowest lower bound: fewest
+    // collisions, then cheapest.  With a weight of 1 this is plain CBS's
+    // order, cheapest then fewest collisions.
+    using Focal = std::tuple<int, float, int>;
+    std::set<std::pair<float, int>> byLowerBound, byCost;
+    std::set<Focal> focal;
+    float bound = weight * tree[0].lowerBound;
+
+    auto push = [&](int id) {
+        const CTNode& n = tree[id];
+        byLowerBound.insert({n.lowerBound, id});
+        byCost.insert({n.cost, id});
+        if (n.cost <= bound) focal.insert({n.conflicts, n.cost, id});
+    };
+    push(0);
+
+    // For ECBS, the replans of each split steer clear of the node's other paths
+    ConflictTable conflicts;
+
+    while (!byLowerBound.empty()) {
+        if (timed ? OutOfTime() : stats.ctNodes >= MAX_CT_NODES) {
+            return false;
+        }
+
+        // The lower bound only rises, as no child's is below its parent's
+        const float newBound = weight * byLowerBound.begin()->first;
+        if (newBound > bound) {
+            for (auto it = byCost.upper_bound({bound, INT_MAX}); it != byCost.end() && it->first <= newBound; ++it) {
+                focal.insert({tree[it->second].conflicts, it->first, it->second});
+            }
+            bound = newBound;
+        }
+
+        // Rounding may leave the focal list empty; the node with the lowest bound is as good
+        const int id = focal.empty() ? byLowerBound.begin()->second : std::get<2>(*focal.begin());
+        focal.erase({tree[id].conflicts, tree[id].cost, id});
+        byLowerBound.erase({tree[id].lowerBound, id});
+        byCost.erase({tree[id].cost, id});
+        stats.ctNodes++;
+
+        if (tree[id].conflicts == 0) {
+            result = tree[id].paths;
+            return true;
+        }
+
+        // Split on the earliest collision: forbid one agent, then the other
+        const Conflict c = firstConflict[id];
+        Constraint split[2];
+        if (c.vertex) {
+            split[0] = {c.a1, c.tile1, -1, c.t};
+            split[1] = {c.a2, c.tile1, -1, c.t};
+        } else {
+            split[0] = {c.a1, c.tile1, c.tile2, c.t};
+            split[1] = {c.a2, c.tile2, c.tile1, c.t};
+        }
+
+        CTNode child[2];
+        bool found[2];
+        auto replan = [&](int k, int slot) {
+            const int agent = split[k].agent;
+
+            child[k].parent = id;
+            child[k].constraint = split[k];
+            child[k].paths = tree[id].paths;
+            child[k].costs = tree[id].costs;
+            child[k].lowerBounds = tree[id].lowerBounds;
+
+            ReservationTable table;
+            GetConstraints(tree, id, agent, table);
+            if (split[k].to < 0) {
+                table.ReserveVertex(split[k].tile, split[k].t);
+            } else {
+                table.ReserveEdge(split[k].tile, split[k].to, split[k].t);
+            }
+
+            std::vector<int> path;
+            float cost, lowerBound;
+            found[k] = PlanAgent(agent, table, slot, path, cost, weight > 1.f ? &conflicts : nullptr, &lowerBound);
+            if (found[k]) {
+                child[k].paths[agent] = std::make_shared<const std::vector<int>>(std::move(path));
+                child[k].costs[agent] = cost;
+
+                // More constraints can't make the agent's optimum any cheaper
+                child[k].lowerBounds[agent] = std::max(lowerBound, tree[id].lowerBounds[agent]);
+            }
+        };
+
+        if (weight > 1.f) {
+            conflicts.Build(tree[id].paths);
+        }
+
+        // The two replans are independent
+        if (nThreads > 1) {
+            pool.Run([&replan](int slot) {
+                if (slot < 2) replan(slot, slot);
+            });
+        } else {
+            replan(0, 0);
+            replan(1, 0);
+        }
+
+        for (int k = 0; k < 2; k++) {
+            if (!found[k]) continue;
+
+            child[k].cost = std::accumulate(child[k].costs.begin(), child[k].costs.end(), 0.f);
+            child[k].lowerBound = std::accumulate(child[k].lowerBounds.begin(), child[k].lowerBounds.end(), 0.f);
+            child[k].conflicts = FindConflicts(child[k].paths, conflict);
+            tree.push_back(std::move(child[k]));
+            firstConflict.push_back(conflict);
+            push((int)tree.size() - 1);
+        }
+    }
+
+    return false;
+}
+
+bool MAPFSolver::SolvePrioritised(std::vector<Path>& result)
+{
+    PROFILE_FUNC();
+
+    const int nAgents = (int)starts.size();
+
+    // Agents with the least far to go pick their paths first: they're likely
+    // to arrive before anyone else passes their goals, where a later agent
+    // would have to waste time until the goal is free for good
+    std::vector<int> order(nAgents);
+    std::iota(order.begin(), order.end(), 0);
+    std::vector<float> distance(nAgents);
+    for (int a = 0; a < nAgents; a++) {
+        distance[a] = LowerBound(a, starts[a]);
+    }
+    std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return distance[a] < distance[b]; });
+
+    // Every agent holds on to its start until its path is settled.  One
+    // which then finds no path stays where it is, and nobody settled before
+    // it can have been routed through there.
+    ReservationTable table;
+    for (int a = 0; a < nAgents; a++) {
+        table.Hold(starts[a]);
+    }
+
+    auto settle = [&](int a, Path path) {
+        table.Release(starts[a]);
+        table.ReservePath(*path);
+        result[a] = std::move(path);
+    };
+
+    // The agents are planned a few at a time, one per thread, each around the
+    // paths settled so far; then the paths are settled in order of priority.
+    // A path which runs into one settled earlier in the same round is planned
+    // again in the next, and the first agent of a round always goes through,
+    // so with one thread this is plain prioritised planning.
+    std::deque<int> pending(order.begin(), order.end());
+    std::vector<int> batch, searched, deferred;
+    std::vector<char> keep;
+    std::vector<std::vector<int>> planned(nThreads);
+    std::vector<char> found(nThreads);
+
+    bool allFound = true;
+    while (!pending.empty()) {
+        // An agent's plan from CBS stands if nobody before it is in the way;
+        // the rest of the round are those which need a search
+        batch.clear();
+        keep.clear();
+        searched.clear();
+        while (!pending.empty() && (int)searched.size() < nThreads) {
+            const int a = pending.front();
+            pending.pop_front();
+
+            keep.push_back(result[a] && table.IsPathFree(*result[a]));
+            if (!keep.back()) {
+                searched.push_back((int)batch.size());
+            }
+            batch.push_back(a);
+        }
+
+        std::atomic<int> next {0};
+        auto plan = [&](int slot) {
+            for (int i; (i = next.fetch_add(1)) < (int)searched.size();) {
+                float cost;
+                found[i] = !OutOfTime() && PlanAgent(batch[searched[i]], table, slot, planned[i], cost);
+            }
+        };
+
+        if (searched.size() > 1) {
+            pool.Run(plan);
+        } else {
+            plan(0);
+        }
+
+        deferred.clear();
+        for (int b = 0, i = 0; b < (int)batch.size(); b++) {
+            const int a = batch[b];
+            if (keep[b]) {
+                if (table.IsPathFree(*result[a])) {
+                    settle(a, result[a]);
+                } else {
+                    deferred.push_back(a);
+                }
+                continue;
+            }
+
+            std::vector<int>& path = planned[i];
+            if (!found[i++]) {
+                // Leave it where it is, and have the others go around it
+                allFound = false;
+                settle(a, std::make_shared<const std::vector<int>>(1, starts[a]));
+            } else if (table.IsPathFree(path)) {
+                settle(a, std::make_shared<const std::vector<int>>(std::move(path)));
+            } else {
+                deferred.push_back(a);
+            }
+        }
+
+        pending.insert(pending.begin(), deferred.begin(), deferred.end());
+    }
+
+    return allFound;
+}
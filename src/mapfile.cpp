@@ -0,0 +1,171 @@
+/**
+ * @File: mapfile.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Chunk-tiled terrain layers of a static map, and the binary map file
+ *     format which stores them as-is
+ */
+#include "mapfile.hpp"
+
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t MAP_MAGIC = 0x50414D50; // "PMAP"
+const uint32_t MAP_VERSION = 1;
+
+struct MapHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    int32_t dimsX;
+    int32_t dimsY;
+    int32_t chunkSize;
+    uint32_t nTypes;
+    uint8_t types[TiledTerrain::MAX_TYPES]; //!< Terrain type of each layer value
+};
+
+//! log2 of n, or -1 if it isn't a power of two
+int Log2(int n)
+{
+    if (n <= 0 || (n & (n - 1))) return -1;
+
+    int s = 0;
+    while ((1 << s) < n) s++;
+    return s;
+}
+
+} // namespace
+
+TiledTerrain::~TiledTerrain()
+{
+    Unmap();
+}
+
+void TiledTerrain::Unmap()
+{
+    if (mapping) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+        mappingSize = 0;
+    }
+}
+
+size_t TiledTerrain::DataSize() const
+{
+    const int cs = 1 << shift;
+    const size_t chunksY = (dims.y + cs - 1) / cs;
+    return chunksX * chunksY * cs * cs;
+}
+
+bool TiledTerrain::Create(olc::vi2d _dims, const std::vector<uint8_t>& _types, int chunkSize)
+{
+    const int s = Log2(chunkSize);
+    if (s < 0 || _dims.x <= 0 || _dims.y <= 0 || _types.empty() || _types.size() > MAX_TYPES) {
+        std::cout << "Invalid terrain dimensions, chunk size or number of layers" << std::endl;
+        return false;
+    }
+
+    Unmap();
+    dims = _dims;
+    shift = s;
+    chunksX = (dims.x + chunkSize - 1) / chunkSize;
+    types = _types;
+
+    owned.assign(DataSize(), 0);
+    data = owned.data();
+
+    return true;
+}
+
+bool TiledTerrain::Save(const std::string& fname) const
+{
+    std::ofstream out(fname, std::ios::binary);
+    if (!out || !IsLoaded()) {
+        std::cout << "Unable to write map to " << fname << std::endl;
+        return false;
+    }
+
+    MapHeader header {MAP_MAGIC, MAP_VERSION, dims.x, dims.y, GetChunkSize(), (uint32_t)types.size(), {}};
+    std::copy(types.begin(), types.end(), header.types);
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    out.write(reinterpret_cast<const char*>(data), DataSize());
+
+    return (bool)out;
+}
+
+bool TiledTerrain::ReadDims(const std::string& fname, olc::vi2d& dims)
+{
+    std::ifstream in(fname, std::ios::binary);
+    MapHeader header;
+    if (!in.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != MAP_MAGIC) {
+        std::cout << "Invalid map file " << fname << std::endl;
+        return false;
+    }
+
+    dims = {header.dimsX, header.dimsY};
+    return true;
+}
+
+bool TiledTerrain::Load(const std::string& fname)
+{
+    const int fd = open(fname.c_str(), O_RDONLY);
+    if (fd < 0) {
+        std::cout << "Unable to open map file " << fname << std::endl;
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(MapHeader)) {
+        std::cout << "Invalid map file " << fname << std::endl;
+        close(fd);
+        return false;
+    }
+
+    void* file = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (file == MAP_FAILED) {
+        std::cout << "Unable to map " << fname << " into memory" << std::endl;
+        return false;
+    }
+
+    const MapHeader* header = static_cast<const MapHeader*>(file);
+    const int s = Log2(header->chunkSize);
+    bool valid = header->magic == MAP_MAGIC && header->version == MAP_VERSION && s >= 0 &&
+                 header->dimsX > 0 && header->dimsY > 0 &&
+                 header->nTypes > 0 && header->nTypes <= MAX_TYPES;
+
+    if (valid) {
+        const size_t cs = header->chunkSize;
+        const size_t size = ((header->dimsX + cs - 1) / cs) * ((header->dimsY + cs - 1) / cs) * cs * cs;
+        valid = (size_t)st.st_size == sizeof(MapHeader) + size;
+    }
+
+    if (!valid) {
+        std::cout << "Invalid map file " << fname << std::endl;
+        munmap(file, st.st_size);
+        return false;
+    }
+
+    Unmap();
+    mapping = file;
+    mappingSize = st.st_size;
+
+    dims = {header->dimsX, header->dimsY};
+    shift = s;
+    chunksX = (dims.x + header->chunkSize - 1) / header->chunkSize;
+    types.assign(header->types, header->types + header->nTypes);
+    data = reinterpret_cast<const uint8_t*>(header + 1);
+
+    owned.clear();
+    owned.shrink_to_fit();
+
+    return true;
+}
@@ -0,0 +1,192 @@
+/**
+ * @File: mapimage.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Import of static map terrain from PNG images
+ */
+#include "mapimage.hpp"
+
+#include <png.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <unordered_map>
+
+namespace {
+
+//! An open PNG file, with its header read
+struct PngReader
+{
+    FILE* file {nullptr};
+    png_structp png {nullptr};
+    png_infop info {nullptr};
+
+    ~PngReader() {
+        if (png) png_destroy_read_struct(&png, info ? &info : nullptr, nullptr);
+        if (file) fclose(file);
+    }
+};
+
+//! Open a PNG and read its header; libpng errors jump back to the caller's setjmp()
+bool OpenPng(const std::string& fname, PngReader& reader)
+{
+    reader.file = fopen(fname.c_str(), "rb");
+    if (!reader.file) {
+        std::cout << "Unable to open image " << fname << std::endl;
+        return false;
+    }
+
+    png_byte sig[8];
+    if (fread(sig, 1, sizeof(sig), reader.file) != sizeof(sig) || png_sig_cmp(sig, 0, sizeof(sig))) {
+        std::cout << "Not a PNG image: " << fname << std::endl;
+        return false;
+    }
+
+    reader.png = png_create_read_struct(PNG_LIBPNG_VER_STRING, nullptr, nullptr, nullptr);
+    if (reader.png) {
+        reader.info = png_create_info_struct(reader.png);
+    }
+
+    if (!reader.info) {
+        std::cout << "Unable to read image " << fname << std::endl;
+        return false;
+    }
+
+    png_init_io(reader.png, reader.file);
+    png_set_sig_bytes(reader.png, sizeof(sig));
+    return true;
+}
+
+//! Index of the colour nearest to a pixel
+uint8_t NearestColor(const std::vector<olc::Pixel>& colors, int r, int g, int b)
+{
+    uint8_t best = 0;
+    int bestDist = INT32_MAX;
+    for (size_t k = 0; k < colors.size(); k++) {
+        const int dr = r - colors[k].r;
+        const int dg = g - colors[k].g;
+        const int db = b - colors[k].b;
+        const int dist = dr*dr + dg*dg + db*db;
+        if (dist < bestDist) {
+            bestDist = dist;
+            best = (uint8_t)k;
+        }
+    }
+    return best;
+}
+
+} // namespace
+
+bool ReadImageDims(const std::string& fname, olc::vi2d& dims)
+{
+    PngReader reader;
+    if (!OpenPng(fname, reader)) return false;
+
+    if (setjmp(png_jmpbuf(reader.png))) {
+        std::cout << "Invalid PNG image " << fname << std::endl;
+        return false;
+    }
+
+    png_read_info(reader.png, reader.info);
+    dims = {(int)png_get_image_width(reader.png, reader.info), (int)png_get_image_height(reader.png, reader.info)};
+    return true;
+}
+
+bool LoadImageTerrain(const std::string& fname, const ImageLegend& legend, const std::vector<uint8_t>& types,
+                      TiledTerrain& terrain)
+{
+    PngReader reader;
+    if (!OpenPng(fname, reader)) return false;
+
+    // Declared before the setjmp(), so that an error from libpng can't skip their destructors
+    std::vector<png_byte> strip;
+    std::vector<png_bytep> rows;
+    std::unordered_map<uint32_t, uint8_t> fromColor;
+
+    if (setjmp(png_jmpbuf(reader.png))) {
+        std::cout << "Invalid PNG image " << fname << std::endl;
+        return false;
+    }
+
+    png_structp png = reader.png;
+    png_infop info = reader.info;
+    png_read_info(png, info);
+
+    const olc::vi2d dims = {(int)png_get_image_width(png, info), (int)png_get_image_height(png, info)};
+    const int colorType = png_get_color_type(png, info);
+    if (png_get_interlace_type(png, info) != PNG_INTERLACE_NONE) {
+        std::cout << "Interlaced images can't be read a strip at a time; re-save " << fname
+                  << " without interlacing" << std::endl;
+        return false;
+    }
+
+    // Unpack to either one byte (palette index) or three bytes (RGB) per pixel
+    const bool indexed = (colorType == PNG_COLOR_TYPE_PALETTE);
+    if (png_get_bit_depth(png, info) == 16) png_set_strip_16(png);
+    if (indexed) {
+        png_set_packing(png);
+    } else {
+        // Expanding turns a tRNS chunk into an alpha channel too, so always strip it
+        if (colorType == PNG_COLOR_TYPE_GRAY || colorType == PNG_COLOR_TYPE_GRAY_ALPHA) png_set_gray_to_rgb(png);
+        png_set_expand(png);
+        png_set_strip_alpha(png);
+    }
+    png_read_update_info(png, info);
+
+    if (png_get_channels(png, info) != (indexed ? 1 : 3)) {
+        std::cout << "Unable to decode " << fname << " to " << (indexed ? "palette indices" : "RGB") << std::endl;
+        return false;
+    }
+
+    if (!indexed && legend.colors.empty()) {
+        std::cout << "No terrain colours given for the colours of " << fname << std::endl;
+        return false;
+    }
+
+    if (!terrain.Create(dims, types)) return false;
+
+    const uint8_t maxValue = (uint8_t)(types.size() - 1);
+
+    // Translate each palette index, or each distinct colour, just once
+    uint8_t fromIndex[256];
+    for (int k = 0; k < 256; k++) {
+        const int val = k < (int)legend.palette.size() ? legend.palette[k] : (legend.palette.empty() ? k : 0);
+        fromIndex[k] = (uint8_t)std::min(val, (int)maxValue);
+    }
+
+    // Decode one strip of rows at a time, a chunk tall
+    const int stripRows = terrain.GetChunkSize();
+    const size_t rowBytes = png_get_rowbytes(png, info);
+    strip.resize(rowBytes * stripRows);
+    rows.resize(stripRows);
+    for (int r = 0; r < stripRows; r++) {
+        rows[r] = strip.data() + r * rowBytes;
+    }
+
+    for (int j0 = 0; j0 < dims.y; j0 += stripRows) {
+        const int nRows = std::min(stripRows, dims.y - j0);
+        png_read_rows(png, rows.data(), nullptr, nRows);
+
+        for (int r = 0; r < nRows; r++) {
+            const png_bytep row = rows[r];
+            for (int i = 0; i < dims.x; i++) {
+                if (indexed) {
+                    terrain.Set(i, j0 + r, fromIndex[row[i]]);
+                    continue;
+                }
+
+                const png_bytep px = row + 3 * i;
+                const uint32_t rgb = (px[0] << 16) | (px[1] << 8) | px[2];
+                auto [it, added] = fromColor.try_emplace(rgb, 0);
+                if (added) {
+                    it->second = std::min(NearestColor(legend.colors, px[0], px[1], px[2]), maxValue);
+                }
+                terrain.Set(i, j0 + r, it->second);
+            }
+        }
+    }
+
+    return true;
+}
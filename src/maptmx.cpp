@@ -0,0 +1,476 @@
+/**
+ * @File: maptmx.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Import of static map terrain from Tiled (.tmx) maps
+ */
+#include "maptmx.hpp"
+#include "util.hpp"
+
+#include <zlib.h>
+
+#include <array>
+#include <cctype>
+#include <cstdlib>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string_view>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const uint32_t FLIP_H = 0x80000000;
+const uint32_t FLIP_V = 0x40000000;
+const uint32_t FLIP_D = 0x20000000;
+const uint32_t GID_MASK = 0x0FFFFFFF; //!< The rest of the high bits are flags too
+
+const uint8_t NO_TERRAIN = 0xFF;
+
+//! Layer value at each corner of a tile: top-left, top-right, bottom-left, bottom-right
+using Corners = std::array<uint8_t, 4>;
+
+//! A whole file, memory-mapped read-only
+class MappedFile
+{
+public:
+    ~MappedFile() {
+        if (data) munmap(data, size);
+    }
+
+    bool Open(const std::string& fname) {
+        const int fd = open(fname.c_str(), O_RDONLY);
+        if (fd < 0) {
+            std::cout << "Unable to open " << fname << std::endl;
+            return false;
+        }
+
+        struct stat st;
+        if (fstat(fd, &st) == 0 && st.st_size > 0) {
+            void* file = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (file != MAP_FAILED) {
+                data = file;
+                size = st.st_size;
+            }
+        }
+        close(fd);
+
+        if (!data) {
+            std::cout << "Unable to read " << fname << std::endl;
+        }
+        return data != nullptr;
+    }
+
+    std::string_view Text() const { return {static_cast<const char*>(data), size}; }
+
+private:
+    void* data {nullptr};
+    size_t size {0};
+};
+
+/**
+ * @brief Find the next element with the given name, from 'pos' on
+ *
+ * @param tag Set to the element's opening tag, less the angle brackets
+ * @param pos Moved to just past the opening tag
+ * @return false if there is none before 'end'
+ */
+bool NextTag(std::string_view xml, size_t& pos, std::string_view name, std::string_view& tag,
+             size_t end = std::string_view::npos)
+{
+    end = std::min(end, xml.size());
+    while (pos < end) {
+        pos = xml.find('<', pos);
+        if (pos == std::string_view::npos || pos >= end) break;
+
+        const size_t start = pos + 1;
+        const size_t close = xml.find('>', start);
+        if (close == std::string_view::npos) break;
+
+        pos = close + 1;
+        if (xml.compare(start, name.size(), name) == 0 && start + name.size() < xml.size()) {
+            const char next = xml[start + name.size()];
+            if (next == ' ' || next == '\t' || next == '\n' || next == '\r' || next == '/' || next == '>') {
+                tag = xml.substr(start, close - start);
+                return true;
+            }
+        }
+    }
+
+    pos = end;
+    return false;
+}
+
+//! Value of an attribute of a tag; empty if it hasn't one
+std::string Attr(std::string_view tag, std::string_view name)
+{
+    size_t pos = 0;
+    while ((pos = tag.find(name, pos)) != std::string_view::npos) {
+        const size_t eq = pos + name.size();
+        const bool whole = pos > 0 && isspace((unsigned char)tag[pos - 1]);
+        if (whole && eq + 1 < tag.size() && tag[eq] == '=' && (tag[eq + 1] == '"' || tag[eq + 1] == '\'')) {
+            const size_t close = tag.find(tag[eq + 1], eq + 2);
+            return std::string(tag.substr(eq + 2, close - (eq + 2)));
+        }
+        pos = eq;
+    }
+    return "";
+}
+
+int IntAttr(std::string_view tag, std::string_view name, int fallback = 0)
+{
+    const std::string val = Attr(tag, name);
+    return val.empty() ? fallback : std::atoi(val.c_str());
+}
+
+//! Layer value of a terrain, by its name
+uint8_t LayerOf(const std::string& name, const TmxLegend& legend)
+{
+    for (const auto& [text, layer] : legend.terrains) {
+        if (name.find(text) != std::string::npos) {
+            return layer;
+        }
+    }
+    return legend.fallback;
+}
+
+/**
+ * @brief Read the corners of each tile of a tileset, from either Tiled's
+ *        older terrains or its newer corner Wang sets
+ *
+ * @param xml      The tileset's element and its contents
+ * @param firstGid Global ID of the tileset's first tile
+ */
+void ReadTileset(std::string_view xml, uint32_t firstGid, const TmxLegend& legend, std::vector<Corners>& corners)
+{
+    size_t pos = 0;
+    std::string_view tag;
+    if (!NextTag(xml, pos, "tileset", tag)) return;
+
+    // Tiles without a terrain keep none at every corner
+    auto tile = [&](uint32_t gid) -> Corners& {
+        if (gid >= corners.size()) {
+            corners.resize(gid + 1, {NO_TERRAIN, NO_TERRAIN, NO_TERRAIN, NO_TERRAIN});
+        }
+        return corners[gid];
+    };
+
+    // Terrains: <terrain name=""/> ... <tile id="" terrain="tl,tr,bl,br"/>
+    std::vector<uint8_t> terrainLayers;
+    for (size_t p = pos; NextTag(xml, p, "terrain", tag);) {
+        terrainLayers.push_back(LayerOf(Attr(tag, "name"), legend));
+    }
+
+    for (size_t p = pos; NextTag(xml, p, "tile", tag);) {
+        const std::string terrain = Attr(tag, "terrain");
+        if (terrain.empty()) continue;
+
+        Corners& c = tile(firstGid + IntAttr(tag, "id"));
+        std::stringstream ss(terrain);
+        std::string item;
+        for (int k = 0; k < 4 && std::getline(ss, item, ','); k++) {
+            const int t = item.empty() ? -1 : std::atoi(item.c_str());
+            c[k] = (t >= 0 && t < (int)terrainLayers.size()) ? terrainLayers[t] : NO_TERRAIN;
+        }
+    }
+
+    // Corner Wang sets: <wangcolor name=""/> ... <wangtile tileid="" wangid="t,tr,r,br,b,bl,l,tl"/>
+    for (size_t p = pos; NextTag(xml, p, "wangset", tag);) {
+        const size_t end = xml.find("</wangset>", p);
+        if (Attr(tag, "type") != "corner") continue;
+
+        std::vector<uint8_t> colorLayers;
+        size_t q = p;
+        while (NextTag(xml, q, "wangcolor", tag, end)) {
+            colorLayers.push_back(LayerOf(Attr(tag, "name"), legend));
+        }
+
+        q = p;
+        while (NextTag(xml, q, "wangtile", tag, end)) {
+            Corners& c = tile(firstGid + IntAttr(tag, "tileid"));
+            int wang[8] = {0};
+            std::stringstream ss(Attr(tag, "wangid"));
+            std::string item;
+            for (int k = 0; k < 8 && std::getline(ss, item, ','); k++) {
+                wang[k] = std::atoi(item.c_str());
+            }
+
+            const int order[4] = {7, 1, 5, 3}; // tl, tr, bl, br
+            for (int k = 0; k < 4; k++) {
+                const int color = wang[order[k]];
+                c[k] = (color > 0 && color <= (int)colorLayers.size()) ? colorLayers[color - 1] : NO_TERRAIN;
+            }
+        }
+    }
+}
+
+//! Layer value of a tile, from the corners of its Tiled tile, after flipping them
+uint8_t TileValue(uint32_t gid, const std::vector<Corners>& corners, uint8_t fallback)
+{
+    const uint32_t id = gid & GID_MASK;
+    if (id >= corners.size()) return fallback;
+
+    Corners c = corners[id];
+    if (gid & FLIP_D) std::swap(c[1], c[2]);
+    if (gid & FLIP_H) { std::swap(c[0], c[1]); std::swap(c[2], c[3]); }
+    if (gid & FLIP_V) { std::swap(c[0], c[2]); std::swap(c[1], c[3]); }
+
+    // Our tiles hold the layer of their bottom-right corner; failing that, take any
+    for (int k : {3, 2, 1, 0}) {
+        if (c[k] != NO_TERRAIN) return c[k];
+    }
+    return fallback;
+}
+
+//! Writes the tiles of a layer into the terrain, in order, as their global IDs come in
+struct GidSink
+{
+    TiledTerrain& terrain;
+    const std::vector<Corners>& corners;
+    uint8_t fallback;
+    uint8_t maxValue;
+    bool base;          //!< Whether this is the bottom layer, so its empty tiles take the fallback
+
+    olc::vi2d dims;
+    size_t count {0};
+    uint32_t partial {0}; //!< Bytes of a global ID split between blocks
+    int nPartial {0};
+
+    void Add(uint32_t gid) {
+        if (count < (size_t)dims.x * dims.y && (gid != 0 || base)) {
+            const uint8_t val = gid ? TileValue(gid, corners, fallback) : fallback;
+            terrain.Set(count % dims.x, count / dims.x, std::min(val, maxValue));
+        }
+        count++;
+    }
+
+    //! Little-endian global IDs, which may be split across blocks
+    void AddBytes(const uint8_t* bytes, size_t n) {
+        for (size_t k = 0; k < n; k++) {
+            partial |= (uint32_t)bytes[k] << (8 * nPartial);
+            if (++nPartial == 4) {
+                Add(partial);
+                partial = 0;
+                nPartial = 0;
+            }
+        }
+    }
+};
+
+bool DecodeCsv(std::string_view text, GidSink& sink)
+{
+    uint32_t val = 0;
+    bool inNumber = false;
+    for (const char ch : text) {
+        if (ch >= '0' && ch <= '9') {
+            val = val * 10 + (ch - '0');
+            inNumber = true;
+        } else if (inNumber) {
+            sink.Add(val);
+            val = 0;
+            inNumber = false;
+        }
+    }
+    if (inNumber) {
+        sink.Add(val);
+    }
+    return true;
+}
+
+/**
+ * @brief Decode base64 a block at a time, inflating each block if compressed
+ *
+ * @param compressed Whether the data is compressed with zlib or gzip
+ */
+bool DecodeBase64(std::string_view text, bool compressed, GidSink& sink)
+{
+    static const auto table = [] {
+        std::array<int8_t, 256> t;
+        t.fill(-1);
+        const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        for (int k = 0; k < 64; k++) {
+            t[(uint8_t)chars[k]] = k;
+        }
+        return t;
+    }();
+
+    constexpr size_t BLOCK = 1 << 16;
+    std::vector<uint8_t> in;
+    std::vector<uint8_t> out(compressed ? BLOCK : 0);
+    in.reserve(BLOCK + 3);
+
+    z_stream zs {};
+    if (compressed && inflateInit2(&zs, 15 + 32) != Z_OK) { // 15 + 32: zlib or gzip
+        return false;
+    }
+
+    bool ok = true;
+    bool done = false;
+    auto flush = [&]() {
+        if (!compressed) {
+            sink.AddBytes(in.data(), in.size());
+        } else {
+            zs.next_in = in.data();
+            zs.avail_in = in.size();
+            while (zs.avail_in > 0 && !done) {
+                zs.next_out = out.data();
+                zs.avail_out = out.size();
+                const int ret = inflate(&zs, Z_NO_FLUSH);
+                if (ret != Z_OK && ret != Z_STREAM_END) {
+                    ok = false;
+                    return;
+                }
+                sink.AddBytes(out.data(), out.size() - zs.avail_out);
+                done = (ret == Z_STREAM_END);
+            }
+        }
+        in.clear();
+    };
+
+    uint32_t bits = 0;
+    int nBits = 0;
+    for (const char ch : text) {
+        const int8_t v = table[(uint8_t)ch];
+        if (v < 0) continue; // Whitespace and padding
+
+        bits = (bits << 6) | v;
+        nBits += 6;
+        if (nBits >= 8) {
+            nBits -= 8;
+            in.push_back((bits >> nBits) & 0xFF);
+            if (in.size() >= BLOCK) {
+                flush();
+                if (!ok) break;
+            }
+        }
+    }
+    if (ok) {
+        flush();
+    }
+
+    if (compressed) {
+        inflateEnd(&zs);
+    }
+    return ok;
+}
+
+//! Read the <map> element, checking that it's a map we can load
+bool ReadMapTag(std::string_view xml, const std::string& fname, size_t& pos, olc::vi2d& dims)
+{
+    std::string_view tag;
+    pos = 0;
+    if (!NextTag(xml, pos, "map", tag)) {
+        std::cout << "Not a Tiled map: " << fname << std::endl;
+        return false;
+    }
+
+    if (Attr(tag, "infinite") == "1") {
+        std::cout << "Infinite Tiled maps aren't supported: " << fname << std::endl;
+        return false;
+    }
+
+    const std::string orientation = Attr(tag, "orientation");
+    if (!orientation.empty() && orientation != "orthogonal") {
+        std::cout << "Only orthogonal Tiled maps are supported: " << fname << std::endl;
+        return false;
+    }
+
+    dims = {IntAttr(tag, "width"), IntAttr(tag, "height")};
+    return true;
+}
+
+} // namespace
+
+bool ReadTmxDims(const std::string& fname, olc::vi2d& dims)
+{
+    MappedFile file;
+    size_t pos;
+    return file.Open(fname) && ReadMapTag(file.Text(), fname, pos, dims);
+}
+
+bool LoadTmxTerrain(const std::string& fname, const TmxLegend& legend, const std::vector<uint8_t>& types,
+                    TiledTerrain& terrain)
+{
+    MappedFile file;
+    if (!file.Open(fname)) return false;
+
+    const std::string_view xml = file.Text();
+    size_t pos;
+    olc::vi2d dims;
+    if (!ReadMapTag(xml, fname, pos, dims) || !terrain.Create(dims, types)) {
+        return false;
+    }
+
+    // The corners of every tile of every tileset, by global ID
+    std::vector<Corners> corners;
+    std::string_view tag;
+    for (size_t p = pos; NextTag(xml, p, "tileset", tag);) {
+        const uint32_t firstGid = IntAttr(tag, "firstgid", 1);
+        const std::string source = Attr(tag, "source");
+        if (source.empty()) {
+            const size_t start = xml.rfind('<', p - 1);
+            const size_t end = xml.find("</tileset>", p);
+            ReadTileset(xml.substr(start, end == std::string_view::npos ? end : end - start), firstGid, legend, corners);
+            continue;
+        }
+
+        std::ifstream tsx(RelativeTo(fname, source));
+        if (!tsx) {
+            std::cout << "Unable to open tileset " << source << " of " << fname << std::endl;
+            return false;
+        }
+        std::stringstream ss;
+        ss << tsx.rdbuf();
+        ReadTileset(ss.str(), firstGid, legend, corners);
+    }
+
+    int nLayers = 0;
+    std::string_view layer;
+    for (size_t p = pos; NextTag(xml, p, "layer", layer);) {
+        if (IntAttr(layer, "width", dims.x) != dims.x || IntAttr(layer, "height", dims.y) != dims.y) {
+            std::cout << "Layer '" << Attr(layer, "name") << "' of " << fname << " isn't the size of the map" << std::endl;
+            return false;
+        }
+
+        std::string_view data;
+        const size_t layerEnd = xml.find("</layer>", p);
+        if (!NextTag(xml, p, "data", data, layerEnd)) continue;
+
+        const size_t end = xml.find("</data>", p);
+        const std::string_view text = xml.substr(p, end == std::string_view::npos ? end : end - p);
+        const std::string encoding = Attr(data, "encoding");
+        const std::string compression = Attr(data, "compression");
+
+        GidSink sink {terrain, corners, legend.fallback, (uint8_t)(types.size() - 1), nLayers == 0, dims};
+        bool ok = true;
+        if (encoding == "csv") {
+            ok = DecodeCsv(text, sink);
+        } else if (encoding == "base64" && (compression.empty() || compression == "zlib" || compression == "gzip")) {
+            ok = DecodeBase64(text, !compression.empty(), sink);
+        } else if (encoding.empty()) {
+            for (size_t q = 0; NextTag(text, q, "tile", tag);) {
+                sink.Add(std::strtoul(Attr(tag, "gid").c_str(), nullptr, 10));
+            }
+        } else {
+            std::cout << "Unsupported layer encoding '" << encoding << "' " << compression << " in " << fname << std::endl;
+            return false;
+        }
+
+        if (!ok || sink.count != (size_t)dims.x * dims.y) {
+            std::cout << "Invalid data for layer '" << Attr(layer, "name") << "' of " << fname << std::endl;
+            return false;
+        }
+        nLayers++;
+    }
+
+    if (nLayers == 0) {
+        std::cout << "No tile layers in " << fname << std::endl;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,295 @@
+/**
+ * @File: pathcache.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     LRU cache of planner results which threads can share, and a Planner
+ *     which answers what it can from the cache before asking another planner
+ */
+
+#include "pathcache.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+
+//! FNV-1a, over any number of plain values
+struct Hasher
+{
+    uint64_t hash {14695981039346656037ull};
+
+    template <class T>
+    Hasher& operator<<(const T& value) {
+        uint8_t bytes[sizeof(T)];
+        std::memcpy(bytes, &value, sizeof(T));
+        for (uint8_t b : bytes) {
+            hash = (hash ^ b) * 1099511628211ull;
+        }
+        return *this;
+    }
+};
+
+} // namespace
+
+PathView PathCache::Result::View() const
+{
+    if (!Found()) {
+        return {nullptr, 0, -1.f, 0};
+    }
+
+    return {entry->tiles.data() + offset, entry->tiles.size() - offset, Cost(), 0};
+}
+
+size_t PathCache::KeyHash::operator()(const Key& k) const
+{
+    return (Hasher() << k.tile.x << k.tile.y << k.goal.x << k.goal.y << k.config << k.version).hash;
+}
+
+PathCache::PathCache(size_t capacity, int nShards) :
+    shards(std::max(1, nShards))
+{
+    shardCapacity = std::max<size_t>(1, capacity / shards.size());
+}
+
+PathCache::Shard& PathCache::ShardFor(WorldPos goal, uint64_t config, uint64_t version)
+{
+    const uint64_t hash = (Hasher() << goal.x << goal.y << config << version).hash;
+    return shards[hash % shards.size()];
+}
+
+bool PathCache::Find(WorldPos start, WorldPos goal, uint64_t config, uint64_t version, bool subPaths,
+                     Result& result)
+{
+    Shard& shard = ShardFor(goal, config, version);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    const auto it = shard.index.find({start, goal, config, version});
+    if (it == shard.index.end() || (it->second.offset > 0 && !subPaths)) {
+        misses++;
+        return false;
+    }
+
+    // Bump it to the front of the LRU list
+    shard.lru.splice(shard.lru.begin(), shard.lru, it->second.entry);
+
+    result.entry = *it->second.entry;
+    result.offset = it->second.offset;
+    (result.offset == 0 ? hits : subPathHits)++;
+    return true;
+}
+
+void PathCache::Insert(std::shared_ptr<const Entry> entry)
+{
+    Shard& shard = ShardFor(entry->goal, entry->config, entry->version);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    shard.lru.push_front(entry);
+    const auto pos = shard.lru.begin();
+
+    auto index = [&](WorldPos tile, size_t offset) {
+        auto [it, added] = shard.index.try_emplace({tile, entry->goal, entry->config, entry->version},
+                                                   Slot {pos, offset});
+
+        // Keep a result from this very start over a path passing through it
+        if (!added && (offset == 0 || it->second.offset > 0)) {
+            it->second = {pos, offset};
+        }
+    };
+
+    index(entry->start, 0);
+    for (size_t k = 1; k < entry->tiles.size(); k++) {
+        index(entry->tiles[k], k);
+    }
+    inserts++;
+
+    while (shard.lru.size() > shardCapacity) {
+        Evict(shard);
+    }
+}
+
+void PathCache::Evict(Shard& shard)
+{
+    const auto last = std::prev(shard.lru.end());
+    const Entry& entry = **last;
+
+    // Only drop the index slots which still lead to this entry
+    auto unindex = [&](WorldPos tile) {
+        const auto it = shard.index.find({tile, entry.goal, entry.config, entry.version});
+        if (it != shard.index.end() && it->second.entry == last) {
+            shard.index.erase(it);
+        }
+    };
+
+    unindex(entry.start);
+    for (size_t k = 1; k < entry.tiles.size(); k++) {
+        unindex(entry.tiles[k]);
+    }
+
+    shard.lru.erase(last);
+    evictions++;
+}
+
+void PathCache::Clear()
+{
+    for (Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.index.clear();
+        shard.lru.clear();
+    }
+}
+
+size_t PathCache::Size() const
+{
+    size_t size = 0;
+    for (const Shard& shard : shards) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        size += shard.lru.size();
+    }
+    return size;
+}
+
+PathCacheStats PathCache::GetStats() const
+{
+    PathCacheStats stats;
+    stats.hits = hits;
+    stats.subPathHits = subPathHits;
+    stats.misses = misses;
+    stats.inserts = inserts;
+    stats.evictions = evictions;
+    return stats;
+}
+
+void PathCache::ResetStats()
+{
+    hits = 0;
+    subPathHits = 0;
+    misses = 0;
+    inserts = 0;
+    evictions = 0;
+}
+
+void CachedPlanner::SetTerrainMap(GameMap& _map)
+{
+    map = &_map;
+    planner->SetTerrainMap(_map);
+}
+
+bool CachedPlanner::Lookup(WorldPos _start, WorldPos _goal)
+{
+    start = _start;
+    goal = _goal;
+    version = map->GetVersion();
+
+    fromCache = cache->Find(start, goal, config, version, subPaths, cached);
+    if (fromCache) {
+        planStatus = cached.Found() ? PlanStatus::FOUND : PlanStatus::NO_PATH;
+    } else {
+        cached = {};
+    }
+
+    return fromCache;
+}
+
+bool CachedPlanner::ComputePath(WorldPos _start, WorldPos _goal)
+{
+    PROFILE_FUNC();
+
+    if (Lookup(_start, _goal)) {
+        return cached.Found();
+    }
+
+    const bool found = planner->ComputePath(start, goal);
+    planStatus = found ? PlanStatus::FOUND : PlanStatus::NO_PATH;
+    Store();
+
+    return found;
+}
+
+void CachedPlanner::StartPath(WorldPos _start, WorldPos _goal)
+{
+    if (Lookup(_start, _goal)) return;
+
+    // Planners which can't pause finish the search right here
+    planner->StartPath(start, goal);
+    planStatus = planner->GetStatus();
+    if (planStatus != PlanStatus::IN_PROGRESS) {
+        Store();
+    }
+}
+
+PlanStatus CachedPlanner::StepPath(int maxExpansions, int maxMicros)
+{
+    if (fromCache || planStatus != PlanStatus::IN_PROGRESS) {
+        return planStatus;
+    }
+
+    planStatus = planner->StepPath(maxExpansions, maxMicros);
+    if (planStatus != PlanStatus::IN_PROGRESS) {
+        Store();
+    }
+
+    return planStatus;
+}
+
+void CachedPlanner::Store()
+{
+    auto entry = std::make_shared<PathCache::Entry>();
+    entry->start = start;
+    entry->goal = goal;
+    entry->config = config;
+    entry->version = version;
+
+    const PathView path = planner->GetPath();
+    entry->expansions = path.expansions;
+
+    // A path which was found but has no tiles would read as no path at all
+    if (planStatus == PlanStatus::FOUND && path.empty()) return;
+
+    if (planStatus == PlanStatus::FOUND) {
+        entry->tiles.assign(path.begin(), path.end());
+
+        // Sum the cost back from the goal, so that the rest of the path from
+        // any tile can be handed out; the start takes the planner's own cost
+        const size_t n = entry->tiles.size();
+        entry->costToGoal.assign(n, 0.f);
+        for (size_t k = n - 1; k > 0; k--) {
+            const WorldPos d = entry->tiles[k] - entry->tiles[k - 1];
+            const float step = (d.x != 0 && d.y != 0) ? SQRT2 : 1.f;
+            const float effort = map->GetEffortAt(entry->tiles[k].x, entry->tiles[k].y);
+            entry->costToGoal[k - 1] = entry->costToGoal[k] + step + effort;
+        }
+        entry->costToGoal[0] = path.cost;
+    }
+
+    cache->Insert(std::move(entry));
+}
+
+PathView CachedPlanner::GetPath()
+{
+    return fromCache ? cached.View() : planner->GetPath();
+}
+
+float CachedPlanner::GetPathCost()
+{
+    return fromCache ? cached.Cost() : planner->GetPathCost();
+}
+
+PathView CachedPlanner::GetPartialPath()
+{
+    return fromCache ? cached.View() : planner->GetPartialPath();
+}
+
+QueryStats CachedPlanner::GetQueryStats()
+{
+    return fromCache ? QueryStats() : planner->GetQueryStats();
+}
+
+uint64_t PlannerConfigKey(const Config& config)
+{
+    Hasher h;
+    h << config.method << config.heuristic << config.connectivity << config.openList << config.epsilon;
+    h << config.lookahead << (config.nLandmarks > 0);
+    return h.hash;
+}
@@ -25,6 +25,9 @@ bool PlannerDemo::OnUserCreate()
 
     gameMap.SetPGE(static_cast<PixelGameEngine*>(this));
     gameMap.GenerateMap();
+    gameMap.Subscribe([this](const MapChange& change) {
+        if (change.kind == TERRAIN_EDITED) terrainChanged = true;
+    });
 
     // Clear the top layer so we can later draw to layers underneath
     SetPixelMode(olc::Pixel::MASK);
@@ -47,7 +50,23 @@ bool PlannerDemo::OnUserCreate()
 
     switch (config.method) {
         case ASTAR:
-            planner = new AStar();
+            planner = new AStar(config.heuristic, config.connectivity, config.openList, config.epsilon);
+            break;
+
+        case HDASTAR:
+            planner = new HDAStar(config.nThreads, config.heuristic, config.connectivity, config.epsilon);
+            break;
+
+        case RTAASTAR:
+            planner = new RTAAStar(config.lookahead, config.heuristic, config.connectivity);
+            break;
+
+        case CONTRACTION:
+            planner = new CHPlanner(config.chCache ? config.fConfig + ".ch" : "");
+            break;
+
+        case CPD:
+            planner = new CPDPlanner(config.cpdCache ? config.fConfig + ".cpd" : "");
             break;
 
         case RRTSTAR:
@@ -57,8 +76,25 @@ bool PlannerDemo::OnUserCreate()
             break;
     }
 
+    // Answer repeated queries (e.g. the cursor going back over a tile) from
+    // a cache; only optimal planners may reuse the rest of a cached path,
+    // which rules out A* on the bucket open list (up to 1/64 over optimal).
+    // Planners which can answer the same query differently each time are
+    // never cached: RTAA* learns as it goes, and HDA* races its threads.
+    const bool deterministic = config.method != RTAASTAR && (config.method != HDASTAR || config.nThreads == 1);
+    if (config.pathCache > 0 && deterministic) {
+        const bool optimal = config.epsilon == 0.f &&
+            ((config.method == ASTAR && config.openList != OPEN_BUCKET) || config.method == HDASTAR ||
+             config.method == CONTRACTION || config.method == CPD);
+        pathCache = new PathCache(config.pathCache);
+        planner = new CachedPlanner(planner, pathCache, PlannerConfigKey(config), optimal);
+    }
+
     /** Setup the path-planning objects */
     planner->SetTerrainMap(gameMap);
+    if (config.nLandmarks > 0) {
+        planner->SetLandmarks(&landmarks);
+    }
 
     return true;
 }
@@ -72,13 +108,15 @@ bool PlannerDemo::OnUserUpdate(float fElapsedTime)
     GetUserInput();
 
     const float panSpeed = 250.f;
-    if (wPressed) viewOffset.y -= fElapsedTime * panSpeed;
-    if (aPressed) viewOffset.x -= fElapsedTime * panSpeed;
-    if (sPressed) viewOffset.y += fElapsedTime * panSpeed;
-    if (dPressed) viewOffset.x += fElapsedTime * panSpeed;
+    if (wPressed) cameraFrac.y -= fElapsedTime * panSpeed;
+    if (aPressed) cameraFrac.x -= fElapsedTime * panSpeed;
+    if (sPressed) cameraFrac.y += fElapsedTime * panSpeed;
+    if (dPressed) cameraFrac.x += fElapsedTime * panSpeed;
 
-    // viewOffset.x = std::min(std::max(0.f, viewOffset.x), (float)((config.dims.x - 2) * 32 - ScreenWidth()));
-    // viewOffset.y = std::min(std::max(0.f, viewOffset.y), (float)((config.dims.y - 2) * 32 - ScreenHeight()));
+    // Move the camera by whole pixels only, keeping the rest for later frames
+    const WorldPos step = {(int64_t)std::floor(cameraFrac.x), (int64_t)std::floor(cameraFrac.y)};
+    camera += step;
+    cameraFrac -= olc::vf2d({(float)step.x, (float)step.y});
 
     DrawBackground();
 
@@ -86,7 +124,7 @@ bool PlannerDemo::OnUserUpdate(float fElapsedTime)
 
     // Highlight the map tile under the mouse
     SetPixelMode(olc::Pixel::ALPHA);
-    DrawDecal(mTileXY - viewOffset, tileHighlight.Decal(), noscale, olc::WHITE);
+    DrawDecal(ToScreen(mTileXY), tileHighlight.Decal(), noscale, olc::WHITE);
     SetPixelMode(olc::Pixel::NORMAL);
 
     if (!gamePaused) {
@@ -118,8 +156,16 @@ bool PlannerDemo::OnUserUpdate(float fElapsedTime)
 
         // If the goal tile has been set, display the shortest path
 
-        if (isGoalSet && (newStart || newGoal)) {
-            havePath = planner->ComputePath(mTileIJ, goalIJ);
+        if (isGoalSet && (newStart || newGoal || terrainChanged)) {
+            planner->StartPath(mTileIJ, goalIJ);
+            planStatus = PlanStatus::IN_PROGRESS;
+        }
+        terrainChanged = false;
+
+        // Advance the search by (at most) one frame's worth of work
+        if (planStatus == PlanStatus::IN_PROGRESS) {
+            planStatus = planner->StepPath(config.frameBudget > 0 ? config.frameBudget : INT32_MAX);
+            havePath = (planStatus != PlanStatus::NO_PATH);
             pathCost = planner->GetPathCost();
         }
     }
@@ -127,7 +173,7 @@ bool PlannerDemo::OnUserUpdate(float fElapsedTime)
     // If the goal tile has been set, display it
     if (isGoalSet) {
         SetPixelMode(olc::Pixel::ALPHA);
-        DrawDecal(goalPos - viewOffset, tileHighlight.Decal(), noscale, olc::CYAN);
+        DrawDecal(ToScreen(goalPos), tileHighlight.Decal(), noscale, olc::CYAN);
         SetPixelMode(olc::Pixel::NORMAL);
     }
 
@@ -146,7 +192,7 @@ void PlannerDemo::DrawBackground()
     SetPixelMode(olc::Pixel::MASK);
 
     // Draw the world terrain map
-    gameMap.Draw({(int)viewOffset.x, (int)viewOffset.y});
+    gameMap.Draw(camera);
 }
 
 void PlannerDemo::GetUserInput()
@@ -156,6 +202,8 @@ void PlannerDemo::GetUserInput()
      * - WASD to pan the map
      * - C to recenter the map
      * - P to pause the pathfinding
+     * - R to pave a road on the tile under the cursor
+     * - F to flood the tile under the cursor
      */
 
     if (GetKey(olc::Key::W).bPressed) {
@@ -183,40 +231,51 @@ void PlannerDemo::GetUserInput()
     }
 
     if (GetKey(olc::Key::C).bPressed) {
-        viewOffset = {0.f, 0.f};
+        camera = {0, 0};
+        cameraFrac = {0.f, 0.f};
     }
 
     if (GetKey(olc::Key::P).bPressed) {
         gamePaused = !gamePaused;
     }
+
+    if (GetKey(olc::Key::R).bHeld) {
+        gameMap.SetTerrainAt(mTileIJ.x, mTileIJ.y, PAVERS);
+    }
+
+    if (GetKey(olc::Key::F).bHeld) {
+        gameMap.SetTerrainAt(mTileIJ.x, mTileIJ.y, WATER);
+    }
 }
 
 void PlannerDemo::UpdateCursor()
 {
     mouse = GetMousePos();
-    wMouse = mouse + viewOffset;
+    wMouse = camera + WorldPos({mouse.x, mouse.y});
 
     // Get the map tile at the mouse location, and its top-left coords
     // The current tile will always be used as the start location
-    mTileIJ = {(int)wMouse.x / TW, (int)wMouse.y / TH};
+    mTileIJ = {FloorDiv(wMouse.x, TW), FloorDiv(wMouse.y, TH)};
     mTileXY = {mTileIJ.x * TW, mTileIJ.y * TH};
 }
 
 void PlannerDemo::DrawPath()
 {
     if (havePath) {
-        auto vPath = planner->GetPath();
+        // Show the best partial path while the search is still running
+        const bool partial = (planStatus == PlanStatus::IN_PROGRESS);
+        const PathView vPath = partial ? planner->GetPartialPath() : planner->GetPath();
+        const olc::Pixel color = partial ? olc::YELLOW : olc::MAGENTA;
 
-        if (vPath.size() > 0) {
+        if (vPath.size() > 1) {
             /// Draw the output from A*
             SetDrawTarget(layerGame);
             SetPixelMode(olc::Pixel::ALPHA);
             // Draw the returned path, skipping the start and goal tiles (already drawn)
-            for (uint32_t i = 1; i < vPath.size() - 1; i++) {
+            for (size_t i = 1; i < vPath.size() - 1; i++) {
                 auto ij = vPath[i];
-                olc::vf2d xy = {float(ij.x * TW), float(ij.y * TH)};
-                xy -= viewOffset;
-                DrawDecal(xy, tileHighlight.Decal(), noscale, olc::MAGENTA);
+                const WorldPos xy = {ij.x * TW, ij.y * TH};
+                DrawDecal(ToScreen(xy), tileHighlight.Decal(), noscale, color);
             }
             SetPixelMode(olc::Pixel::NORMAL);
         }
@@ -242,7 +301,14 @@ void PlannerDemo::PrintOverlay()
     ss << ", Effort: " << gameMap.GetEffortAt(mTileIJ.x, mTileIJ.y);
     ss << std::endl << std::endl;
     ss << "Path Cost:   " << pathCost;
-    DrawStringDecal({5, (float)ScreenHeight() - 9*8-4}, ss.str());
+    ss << std::endl << std::endl;
+    const QueryStats stats = planner->GetQueryStats();
+    ss << "Expansions: " << planner->GetPath().expansions;
+    ss << ", Allocs: " << stats.allocs << " (heap: " << stats.heapAllocs << ")";
+    if (pathCache) {
+        ss << ", Cache hits: " << (int)(100 * pathCache->GetStats().HitRate()) << "%";
+    }
+    DrawStringDecal({5, (float)ScreenHeight() - 11*8-4}, ss.str());
 
     // Second status in top-left: PAUSED indicator + keys pressed
     if (gamePaused) {
@@ -0,0 +1,243 @@
+/**
+ * @File: rtaastar.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Real-Time Adaptive A* (RTAA*): an agent which moves every tick after a
+ *     bounded local search, learning better heuristic values as it goes
+ */
+
+#include "rtaastar.hpp"
+#include "heuristics.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+
+void RTAAStar::SetTerrainMap(GameMap& _map)
+{
+    map = &_map;
+}
+
+PathView RTAAStar::GetPath()
+{
+    if (path_cost > 0)
+        return {final_path.data(), final_path.size(), path_cost, expansions};
+
+    return {nullptr, 0, path_cost, expansions};
+}
+
+PathView RTAAStar::GetPartialPath()
+{
+    if (planStatus != PlanStatus::IN_PROGRESS) {
+        return GetPath();
+    }
+
+    return {final_path.data(), final_path.size(), path_cost, expansions};
+}
+
+bool RTAAStar::ComputePath(WorldPos start, WorldPos goal)
+{
+    PROFILE_FUNC();
+
+    StartPath(start, goal);
+    while (planStatus == PlanStatus::IN_PROGRESS) {
+        StepPath(lookahead);
+    }
+
+    return planStatus == PlanStatus::FOUND;
+}
+
+void RTAAStar::StartPath(WorldPos start, WorldPos _goal)
+{
+    path_cost = -1.f;
+    expansions = 0;
+    moves = 0;
+    final_path.clear();
+    planStatus = PlanStatus::NO_PATH;
+
+    if (landmarks) {
+        landmarks->Update(*map);
+    }
+
+    // Grab a snapshot of the effort of every tile in the loaded window,
+    // unless the map hasn't changed since the last one
+    const bool mapChanged = grid.version != map->GetVersion();
+    if (mapChanged) {
+        map->GetEffortGrid(grid);
+    }
+
+    // For now, if the start or goal are outside of the loaded chunk extents, quit
+    if (!grid.Contains(start) || !grid.Contains(_goal)) {
+        return;
+    }
+
+    // What we've learned only holds for the same goal over the same map
+    if (_goal != goal || mapChanged || (int)learned.size() != grid.Size()) {
+        learned.assign(grid.Size(), -1.f);
+        gval.assign(grid.Size(), FLT_MAX);
+        parent.assign(grid.Size(), -1);
+        seen.assign(grid.Size(), 0);
+        stamp = 0;
+    }
+
+    goal = _goal;
+    gInd = grid.IndexOf(goal);
+    agent = grid.IndexOf(start);
+
+    final_path.push_back(start);
+    path_cost = 0.f;
+    planStatus = PlanStatus::IN_PROGRESS;
+}
+
+PlanStatus RTAAStar::StepPath(int /*maxExpansions*/, int /*maxMicros*/)
+{
+    PROFILE_FUNC();
+
+    if (planStatus != PlanStatus::IN_PROGRESS) {
+        return planStatus;
+    }
+
+    if (agent == gInd) {
+        planStatus = PlanStatus::FOUND;
+        return planStatus;
+    }
+
+    // An agent which can't reach the goal would wander forever; give up once
+    // it has taken more steps than there are tiles
+    if (moves >= grid.Size()) {
+        path_cost = -1.f;
+        planStatus = PlanStatus::NO_PATH;
+        return planStatus;
+    }
+
+    switch (heuristic) {
+        case MANHATTAN:
+            planStatus = Dispatch(ManhattanDist{});
+            break;
+
+        case EFFORT_OCTILE:
+            planStatus = Dispatch(EffortOctileDist{map->GetMinEffort()});
+            break;
+
+        case OCTILE:
+        default:
+            planStatus = Dispatch(OctileDist{});
+            break;
+    }
+
+    if (planStatus == PlanStatus::NO_PATH) {
+        path_cost = -1.f;
+    }
+
+    return planStatus;
+}
+
+template <class Heuristic>
+PlanStatus RTAAStar::Dispatch(const Heuristic& hval)
+{
+    if (landmarks) {
+        const LandmarkDist<Heuristic> lval {hval, landmarks};
+        if (connectivity == 4)
+            return Lookahead<4>(lval);
+        return Lookahead<8>(lval);
+    }
+
+    if (connectivity == 4)
+        return Lookahead<4>(hval);
+    return Lookahead<8>(hval);
+}
+
+template <int NN, class Heuristic>
+PlanStatus RTAAStar::Lookahead(const Heuristic& hval)
+{
+    static_assert(NN == 4 || NN == 8, "Only 4- and 8-connectivity are supported");
+
+    const olc::vi2d dims = grid.dims;
+
+    // Start each tick's search afresh, without touching every tile
+    if (++stamp == 0) {
+        std::fill(seen.begin(), seen.end(), 0);
+        stamp = 1;
+    }
+
+    auto H = [&](int idx) {
+        return learned[idx] >= 0 ? learned[idx] : hval(grid.LocOf(idx), goal);
+    };
+
+    open.Clear();
+    closed.clear();
+    seen[agent] = stamp;
+    gval[agent] = 0.f;
+    parent[agent] = -1;
+    open.Push({H(agent), 0.f, agent});
+
+    // A* from the agent, stopping after 'lookahead' expansions or at the goal
+    DepthEntry best {FLT_MAX, FLT_MAX, -1};
+    while (!open.Empty()) {
+        const DepthEntry top = open.Top();
+        const int id = top.idx;
+        if (top.g > gval[id]) {
+            open.Pop();
+            continue;
+        }
+
+        if (id == gInd || (int)closed.size() >= lookahead) {
+            best = top;
+            break;
+        }
+
+        open.Pop();
+        closed.push_back(id);
+        expansions++;
+
+        if (grid.effort[id] < 0) continue;
+
+        const int ci = id % dims.x;
+        const int cj = id / dims.x;
+        for (int n = 0; n < NN; n++) {
+            const int ni = ci + EffortGrid::DX[n];
+            const int nj = cj + EffortGrid::DY[n];
+            if (ni < 0 || ni >= dims.x || nj < 0 || nj >= dims.y) {
+                continue;
+            }
+
+            const int nidx = nj * dims.x + ni;
+            const float effort = grid.effort[nidx];
+            if (effort < 0) {
+                continue;
+            }
+
+            const float tmp_g = gval[id] + EffortGrid::STEP[n] + effort;
+            if (seen[nidx] != stamp || tmp_g < gval[nidx]) {
+                seen[nidx] = stamp;
+                gval[nidx] = tmp_g;
+                parent[nidx] = id;
+                open.Push({tmp_g + H(nidx), tmp_g, nidx});
+            }
+        }
+    }
+
+    // Nothing left to explore: the goal can't be reached from here
+    if (best.idx < 0) {
+        return PlanStatus::NO_PATH;
+    }
+
+    // Learn: every expanded tile is at least this far from the goal
+    for (int idx : closed) {
+        learned[idx] = std::max(H(idx), best.f - gval[idx]);
+    }
+
+    // Take the first step along the way to the most promising tile
+    int next = best.idx;
+    while (parent[next] != agent) {
+        next = parent[next];
+    }
+
+    const WorldPos d = grid.LocOf(next) - grid.LocOf(agent);
+    path_cost += (d.x != 0 && d.y != 0 ? SQRT2 : 1.f) + grid.effort[next];
+    agent = next;
+    moves++;
+    final_path.push_back(grid.LocOf(agent));
+
+    return agent == gInd ? PlanStatus::FOUND : PlanStatus::IN_PROGRESS;
+}
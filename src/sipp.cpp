@@ -0,0 +1,231 @@
+/**
+ * @File: sipp.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Safe Interval Path Planning (SIPP): planning around moving obstacles
+ *     whose positions are known over time
+ */
+
+#include "sipp.hpp"
+#include "heuristics.hpp"
+#include "util.hpp"
+
+#include <algorithm>
+
+void SafeIntervalTable::AddUnsafe(WorldPos tile, float from, float to)
+{
+    if (!(from < to)) return;
+
+    std::vector<Interval>& list = unsafe[tile];
+
+    // Swallow every interval which overlaps or touches the new one
+    auto first = std::lower_bound(list.begin(), list.end(), from,
+                                  [](const Interval& iv, float t) { return iv.to < t; });
+    auto last = first;
+    while (last != list.end() && last->from <= to) {
+        from = std::min(from, last->from);
+        to = std::max(to, last->to);
+        ++last;
+    }
+
+    const auto it = list.erase(first, last);
+    list.insert(it, {from, to});
+}
+
+void SafeIntervalTable::AddTrajectory(const std::vector<WorldPos>& tiles, const std::vector<float>& times,
+                                      float leaveTime)
+{
+    const size_t n = std::min(tiles.size(), times.size());
+    for (size_t k = 0; k < n; k++) {
+        AddUnsafe(tiles[k], times[k], k + 1 < n ? times[k + 1] : leaveTime);
+    }
+}
+
+const std::vector<SafeIntervalTable::Interval>* SafeIntervalTable::GetUnsafe(WorldPos tile) const
+{
+    const auto it = unsafe.find(tile);
+    return it == unsafe.end() ? nullptr : &it->second;
+}
+
+void SIPPlanner::SetTerrainMap(GameMap& _map)
+{
+    map = &_map;
+}
+
+PathView SIPPlanner::GetPath()
+{
+    if (path_cost >= 0 && !final_path.empty())
+        return {final_path.data(), final_path.size(), path_cost, expansions};
+
+    return {nullptr, 0, path_cost, expansions};
+}
+
+bool SIPPlanner::ComputePath(WorldPos start, WorldPos _goal)
+{
+    PROFILE_FUNC();
+
+    path_cost = -1.f;
+    expansions = 0;
+    final_path.clear();
+    timed_path.clear();
+
+    if (landmarks) {
+        landmarks->Update(*map);
+    }
+
+    // Grab a snapshot of the effort of every tile in the loaded window,
+    // unless the map hasn't changed since the last one
+    if (grid.version != map->GetVersion()) {
+        map->GetEffortGrid(grid);
+    }
+
+    // For now, if the start or goal are outside of the loaded chunk extents, quit
+    if (!grid.Contains(start) || !grid.Contains(_goal)) {
+        return false;
+    }
+
+    goal = _goal;
+    gInd = grid.IndexOf(goal);
+
+    // Look up each tile's unsafe intervals once, rather than on every expansion
+    unsafe.assign(grid.Size(), nullptr);
+    if (intervals) {
+        for (const auto& [tile, list] : intervals->GetAll()) {
+            if (grid.Contains(tile) && !list.empty()) {
+                unsafe[grid.IndexOf(tile)] = &list;
+            }
+        }
+    }
+
+    bool found = false;
+    switch (heuristic) {
+        case MANHATTAN:
+            found = Dispatch(ManhattanDist{}, grid.IndexOf(start));
+            break;
+
+        case EFFORT_OCTILE:
+            found = Dispatch(EffortOctileDist{map->GetMinEffort()}, grid.IndexOf(start));
+            break;
+
+        case OCTILE:
+        default:
+            found = Dispatch(OctileDist{}, grid.IndexOf(start));
+            break;
+    }
+
+    return found;
+}
+
+template <class Heuristic>
+bool SIPPlanner::Dispatch(const Heuristic& hval, int sInd)
+{
+    if (landmarks) {
+        const LandmarkDist<Heuristic> lval {hval, landmarks};
+        if (connectivity == 4)
+            return Search<4>(lval, sInd);
+        return Search<8>(lval, sInd);
+    }
+
+    if (connectivity == 4)
+        return Search<4>(hval, sInd);
+    return Search<8>(hval, sInd);
+}
+
+template <int NN, class Heuristic>
+bool SIPPlanner::Search(const Heuristic& hval, int sInd)
+{
+    static_assert(NN == 4 || NN == 8, "Only 4- and 8-connectivity are supported");
+
+    nodes.clear();
+    open.Clear();
+    visited.clear();
+
+    auto key = [](int idx, int j) { return ((uint64_t)(uint32_t)j << 32) | (uint32_t)idx; };
+
+    // The agent has to be somewhere safe to begin with
+    int sInterval = 0;
+    while (sInterval < NumIntervals(sInd) && IntervalEnd(sInd, sInterval) <= startTime) {
+        sInterval++;
+    }
+    if (sInterval == NumIntervals(sInd) || IntervalStart(sInd, sInterval) > startTime) {
+        return false;
+    }
+
+    nodes.push_back({sInd, sInterval, startTime, startTime, -1});
+    visited[key(sInd, sInterval)] = 0;
+    open.Push({startTime + hval(grid.LocOf(sInd), goal), startTime, 0});
+
+    const olc::vi2d dims = grid.dims;
+
+    while (!open.Empty()) {
+        const DepthEntry top = open.Pop();
+
+        const Node cur = nodes[top.idx];
+        if (top.g > cur.g) continue;
+
+        expansions++;
+
+        // Only the last safe interval runs on forever, so the agent can stay
+        if (cur.idx == gInd && cur.interval == NumIntervals(gInd) - 1) {
+            for (int n = top.idx; n >= 0; n = nodes[n].parent) {
+                timed_path.push_back({grid.LocOf(nodes[n].idx), nodes[n].enter});
+            }
+            std::reverse(timed_path.begin(), timed_path.end());
+
+            final_path.reserve(timed_path.size());
+            for (const TimedStep& step : timed_path) {
+                final_path.push_back(step.tile);
+            }
+
+            path_cost = cur.g - startTime;
+            return true;
+        }
+
+        if (grid.effort[cur.idx] < 0) continue;
+
+        // The agent must be done moving off of this tile before it's taken
+        const float leaveBy = IntervalEnd(cur.idx, cur.interval);
+
+        const int ci = cur.idx % dims.x;
+        const int cj = cur.idx / dims.x;
+        for (int n = 0; n < NN; n++) {
+            const int ni = ci + EffortGrid::DX[n];
+            const int nj = cj + EffortGrid::DY[n];
+            if (ni < 0 || ni >= dims.x || nj < 0 || nj >= dims.y) {
+                continue;
+            }
+
+            const int nidx = nj * dims.x + ni;
+            const float effort = grid.effort[nidx];
+            if (effort < 0) {
+                continue;
+            }
+
+            // Try each of the neighbor's safe intervals, setting off as early as
+            // possible; each later one means waiting longer here
+            const float duration = EffortGrid::STEP[n] + effort;
+            for (int j = 0; j < NumIntervals(nidx); j++) {
+                const float depart = std::max(cur.g, IntervalStart(nidx, j));
+                const float arrive = depart + duration;
+                if (arrive > leaveBy) break;
+                if (arrive > IntervalEnd(nidx, j)) continue;
+
+                auto [it, added] = visited.try_emplace(key(nidx, j), (int32_t)nodes.size());
+                if (added) {
+                    nodes.push_back({nidx, j, arrive, depart, top.idx});
+                } else if (arrive < nodes[it->second].g) {
+                    nodes[it->second].g = arrive;
+                    nodes[it->second].enter = depart;
+                    nodes[it->second].parent = top.idx;
+                } else {
+                    continue;
+                }
+
+                open.Push({arrive + hval(grid.LocOf(nidx), goal), arrive, it->second});
+            }
+        }
+    }
+
+    return false;
+}
@@ -16,24 +16,29 @@ static std::array<olc::Pixel, 18> COLORS {
     olc::WHITE, olc::BLACK, olc::BLANK
 };
 
-void Tile::Draw(const olc::vi2d& offset)
+void Tile::Draw(const WorldPos& camera)
 {
     if (pge) {
+        // Position on the screen, found in world pixels so it's exact however far out the camera is
+        const WorldPos world = {vTileCoord.x * TW, vTileCoord.y * TH};
+        const WorldPos screen = world - camera;
+
         // Use the supplied texture if we have it
         if (dTexture) {
+            // With how we're currently creating the terrain, we need to offset
+            // the sprites by half a tile size for this to actually work
+            const WorldPos pos = screen - WorldPos({TW/2, TH/2});
+
             // Only draw the tile if it's actually on the screen
-            const olc::vf2d pos = vScreenPos - offset;
-            if (pos.x + TW < 0 || pos.x >= (float)pge->ScreenWidth() ||
-                pos.y + TH < 0 || pos.y >= (float)pge->ScreenHeight()) {
+            if (pos.x + TW < 0 || pos.x >= pge->ScreenWidth() ||
+                pos.y + TH < 0 || pos.y >= pge->ScreenHeight()) {
                 return;
             }
-            pge->DrawDecal(pos, dTexture);
+            pge->DrawDecal({(float)pos.x, (float)pos.y}, dTexture);
 
         } else {
             // Otherwise draw a simple filled rectangle
-            const int32_t x = vTileCoord.x * TW;
-            const int32_t y = vTileCoord.y * TH;
-            pge->FillRect(x, y, TW, TH, COLORS[layer]);
+            pge->FillRect((int32_t)screen.x, (int32_t)screen.y, TW, TH, COLORS[layer]);
         }
     }
 }
@@ -163,7 +168,7 @@ olc::Sprite* TileSet::GetTileAt(uint8_t type, int idx)
     return tiles[type][idx];
 }
 
-olc::Decal* TileSet::GetTextureFor(const std::array<uint8_t, 4>& bcs, olc::vi2d loc)
+olc::Decal* TileSet::GetTextureFor(const std::array<uint8_t, 4>& bcs, const WorldPos& loc)
 {
     if (IsBaseTile(bcs)) {
         uint8_t type = bcs[0];
@@ -172,7 +177,7 @@ olc::Decal* TileSet::GetTextureFor(const std::array<uint8_t, 4>& bcs, olc::vi2d
             return blankTile.Decal();
         }
         // Use a nice, deterministic "random number" to get the "random" tile
-        float rval = SimpleRand(loc.x, loc.y);
+        float rval = SimpleRand((int)loc.x, (int)loc.y);
         int t = GetRandomBaseTile(rval); //GetNoise(50.*ix, 50.*iy));
         return baseTiles[type].at(t);
     }
@@ -7,6 +7,9 @@
  *     Miscellaneous globally-useful utility structs and functions
  */
 #include "util.hpp"
+#include "mapfile.hpp"
+#include "mapimage.hpp"
+#include "maptmx.hpp"
 
 #include "yaml-cpp/yaml.h"
 
@@ -36,6 +39,32 @@ float SimpleRand(int x, int y)
     return (float)rand() / RAND_MAX;
 }
 
+std::string RelativeTo(const std::string& fname, const std::string& path)
+{
+    const size_t slash = fname.find_last_of('/');
+    if (path.empty() || path[0] == '/' || slash == std::string::npos) {
+        return path;
+    }
+
+    return fname.substr(0, slash + 1) + path;
+}
+
+olc::Pixel PixelFromString(const std::string& color)
+{
+    std::string hex = color;
+    if (!hex.empty() && hex[0] == '#') {
+        hex = hex.substr(1);
+    }
+
+    if (hex.size() != 6 || hex.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos) {
+        std::cout << "WARNING: Invalid colour '" << color << "'; expecting #rrggbb." << std::endl;
+        return olc::BLACK;
+    }
+
+    const uint32_t rgb = std::stoul(hex, nullptr, 16);
+    return olc::Pixel((rgb >> 16) & 0xFF, (rgb >> 8) & 0xFF, rgb & 0xFF);
+}
+
 MapType MapTypeValFromString(const std::string& maptype)
 {
     std::string m = maptype;
@@ -54,10 +83,38 @@ PlannerMethod MethodValFromString(const std::string& method)
 
     if (m == "a*" || m == "astar") return PlannerMethod::ASTAR;
     if (m == "rrt*" || m == "rrtstar") return PlannerMethod::RRTSTAR;
+    if (m == "ch" || m == "contraction") return PlannerMethod::CONTRACTION;
+    if (m == "cpd") return PlannerMethod::CPD;
+    if (m == "hda*" || m == "hdastar") return PlannerMethod::HDASTAR;
+    if (m == "rtaa*" || m == "rtaastar") return PlannerMethod::RTAASTAR;
 
     return PlannerMethod::METHOD_MAX;
 }
 
+HeuristicType HeuristicValFromString(const std::string& heuristic)
+{
+    std::string h = heuristic;
+    std::transform(h.begin(), h.end(), h.begin(), ::tolower);
+
+    if (h == "octile" || h == "diagonal") return HeuristicType::OCTILE;
+    if (h == "manhattan") return HeuristicType::MANHATTAN;
+    if (h == "effort" || h == "effort-octile") return HeuristicType::EFFORT_OCTILE;
+
+    return HeuristicType::HEURISTIC_MAX;
+}
+
+OpenListType OpenListValFromString(const std::string& openList)
+{
+    std::string o = openList;
+    std::transform(o.begin(), o.end(), o.begin(), ::tolower);
+
+    if (o == "set") return OpenListType::OPEN_SET;
+    if (o == "heap") return OpenListType::OPEN_HEAP;
+    if (o == "bucket") return OpenListType::OPEN_BUCKET;
+
+    return OpenListType::OPENLIST_MAX;
+}
+
 bool LoadInput(const std::string& fname, Config& config)
 {
     YAML::Node input;
@@ -72,19 +129,176 @@ bool LoadInput(const std::string& fname, Config& config)
     }
 
     config.fConfig = fname;
-    config.dims.x = input["dims"]["x"].as<int>();
-    config.dims.y = input["dims"]["y"].as<int>();
-    config.mapType = MapTypeValFromString(input["maptype"].as<std::string>());
+
+    // An image map is a static map, with its terrain read from the image rather than 'map'
+    std::string maptype = input["maptype"].as<std::string>();
+    std::transform(maptype.begin(), maptype.end(), maptype.begin(), ::tolower);
+
+    config.mapImage = "";
+    if (maptype == "image") {
+        if (!input["image"]) {
+            std::cout << "Image map requested but image not given" << std::endl;
+            exit(1);
+        }
+        config.mapImage = RelativeTo(fname, input["image"].as<std::string>());
+        maptype = "static";
+
+        config.imagePalette.clear();
+        if (input["palette"]) {
+            config.imagePalette = input["palette"].as<std::vector<uint8_t>>();
+        }
+
+        config.imageColors.clear();
+        if (input["colors"]) {
+            for (const auto& color : input["colors"].as<std::vector<std::string>>()) {
+                config.imageColors.push_back(PixelFromString(color));
+            }
+        }
+    }
+
+    // As is a Tiled map
+    config.mapTmx = "";
+    if (maptype == "tmx") {
+        if (!input["tmx"]) {
+            std::cout << "Tiled map requested but tmx not given" << std::endl;
+            exit(1);
+        }
+        config.mapTmx = RelativeTo(fname, input["tmx"].as<std::string>());
+        maptype = "static";
+
+        // In the order given, as the first one found in a terrain's name is used
+        config.tmxTerrains.clear();
+        if (input["terrains"]) {
+            for (const auto& entry : input["terrains"]) {
+                config.tmxTerrains.push_back({entry.first.as<std::string>(), entry.second.as<uint8_t>()});
+            }
+        }
+    }
+
+    // A binary map file is found relative to the input file, and gives its own dims
+    config.mapFile = "";
+    if (input["mapFile"]) {
+        config.mapFile = RelativeTo(fname, input["mapFile"].as<std::string>());
+    }
+
+    if (!config.mapImage.empty()) {
+        if (!ReadImageDims(config.mapImage, config.dims)) {
+            return false;
+        }
+    } else if (!config.mapTmx.empty()) {
+        if (!ReadTmxDims(config.mapTmx, config.dims)) {
+            return false;
+        }
+    } else if (!config.mapFile.empty()) {
+        if (!TiledTerrain::ReadDims(config.mapFile, config.dims)) {
+            return false;
+        }
+    } else {
+        config.dims.x = input["dims"]["x"].as<int>();
+        config.dims.y = input["dims"]["y"].as<int>();
+    }
+    config.mapType = MapTypeValFromString(maptype);
     config.method = MethodValFromString(input["method"].as<std::string>());
 
-    if (config.method != PlannerMethod::ASTAR) {
-        std::cout << "WARNING: Only the A* method is currently implemented." << std::endl;
+    const bool precomputed = (config.method == PlannerMethod::CONTRACTION || config.method == PlannerMethod::CPD);
+    if (precomputed && config.mapType != MapType::STATIC) {
+        std::cout << "WARNING: Contraction hierarchies and path databases require a static map." << std::endl;
         std::cout << "  Defaulting method to A*." << std::endl;
         config.method = PlannerMethod::ASTAR;
     }
 
+    const bool search = (config.method == PlannerMethod::ASTAR || config.method == PlannerMethod::HDASTAR ||
+                         config.method == PlannerMethod::RTAASTAR);
+    if (!search && !precomputed) {
+        std::cout << "WARNING: Only the A*, HDA*, RTAA*, CH and CPD methods are currently implemented." << std::endl;
+        std::cout << "  Defaulting method to A*." << std::endl;
+        config.method = PlannerMethod::ASTAR;
+    }
+
+    config.epsilon = 0.f;
+    if (input["epsilon"]) {
+        config.epsilon = input["epsilon"].as<float>();
+        if (config.epsilon < 0.f) {
+            std::cout << "WARNING: epsilon must not be negative; defaulting to 0 (optimal paths)." << std::endl;
+            config.epsilon = 0.f;
+        }
+    }
+
+    config.chCache = false;
+    if (input["chCache"]) {
+        config.chCache = input["chCache"].as<bool>();
+    }
+
+    config.cpdCache = false;
+    if (input["cpdCache"]) {
+        config.cpdCache = input["cpdCache"].as<bool>();
+    }
+
+    config.pathCache = 0;
+    if (input["pathCache"]) {
+        config.pathCache = std::max(0, input["pathCache"].as<int>());
+    }
+
+    config.heuristic = HeuristicType::EFFORT_OCTILE;
+    if (input["heuristic"]) {
+        config.heuristic = HeuristicValFromString(input["heuristic"].as<std::string>());
+        if (config.heuristic == HeuristicType::HEURISTIC_MAX) {
+            std::cout << "WARNING: Unknown heuristic '" << input["heuristic"].as<std::string>() << "'." << std::endl;
+            std::cout << "  Defaulting heuristic to effort-octile." << std::endl;
+            config.heuristic = HeuristicType::EFFORT_OCTILE;
+        }
+    }
+
+    config.openList = OpenListType::OPEN_HEAP;
+    if (input["openList"]) {
+        config.openList = OpenListValFromString(input["openList"].as<std::string>());
+        if (config.openList == OpenListType::OPENLIST_MAX) {
+            std::cout << "WARNING: Unknown open list '" << input["openList"].as<std::string>() << "'." << std::endl;
+            std::cout << "  Defaulting open list to heap." << std::endl;
+            config.openList = OpenListType::OPEN_HEAP;
+        }
+    }
+
+    config.connectivity = 8;
+    if (input["connectivity"]) {
+        config.connectivity = input["connectivity"].as<int>();
+        if (config.connectivity != 4 && config.connectivity != 8) {
+            std::cout << "WARNING: Connectivity must be 4 or 8; defaulting to 8." << std::endl;
+            config.connectivity = 8;
+        }
+    }
+
+    // Manhattan distance overestimates diagonal moves, so it's only admissible without them
+    if (config.heuristic == HeuristicType::MANHATTAN && config.connectivity != 4) {
+        std::cout << "WARNING: The manhattan heuristic needs 'connectivity: 4'." << std::endl;
+        std::cout << "  Defaulting heuristic to effort-octile." << std::endl;
+        config.heuristic = HeuristicType::EFFORT_OCTILE;
+    }
+
+    config.nThreads = 0;
+    if (input["threads"]) {
+        config.nThreads = input["threads"].as<int>();
+    }
+
+    config.lookahead = 64;
+    if (input["lookahead"]) {
+        config.lookahead = std::max(1, input["lookahead"].as<int>());
+    }
+
+    config.frameBudget = 0;
+    if (input["frameBudget"]) {
+        config.frameBudget = input["frameBudget"].as<int>();
+    }
+
+    config.nLandmarks = 0;
+    if (input["landmarks"]) {
+        config.nLandmarks = std::max(0, input["landmarks"].as<int>());
+    }
+
     if (config.mapType == MapType::STATIC) {
-        if (input["map"]) {
+        if (!config.mapImage.empty() || !config.mapTmx.empty() || !config.mapFile.empty()) {
+            // Loaded by the GameMap
+        } else if (input["map"]) {
             config.map = input["map"].as<std::vector<uint8_t>>();
         } else {
             std::cout << "Static map requested but map not given" << std::endl;
@@ -107,6 +321,11 @@ bool LoadInput(const std::string& fname, Config& config)
         if (input["terrainWeights"]) {
             config.terrainWeights = input["terrainWeights"].as<std::vector<float>>();
         }
+
+        config.chunkCache = false;
+        if (input["chunkCache"]) {
+            config.chunkCache = input["chunkCache"].as<bool>();
+        }
     }
 
     return true;
@@ -0,0 +1,67 @@
+/**
+ * @File: workerpool.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Threads kept waiting between parallel jobs, so that starting one costs wake-ups rather than new threads
+ */
+
+#include "workerpool.hpp"
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    wake.notify_all();
+
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+void WorkerPool::RunJob(JobFn fn, const void* arg)
+{
+    if (threads.empty()) {
+        for (int slot = 1; slot < nSlots; slot++) {
+            threads.emplace_back([this, slot] { Loop(slot); });
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = fn;
+        jobArg = arg;
+        running = nSlots - 1;
+        generation++;
+    }
+    wake.notify_all();
+
+    fn(arg, 0);
+
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this] { return running == 0; });
+}
+
+void WorkerPool::Loop(int slot)
+{
+    uint64_t seen = 0;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this, seen] { return stop || generation != seen; });
+        if (stop) break;
+        seen = generation;
+
+        const JobFn fn = job;
+        const void* arg = jobArg;
+        lock.unlock();
+        fn(arg, slot);
+        lock.lock();
+
+        if (--running == 0) {
+            done.notify_one();
+        }
+    }
+}
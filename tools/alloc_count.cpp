@@ -0,0 +1,66 @@
+/**
+ * @File: alloc_count.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Replaces every form of the global operator new and delete with ones
+ *     which count the allocations, for planner-bench.  Kept in its own file so
+ *     that the compiler never sees the replacements next to their callers.
+ */
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+//! Every heap allocation made through new, to check that scrolling the map makes none
+std::atomic<long> nHeapAllocs {0};
+
+namespace
+{
+
+void* Allocate(size_t size, size_t align = alignof(std::max_align_t)) noexcept
+{
+    nHeapAllocs++;
+    size = size ? size : 1;
+    if (align <= alignof(std::max_align_t)) return malloc(size);
+
+    // aligned_alloc() wants a whole number of alignments
+    return aligned_alloc(align, (size + align - 1) / align * align);
+}
+
+void* AllocateOrThrow(size_t size, size_t align = alignof(std::max_align_t))
+{
+    if (void* ptr = Allocate(size, align)) return ptr;
+    throw std::bad_alloc();
+}
+
+} // namespace
+
+void* operator new(size_t size) { return AllocateOrThrow(size); }
+void* operator new[](size_t size) { return AllocateOrThrow(size); }
+void* operator new(size_t size, std::align_val_t al) { return AllocateOrThrow(size, (size_t)al); }
+void* operator new[](size_t size, std::align_val_t al) { return AllocateOrThrow(size, (size_t)al); }
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return Allocate(size); }
+void* operator new(size_t size, std::align_val_t al, const std::nothrow_t&) noexcept
+{
+    return Allocate(size, (size_t)al);
+}
+void* operator new[](size_t size, std::align_val_t al, const std::nothrow_t&) noexcept
+{
+    return Allocate(size, (size_t)al);
+}
+
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete[](void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t) noexcept { free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+void operator delete[](void* ptr, size_t, std::align_val_t) noexcept { free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { free(ptr); }
+void operator delete(void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { free(ptr); }
+void operator delete[](void* ptr, std::align_val_t, const std::nothrow_t&) noexcept { free(ptr); }
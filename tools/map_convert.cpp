@@ -0,0 +1,64 @@
+/**
+ * @File: map_convert.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Convert the terrain of a static map, from its YAML config, image or Tiled map, to a binary map file
+ */
+#define OLC_PGE_APPLICATION
+#include "olcPixelGameEngine.h"
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+#include "gamemap.hpp"
+#include "util.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+void print_usage(const std::string& arg0)
+{
+    std::cout << "Usage:" << std::endl;
+    std::cout << "    " << arg0 << " <input_config> <output_map>" << std::endl;
+    std::cout << "Then use the output in a config as 'mapFile: <output_map>', in place of 'dims' and 'map'" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        print_usage(argv[0]);
+        exit(1);
+    }
+
+    const auto t0 = Clock::now();
+
+    Config config;
+    if (!LoadInput(argv[1], config)) {
+        print_usage(argv[0]);
+        exit(1);
+    }
+
+    if (config.mapType != MapType::STATIC) {
+        printf("Only static maps can be converted\n");
+        exit(1);
+    }
+
+    // Generate the map headless; only its terrain is needed
+    GameMap map(config);
+    map.GenerateMap();
+
+    const auto t1 = Clock::now();
+
+    if (!map.SaveMapFile(argv[2])) {
+        exit(1);
+    }
+
+    const auto t2 = Clock::now();
+    const olc::vi2d dims = map.GetDims();
+    printf("Converted %d x %d map: loaded in %.1f ms, saved in %.1f ms\n", dims.x, dims.y,
+           std::chrono::duration<double, std::milli>(t1 - t0).count(),
+           std::chrono::duration<double, std::milli>(t2 - t1).count());
+
+    return 0;
+}
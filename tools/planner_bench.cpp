@@ -0,0 +1,685 @@
+/**
+ * @File: planner_bench.cpp
+ * @Author: Jacob Crabill <github.com/JacobCrabill>
+ *
+ * @Description:
+ *     Headless benchmark of the planners on a map loaded from a config file
+ */
+#define OLC_PGE_APPLICATION
+#include "olcPixelGameEngine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "astar.hpp"
+#include "costfield.hpp"
+#include "gamemap.hpp"
+#include "hdastar.hpp"
+#include "mapf.hpp"
+#include "pathcache.hpp"
+#include "sipp.hpp"
+#include "util.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+//! Every heap allocation made through new, counted by alloc_count.cpp
+extern std::atomic<long> nHeapAllocs;
+
+struct Query
+{
+    WorldPos start;
+    WorldPos goal;
+    float cost; //!< Reference cost from AStar
+};
+
+void print_usage(const std::string& arg0)
+{
+    std::cout << "Usage:" << std::endl;
+    std::cout << "    " << arg0 << " <input_config> [n_queries] [max_threads] [window_tiles]" << std::endl;
+}
+
+double Millis(Clock::time_point t0)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - t0).count();
+}
+
+/**
+ * @brief Pick random pairs of passable tiles, at least half the window apart
+ *
+ * Each query is solved once with AStar to give the reference cost and time.
+ */
+std::vector<Query> MakeQueries(GameMap& map, const Config& config, int nQueries, double& msAStar)
+{
+    EffortGrid grid;
+    map.GetEffortGrid(grid);
+
+    std::vector<int> passable;
+    for (int i = 0; i < grid.Size(); i++) {
+        if (grid.effort[i] >= 0) passable.push_back(i);
+    }
+
+    AStar astar(config.heuristic, config.connectivity);
+    astar.SetTerrainMap(map);
+
+    std::mt19937 rng(1);
+    std::vector<Query> queries;
+    const int minDist = std::max(grid.dims.x, grid.dims.y) / 2;
+
+    msAStar = 0;
+    for (int tries = 0; (int)queries.size() < nQueries && tries < 100 * nQueries; tries++) {
+        const WorldPos s = grid.LocOf(passable[rng() % passable.size()]);
+        const WorldPos g = grid.LocOf(passable[rng() % passable.size()]);
+        if (std::max(std::abs(g.x - s.x), std::abs(g.y - s.y)) < minDist) continue;
+
+        const auto t0 = Clock::now();
+        const bool found = astar.ComputePath(s, g);
+        const double ms = Millis(t0);
+        if (!found) continue;
+
+        msAStar += ms;
+        queries.push_back({s, g, astar.GetPathCost()});
+    }
+
+    return queries;
+}
+
+//! Run every query with HDA* on 1, 2, 4, ... maxThreads threads
+void BenchHDAStar(GameMap& map, const Config& config, const std::vector<Query>& queries,
+                  int maxThreads, double msAStar)
+{
+    const int nq = (int)queries.size();
+    printf("\n%-10s %10s %10s %12s %8s %12s\n", "threads", "ms/query", "speedup", "expansions", "wrong", "allocs/query");
+    printf("%-10s %10.3f %10.2f %12s %8s %12s\n", "A*", msAStar / nq, 1.0, "-", "-", "-");
+
+    std::vector<int> threadCounts;
+    for (int nt = 1; nt < maxThreads; nt *= 2) {
+        threadCounts.push_back(nt);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (int nt : threadCounts) {
+        HDAStar hda(nt, config.heuristic, config.connectivity);
+        hda.SetTerrainMap(map);
+
+        // Allocations are counted once the first query has warmed the planner up
+        double ms = 0;
+        long expansions = 0;
+        long allocs = 0;
+        int wrong = 0;
+        for (int i = 0; i < nq; i++) {
+            const Query& q = queries[i];
+            const long allocs0 = nHeapAllocs;
+            const auto t0 = Clock::now();
+            hda.ComputePath(q.start, q.goal);
+            ms += Millis(t0);
+
+            if (i > 0) allocs += nHeapAllocs - allocs0;
+            expansions += hda.GetPath().expansions;
+            if (std::fabs(hda.GetPathCost() - q.cost) > 1e-3f * q.cost) wrong++;
+        }
+
+        printf("%-10d %10.3f %10.2f %12ld %8d %12.1f\n", nt, ms / nq, msAStar / ms, expansions / nq, wrong,
+               nq > 1 ? (double)allocs / (nq - 1) : 0.);
+    }
+}
+
+//! Run every query with AStar on each kind of open list
+void BenchOpenLists(GameMap& map, const Config& config, const std::vector<Query>& queries)
+{
+    const char* names[OPENLIST_MAX] = {"set", "heap", "bucket"};
+    const int nq = (int)queries.size();
+
+    printf("\n%-10s %10s %10s %12s\n", "open list", "ms/query", "speedup", "max excess");
+
+    double msSet = 0;
+    for (int type = 0; type < OPENLIST_MAX; type++) {
+        AStar astar(config.heuristic, config.connectivity, (OpenListType)type);
+        astar.SetTerrainMap(map);
+
+        double ms = 0;
+        float excess = 0;
+        for (const auto& q : queries) {
+            const auto t0 = Clock::now();
+            astar.ComputePath(q.start, q.goal);
+            ms += Millis(t0);
+
+            excess = std::max(excess, astar.GetPathCost() - q.cost);
+        }
+
+        if (type == OPEN_SET) msSet = ms;
+        printf("%-10s %10.3f %10.2f %12.4f\n", names[type], ms / nq, msSet / ms, excess);
+    }
+}
+
+//! Run every query with AStar over a range of suboptimality bounds
+void BenchEpsilon(GameMap& map, const Config& config, const std::vector<Query>& queries)
+{
+    const int nq = (int)queries.size();
+
+    printf("\n%-10s %10s %10s %12s %12s\n", "epsilon", "ms/query", "speedup", "expansions", "worst ratio");
+
+    double msOptimal = 0;
+    for (float eps : {0.f, 0.05f, 0.1f, 0.25f, 0.5f, 1.f}) {
+        AStar astar(config.heuristic, config.connectivity, config.openList, eps);
+        astar.SetTerrainMap(map);
+
+        double ms = 0;
+        long expansions = 0;
+        float ratio = 0;
+        for (const auto& q : queries) {
+            const auto t0 = Clock::now();
+            astar.ComputePath(q.start, q.goal);
+            ms += Millis(t0);
+
+            expansions += astar.GetPath().expansions;
+            ratio = std::max(ratio, astar.GetPathCost() / q.cost);
+        }
+
+        if (eps == 0.f) msOptimal = ms;
+        printf("%-10.2f %10.3f %10.2f %12ld %12.4f\n", eps, ms / nq, msOptimal / ms, expansions / nq, ratio);
+    }
+}
+
+/**
+ * @brief Time full cost fields from the first query's start
+ *
+ * Compares serial Dijkstra, AStar run to exhaustion (by asking for an
+ * unreachable goal) and delta-stepping on 1, 2, 4, ... maxThreads threads.
+ */
+void BenchCostField(GameMap& map, const Config& config, const std::vector<Query>& queries, int maxThreads)
+{
+    const int nRuns = 5;
+
+    EffortGrid grid;
+    map.GetEffortGrid(grid);
+    const int source = grid.IndexOf(queries[0].start);
+
+    std::vector<float> ref, cost;
+    std::vector<int> parent;
+
+    auto t0 = Clock::now();
+    for (int r = 0; r < nRuns; r++) {
+        ComputeCostField(grid, source, ref);
+    }
+    const double msDijkstra = Millis(t0) / nRuns;
+
+    printf("\n%-10s %10s %10s %8s\n", "field", "ms/field", "speedup", "wrong");
+    printf("%-10s %10.3f %10.2f %8s\n", "Dijkstra", msDijkstra, 1.0, "-");
+
+    const auto it = std::find_if(grid.effort.begin(), grid.effort.end(), [](float e) { return e < 0; });
+    if (it != grid.effort.end()) {
+        AStar astar(config.heuristic, config.connectivity);
+        astar.SetTerrainMap(map);
+
+        t0 = Clock::now();
+        for (int r = 0; r < nRuns; r++) {
+            astar.ComputePath(queries[0].start, grid.LocOf(it - grid.effort.begin()));
+        }
+        const double ms = Millis(t0) / nRuns;
+        printf("%-10s %10.3f %10.2f %8s\n", "A*", ms, msDijkstra / ms, "-");
+    }
+
+    std::vector<int> threadCounts;
+    for (int nt = 1; nt < maxThreads; nt *= 2) {
+        threadCounts.push_back(nt);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (int nt : threadCounts) {
+        t0 = Clock::now();
+        for (int r = 0; r < nRuns; r++) {
+            ComputeCostFieldParallel(grid, source, cost, parent, nt);
+        }
+        const double ms = Millis(t0) / nRuns;
+
+        int wrong = 0;
+        for (int i = 0; i < grid.Size(); i++) {
+            if (std::fabs(cost[i] - ref[i]) > 1e-3f * std::max(1.f, ref[i])) wrong++;
+        }
+
+        const std::string name = "delta x" + std::to_string(nt);
+        printf("%-10s %10.3f %10.2f %8d\n", name.c_str(), ms, msDijkstra / ms, wrong);
+    }
+}
+
+/**
+ * @brief Replay a cursor-like stream of queries through a PathCache
+ *
+ * Each query heads for one of a few of the queries' goals.  Half start on the
+ * optimal path to that goal, as if the cursor were following it; a quarter
+ * go back to an earlier start, and the rest start on any passable tile.  The
+ * stream is run with plain A*, then through the cache on 1, 2, 4, ...
+ * maxThreads threads which share it.
+ */
+void BenchPathCache(GameMap& map, const Config& config, const std::vector<Query>& queries, int maxThreads)
+{
+    const int nStream = 2000;
+    const int nGoals = std::min<int>(4, queries.size());
+
+    EffortGrid grid;
+    map.GetEffortGrid(grid);
+
+    std::vector<int> passable;
+    for (int i = 0; i < grid.Size(); i++) {
+        if (grid.effort[i] >= 0) passable.push_back(i);
+    }
+
+    AStar astar(config.heuristic, config.connectivity, OPEN_HEAP);
+    astar.SetTerrainMap(map);
+
+    std::vector<std::vector<WorldPos>> routes(nGoals);
+    for (int g = 0; g < nGoals; g++) {
+        astar.ComputePath(queries[g].start, queries[g].goal);
+        routes[g].assign(astar.GetPath().begin(), astar.GetPath().end());
+    }
+
+    std::mt19937 rng(3);
+    std::vector<Query> stream;
+    for (int q = 0; q < nStream; q++) {
+        const int g = rng() % nGoals;
+        const int pick = rng() % 4;
+        WorldPos start;
+        if (pick < 2) {
+            start = routes[g][rng() % routes[g].size()];
+        } else if (pick == 2 && !stream.empty()) {
+            start = stream[rng() % stream.size()].start;
+        } else {
+            start = grid.LocOf(passable[rng() % passable.size()]);
+        }
+        stream.push_back({start, queries[g].goal, 0.f});
+    }
+
+    auto t0 = Clock::now();
+    for (auto& q : stream) {
+        astar.ComputePath(q.start, q.goal);
+        q.cost = astar.GetPathCost();
+    }
+    const double msPlain = Millis(t0);
+
+    printf("\n%-10s %10s %10s %10s %10s %12s\n", "cache", "ms/query", "speedup", "hit rate", "sub-path", "max excess");
+    printf("%-10s %10.3f %10.2f %10s %10s %12s\n", "none", msPlain / nStream, 1.0, "-", "-", "-");
+
+    std::vector<int> threadCounts;
+    for (int nt = 1; nt < maxThreads; nt *= 2) {
+        threadCounts.push_back(nt);
+    }
+    threadCounts.push_back(maxThreads);
+
+    for (int nt : threadCounts) {
+        PathCache cache(1024);
+        std::vector<float> excess(nt, 0.f);
+
+        // Each thread takes every nt'th query of the stream
+        t0 = Clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < nt; t++) {
+            threads.emplace_back([&, t]() {
+                AStar inner(config.heuristic, config.connectivity, OPEN_HEAP);
+                CachedPlanner cached(&inner, &cache, PlannerConfigKey(config), true);
+                cached.SetTerrainMap(map);
+                for (int q = t; q < nStream; q += nt) {
+                    cached.ComputePath(stream[q].start, stream[q].goal);
+                    excess[t] = std::max(excess[t], cached.GetPathCost() - stream[q].cost);
+                }
+            });
+        }
+        for (auto& th : threads) {
+            th.join();
+        }
+        const double ms = Millis(t0);
+
+        const PathCacheStats stats = cache.GetStats();
+        const std::string name = "x" + std::to_string(nt);
+        printf("%-10s %10.3f %10.2f %9.1f%% %9.1f%% %12.4f\n", name.c_str(), ms / nStream, msPlain / ms,
+               100 * stats.HitRate(), 100. * stats.subPathHits / nStream,
+               *std::max_element(excess.begin(), excess.end()));
+    }
+}
+
+/**
+ * @brief Solve MAPF for growing numbers of agents, each with a time budget
+ *
+ * Starts and goals are distinct random tiles, all reachable from the first
+ * query's start.
+ */
+void BenchMAPF(GameMap& map, const Config& config, const std::vector<Query>& queries, int maxThreads)
+{
+    const int maxMillis = 1000;
+
+    EffortGrid grid;
+    map.GetEffortGrid(grid);
+
+    std::vector<float> field;
+    ComputeCostFieldTo(grid, grid.IndexOf(queries[0].start), field, config.connectivity);
+
+    std::vector<int> reachable;
+    for (int i = 0; i < grid.Size(); i++) {
+        if (field[i] < FLT_MAX && grid.effort[i] >= 0) reachable.push_back(i);
+    }
+
+    std::mt19937 rng(1);
+    std::shuffle(reachable.begin(), reachable.end(), rng);
+
+    printf("\n%-8s %-6s %-8s %10s %8s %8s %10s %12s %12s %8s\n", "agents", "eps", "solver", "ms", "failed",
+           "ct nodes", "searches", "searches/s", "agents/s", "sum/lb");
+
+    // Plain CBS, and ECBS with a 20% suboptimality bound
+    ALTHeuristic landmarks;
+    const float epsilons[] = {0.f, 0.2f};
+    std::vector<std::unique_ptr<MAPFSolver>> solvers;
+    for (float epsilon : epsilons) {
+        solvers.emplace_back(new MAPFSolver(maxThreads, config.connectivity, epsilon));
+        solvers.back()->SetTerrainMap(map);
+        solvers.back()->SetLandmarks(&landmarks);
+    }
+
+    for (int nAgents : {10, 50, 100, 200, 400}) {
+        if (2 * nAgents > (int)reachable.size()) break;
+
+        std::vector<MAPFAgent> agents(nAgents);
+        for (int a = 0; a < nAgents; a++) {
+            agents[a] = {grid.LocOf(reachable[2 * a]), grid.LocOf(reachable[2 * a + 1])};
+        }
+
+        for (size_t e = 0; e < solvers.size(); e++) {
+            MAPFSolver& solver = *solvers[e];
+            solver.Solve(agents, maxMillis);
+            const MAPFStats& st = solver.GetStats();
+
+            // Each agent alone is the best any joint plan can do; the sum of costs
+            // only counts the agents which arrived, so the bound does too
+            float lowerBound = 0.f;
+            std::vector<float> alone;
+            for (int a = 0; a < nAgents; a++) {
+                const std::vector<WorldPos>& path = solver.GetPath(a);
+                if (path.empty() || path.back() != agents[a].goal) continue;
+
+                ComputeCostFieldTo(grid, grid.IndexOf(agents[a].goal), alone, config.connectivity);
+                lowerBound += alone[grid.IndexOf(agents[a].start)];
+            }
+
+            const char* name = st.bound == 1.f ? "CBS" : st.bound > 1.f ? "ECBS" : "prio";
+            printf("%-8d %-6.2f %-8s %10.1f %8d %8d %10d %12.0f %12.0f ", nAgents, epsilons[e], name, st.msTotal,
+                   st.failed, st.ctNodes, st.searches, st.SearchesPerSecond(), st.AgentsPerSecond());
+            if (lowerBound > 0.f) {
+                printf("%8.4f\n", st.sumOfCosts / lowerBound);
+            } else {
+                printf("%8s\n", "-");
+            }
+        }
+    }
+}
+
+/**
+ * @brief Run every query with SIPP around growing numbers of moving convoys
+ *
+ * Each convoy drives an optimal route between two random tiles, setting off
+ * at a random time up to 'spread', and stays parked at its end for a while.
+ */
+void BenchSIPP(GameMap& map, const Config& config, const std::vector<Query>& queries)
+{
+    const int nq = (int)queries.size();
+
+    EffortGrid grid;
+    map.GetEffortGrid(grid);
+
+    std::vector<int> passable;
+    for (int i = 0; i < grid.Size(); i++) {
+        if (grid.effort[i] >= 0) passable.push_back(i);
+    }
+
+    AStar astar(config.heuristic, config.connectivity);
+    astar.SetTerrainMap(map);
+
+    printf("\n%-10s %10s %10s %12s %12s %8s\n", "convoys", "ms/query", "spread", "expansions", "mean ratio", "failed");
+
+    std::mt19937 rng(1);
+    for (int nConvoys : {0, 100, 1000}) {
+        for (float spread : {100.f, 10000.f}) {
+            SafeIntervalTable table;
+            for (int c = 0; c < nConvoys; c++) {
+                const WorldPos s = grid.LocOf(passable[rng() % passable.size()]);
+                const WorldPos g = grid.LocOf(passable[rng() % passable.size()]);
+                if (!astar.ComputePath(s, g) || astar.GetPath().size() < 2) continue;
+
+                const PathView route = astar.GetPath();
+                std::vector<WorldPos> tiles(route.begin(), route.end());
+                std::vector<float> times(tiles.size());
+                times[0] = spread * (rng() % 1000) / 1000.f;
+                for (size_t k = 1; k < tiles.size(); k++) {
+                    const WorldPos d = tiles[k] - tiles[k - 1];
+                    times[k] = times[k - 1] + (d.x != 0 && d.y != 0 ? SQRT2 : 1.f) + grid.effort[grid.IndexOf(tiles[k])];
+                }
+                table.AddTrajectory(tiles, times, times.back() + 50.f);
+            }
+
+            SIPPlanner sipp(config.heuristic, config.connectivity);
+            sipp.SetTerrainMap(map);
+            sipp.SetSafeIntervals(&table);
+
+            double ms = 0, ratio = 0;
+            long expansions = 0;
+            int failed = 0;
+            for (const auto& q : queries) {
+                const auto t0 = Clock::now();
+                const bool found = sipp.ComputePath(q.start, q.goal);
+                ms += Millis(t0);
+
+                expansions += sipp.GetPath().expansions;
+                if (found) {
+                    ratio += sipp.GetPathCost() / q.cost;
+                } else {
+                    failed++;
+                }
+            }
+
+            printf("%-10d %10.3f %10.0f %12ld %12.4f %8d\n", nConvoys, ms / nq, spread, expansions / nq,
+                   failed < nq ? ratio / (nq - failed) : 0., failed);
+
+            if (nConvoys == 0) break;
+        }
+    }
+}
+
+/**
+ * @brief Time the work which depends on how each chunk lays out its tiles
+ *
+ * Reads every loaded tile into an EffortGrid, wanders the map reading tiles
+ * one at a time, re-runs the A* queries, then pans the view a chunk at a time
+ * around a square (loading a row or column of chunks per step).  Compare
+ * builds with and without CHUNK_ZORDER.  Leaves the chunk window moved.
+ *
+ * The square is panned twice, counting heap allocations: the first lap may
+ * fill caches, but the second should make none at all.
+ */
+/**
+ * @brief Move the camera a chunk at a time through 'steps', and report the time and allocations
+ *
+ * @param name Label to print the results under; nullptr to print nothing
+ */
+void Pan(GameMap& map, WorldPos& camera, const std::vector<WorldPos>& steps, const char* name)
+{
+    int nLoaded = 0;
+    const int id = map.Subscribe([&nLoaded](const MapChange& change) {
+        if (change.kind == CHUNK_ADDED) nLoaded++;
+    });
+
+    const long allocs = nHeapAllocs;
+    const auto t0 = Clock::now();
+    for (const auto& step : steps) {
+        camera += step;
+        map.UpdateView(camera);
+    }
+    const double ms = Millis(t0);
+    const long nAllocs = nHeapAllocs - allocs;
+
+    map.Unsubscribe(id);
+
+    if (name) {
+        printf("%-16s %10.3f %9.3f ms  (%d chunks, %ld heap allocations)\n", name, ms, nLoaded ? ms / nLoaded : 0.,
+               nLoaded, nAllocs);
+    }
+}
+
+//! Pan round a square 'side' chunks across, back to where the camera started
+void PanSquare(GameMap& map, WorldPos& camera, int side, const char* name)
+{
+    const WorldPos dirs[4] = {{CHUNK_SIZE * TW, 0}, {0, CHUNK_SIZE * TH}, {-CHUNK_SIZE * TW, 0}, {0, -CHUNK_SIZE * TH}};
+    std::vector<WorldPos> steps;
+    for (const auto& dir : dirs) {
+        steps.insert(steps.end(), side, dir);
+    }
+    Pan(map, camera, steps, name);
+}
+
+//! Pan 'n' chunks diagonally away from where the camera started, so that every step loads terrain never seen before
+void PanFresh(GameMap& map, WorldPos& camera, int n, const char* name)
+{
+    const std::vector<WorldPos> steps(n, WorldPos{-CHUNK_SIZE * TW, -CHUNK_SIZE * TH});
+    Pan(map, camera, steps, name);
+}
+
+void BenchChunks(GameMap& map, const Config& config, const std::vector<Query>& queries, int window)
+{
+    const int nq = (int)queries.size();
+    printf("\n%-16s %10s %12s\n", "chunks", "ms", "per");
+
+    EffortGrid grid;
+    const int nGrids = 20;
+    auto t0 = Clock::now();
+    for (int k = 0; k < nGrids; k++) {
+        map.GetEffortGrid(grid);
+    }
+    printf("%-16s %10.3f %9.3f ms\n", "effort grid", Millis(t0), Millis(t0) / nGrids);
+
+    // A random walk, as a planner's expansions read tiles in every direction
+    std::mt19937 rng(1);
+    const WorldPos lo = grid.origin;
+    const WorldPos hi = grid.origin + WorldPos({grid.dims.x - 1, grid.dims.y - 1});
+    WorldPos loc = grid.origin + WorldPos({grid.dims.x / 2, grid.dims.y / 2});
+    const int nReads = 10000000;
+    float sum = 0;
+    t0 = Clock::now();
+    for (int k = 0; k < nReads; k++) {
+        const uint32_t r = rng();
+        loc.x = std::clamp(loc.x + (int)(r % 3) - 1, lo.x, hi.x);
+        loc.y = std::clamp(loc.y + (int)((r >> 2) % 3) - 1, lo.y, hi.y);
+        sum += map.GetEffortAt(loc.x, loc.y);
+    }
+    printf("%-16s %10.3f %9.3f ns  (sum %.0f)\n", "tile reads", Millis(t0), 1e6 * Millis(t0) / nReads, sum);
+
+    AStar astar(config.heuristic, config.connectivity);
+    astar.SetTerrainMap(map);
+    t0 = Clock::now();
+    for (const auto& q : queries) {
+        astar.ComputePath(q.start, q.goal);
+    }
+    printf("%-16s %10.3f %9.3f ms\n", "A*", Millis(t0), Millis(t0) / nq);
+
+    // Pan round the same square twice, then off over fresh terrain
+    const int side = 16;
+    WorldPos camera = {0, 0};
+    PanSquare(map, camera, side, "pan (lap 1)");
+    PanSquare(map, camera, side, "pan (lap 2)");
+    PanFresh(map, camera, 2 * side, "fresh (no cache)");
+
+    // Far beyond 32-bit tile indices: the planners only index relative to the window
+    camera = {((int64_t)1 << 40) * TW, -((int64_t)1 << 40) * TH};
+    PanSquare(map, camera, side, "pan (far)");
+    map.GetEffortGrid(grid);
+    const auto first = std::find_if(grid.effort.begin(), grid.effort.end(), [](float e) { return e >= 0; });
+    const auto last = std::find_if(grid.effort.rbegin(), grid.effort.rend(), [](float e) { return e >= 0; });
+    if (first != grid.effort.end()) {
+        astar.SetTerrainMap(map);
+        t0 = Clock::now();
+        const bool found = astar.ComputePath(grid.LocOf(first - grid.effort.begin()),
+                                             grid.LocOf(grid.Size() - 1 - (last - grid.effort.rbegin())));
+        printf("%-16s %10.3f %9s     (origin %lld, %lld; %s)\n", "A* (far)", Millis(t0), "", (long long)grid.origin.x,
+               (long long)grid.origin.y, found ? "found" : "no path");
+    }
+
+    const ChunkPoolStats pool = map.GetChunkPoolStats();
+    printf("%-16s %10d chunks in %ld slabs, %ld of %ld reused\n", "pool", pool.capacity, pool.slabs, pool.reused,
+           pool.acquired);
+
+    // Fresh terrain again on maps which keep their chunks on disk: first with
+    // an empty store, then with another map reading back what the first wrote
+    if (config.mapType != MapType::PROCEDURAL) return;
+
+    Config cached = config;
+    cached.chunkCache = true;
+    cached.fConfig = (_gfs::temp_directory_path() / ("planner-bench-" + std::to_string(getpid()))).string();
+    for (const char* name : {"fresh (cold)", "fresh (warm)"}) {
+        GameMap cmap(cached);
+        cmap.SetViewSize({window * TW, window * TH});
+        cmap.GenerateMap();
+
+        WorldPos ccamera = {0, 0};
+        PanSquare(cmap, ccamera, side, nullptr);
+        PanFresh(cmap, ccamera, 2 * side, name);
+    }
+
+    _gfs::remove_all(cached.fConfig + ".chunks");
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        print_usage(argv[0]);
+        exit(1);
+    }
+
+    Config config;
+    if (!LoadInput(argv[1], config)) {
+        print_usage(argv[0]);
+        exit(1);
+    }
+
+    const int nQueries = argc > 2 ? std::stoi(argv[2]) : 20;
+    const int maxThreads = std::max(1, argc > 3 ? std::stoi(argv[3]) : (int)std::thread::hardware_concurrency());
+    const int window = argc > 4 ? std::stoi(argv[4]) : 512;
+
+    // Procedural chunks are only generated within the map's dimensions
+    if (config.mapType == MapType::PROCEDURAL) {
+        config.dims = {window, window};
+    }
+
+    // Generate the map headless, with a view as large as the requested window
+    GameMap map(config);
+    map.SetViewSize({window * TW, window * TH});
+    map.GenerateMap();
+
+    const auto extents = map.GetChunkExtents();
+    const WorldPos size = extents[1] - extents[0];
+    printf("Window: %lld x %lld tiles\n", (long long)size.x, (long long)size.y);
+
+    double msAStar = 0;
+    const std::vector<Query> queries = MakeQueries(map, config, nQueries, msAStar);
+    if (queries.empty()) {
+        printf("No solvable queries found\n");
+        return 1;
+    }
+    printf("Queries: %lu\n", queries.size());
+
+    BenchOpenLists(map, config, queries);
+    BenchEpsilon(map, config, queries);
+    BenchHDAStar(map, config, queries, maxThreads, msAStar);
+    BenchCostField(map, config, queries, maxThreads);
+    BenchPathCache(map, config, queries, maxThreads);
+    BenchSIPP(map, config, queries);
+    BenchMAPF(map, config, queries, maxThreads);
+    BenchChunks(map, config, queries, window);
+
+    return 0;
+}